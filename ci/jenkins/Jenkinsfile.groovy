@@ -137,6 +137,35 @@ pipeline {
                     }
                 }
 
+                stage('Debian Testing C++17') {
+                    agent {
+                        dockerfile {
+                            filename 'Dockefile.debian-testing'
+                            dir 'ci/jenkins'
+                            label 'master'
+                        }
+                    }
+
+                    steps {
+                        echo "Building with C++17 on debian-testing-AMD64 in ${WORKSPACE}"
+                        checkout scm
+                        sh 'pwd; ls -la'
+                        sh 'rm -rf build'
+                        sh 'mkdir build'
+                        sh 'cd build && cmake -DCMAKE_BUILD_TYPE=Release -DRESTC_CPP_USE_CPP17=ON .. && make'
+
+                        echo 'Getting ready to run tests'
+                        script {
+                            try {
+                                sh 'cd build && ctest --no-compress-output -T Test'
+                            } catch (exc) {
+                                echo 'Testing failed'
+                                currentBuild.result = 'UNSTABLE'
+                            }
+                        }
+                    }
+                }
+
                 stage('Fedora') {
                     agent {
                         dockerfile {
@@ -46,10 +46,87 @@ public:
     virtual bool IsEof() const = 0;
     virtual boost::asio::const_buffers_1 ReadSome() = 0;
 
+    /*! Read whatever is available, possibly as several buffers
+     *
+     * Readers that can return data from several places in their
+     * input without copying it, like the chunked reader, override
+     * this. The buffers are valid until the next read.
+     */
+    virtual void ReadSomeBuffers(write_buffers_t& buffers) {
+        const auto data = ReadSome();
+        if (boost::asio::buffer_size(data)) {
+            buffers.push_back(*data.begin());
+        }
+    }
+
+    /*! True if ReadInto() can read into the callers buffer without
+     * going through our own buffers.
+     */
+    virtual bool CanReadInto() const noexcept {
+        return false;
+    }
+
+    /*! Read up to the size of buffer directly into buffer.
+     *
+     * Only valid when CanReadInto() returns true.
+     *
+     * \return The number of bytes read. 0 when there is no more data.
+     */
+    virtual std::size_t ReadInto(boost::asio::mutable_buffers_1 /*buffer*/) {
+        throw NotSupportedException("ReadInto() is not supported by this reader");
+    }
+
+    /*! True if SpliceTo() can move the data to a file without
+     * copying it through our buffers.
+     */
+    virtual bool CanSpliceTo() const noexcept {
+        return false;
+    }
+
+    /*! Move up to maxBytes directly to the file fd.
+     *
+     * Only valid when CanSpliceTo() returns true.
+     *
+     * \return The number of bytes moved. 0 when there is no more data.
+     */
+    virtual std::size_t SpliceTo(int /*fd*/, std::size_t /*maxBytes*/) {
+        throw NotSupportedException("SpliceTo() is not supported by this reader");
+    }
+
+    /*! Let the readers in the chain do their IO in ctx
+     *
+     * Used when the rest of the data is read by another co-routine
+     * than the one that created the readers. Readers with a source
+     * forward this to it.
+     */
+    virtual void SetContext(Context& /*ctx*/) {}
+
+    /*! Replace the function that receives the headers in the body
+     *
+     * That is the trailer of a chunked body. Used when the reader
+     * outlives the object that received the headers. Readers with
+     * a source forward this to it.
+     */
+    virtual void SetAddHeaderFn(add_header_fn_t /*fn*/) {}
+
     static ptr_t CreateIoReader(const Connection::ptr_t& conn,
                                 Context& ctx, const ReadConfig& cfg);
     static ptr_t CreateGzipReader(std::unique_ptr<DataReader>&& source);
     static ptr_t CreateZipReader(std::unique_ptr<DataReader>&& source);
+
+    /*! Readers that decompress the whole body in one operation
+     *
+     * They read all of the compressed body before they return
+     * the decompressed data in one buffer. Bodies that decompress to
+     * more than RESTC_CPP_SANE_DATA_LIMIT are streamed through zlib.
+     * Only available with libdeflate.
+     */
+    static ptr_t CreateGzipBufferReader(std::unique_ptr<DataReader>&& source,
+                                        size_t contentLength);
+    static ptr_t CreateZipBufferReader(std::unique_ptr<DataReader>&& source,
+                                       size_t contentLength);
+    static ptr_t CreateBrotliReader(std::unique_ptr<DataReader>&& source);
+    static ptr_t CreateZstdReader(std::unique_ptr<DataReader>&& source);
     static ptr_t CreatePlainReader(size_t contentLength, ptr_t&& source);
     static ptr_t CreateChunkedReader(add_header_fn_t, std::unique_ptr<DataReaderStream>&& source);
     static ptr_t CreateNoBodyReader();
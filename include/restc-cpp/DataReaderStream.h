@@ -28,9 +28,27 @@ public:
          return eof_;
      }
 
+    void SetContext(Context& ctx) override {
+        source_->SetContext(ctx);
+    }
+
     /*! Read whatever we have buffered or can get downstream */
     boost::asio::const_buffers_1 ReadSome() override;
 
+    bool CanReadInto() const noexcept override {
+        return source_->CanReadInto();
+    }
+
+    /*! Copy what we have buffered, or read directly from downstream */
+    std::size_t ReadInto(boost::asio::mutable_buffers_1 buffer) override;
+
+    /*! We can only splice when we have no buffered data */
+    bool CanSpliceTo() const noexcept override {
+        return GetBuffered().empty() && source_->CanSpliceTo();
+    }
+
+    std::size_t SpliceTo(int fd, std::size_t maxBytes) override;
+
     /*! Read up to maxBytes from whatever we have buffered or can get downstream.*/
     boost::asio::const_buffers_1 GetData(size_t maxBytes);
 
@@ -70,9 +88,25 @@ public:
     void ReadServerResponse(Reply::HttpResponse& response);
     void ReadHeaderLines(const add_header_fn_t& addHeader);
 
+    /*! Get the next line, without the CRLF
+     *
+     * The returned view is valid until the next read from the stream.
+     *
+     * \exception ConstraintException if the line is longer than maxLen
+     */
+    boost::string_ref GetLine(size_t maxLen);
+
+    /*! The data we have buffered, and can read without doing IO */
+    boost::string_ref GetBuffered() const noexcept {
+        if (!curr_ || ((curr_ + 1) >= end_)) {
+            return {};
+        }
+        return {curr_ + 1, static_cast<size_t>(end_ - curr_ - 1)};
+    }
+
 private:
     void Fetch();
-    std::string GetHeaderValue();
+    bool SkipContinuation();
 
     bool eof_ = false;
     const char *curr_ = nullptr;
@@ -80,6 +114,7 @@ private:
     size_t getc_bytes_ = 0;
     DataReader::ptr_t source_;
     size_t num_headers_ = 0;
+    std::string line_;
 };
 
 } // namespace
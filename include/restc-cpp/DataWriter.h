@@ -49,6 +49,23 @@ public:
     /*! Write without altering the data (headers) */
     virtual void WriteDirect(boost::asio::const_buffers_1 buffers) = 0;
 
+    /*! Write the headers unaltered, followed by some data.
+     *
+     * The headers and the data are sent to the network in one
+     * scatter/gather operation, so that a small request can leave
+     * in a single system call.
+     *
+     * The default implementation writes the headers and the data
+     * separately, for writers that don't implement it.
+     */
+    virtual void WriteDirect(boost::asio::const_buffers_1 headers,
+                             const write_buffers_t& buffers) {
+        WriteDirect(headers);
+        if (boost::asio::buffer_size(buffers)) {
+            Write(buffers);
+        }
+    }
+
     /*! Write some data */
     virtual void Write(const write_buffers_t& buffers) = 0;
 
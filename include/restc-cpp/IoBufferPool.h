@@ -0,0 +1,49 @@
+#pragma once
+#ifndef RESTC_CPP_IO_BUFFER_POOL_H_
+#define RESTC_CPP_IO_BUFFER_POOL_H_
+
+#ifndef RESTC_CPP_H_
+#       error "Include restc-cpp.h first"
+#endif
+
+#include <functional>
+#include <vector>
+
+namespace restc_cpp {
+
+/*! Pool of IO buffers, shared by the readers of a RestClient
+ *
+ * The readers borrow a buffer for each read, and return it when
+ * the data is consumed. Idle connections therefore hold no buffers.
+ * The exception is TLS connections. The TLS layer may have buffered
+ * data the socket knows nothing about, so their readers can't wait
+ * for data before they borrow the buffer.
+ *
+ * Buffers are handed out in power of two sizes between
+ * RESTC_CPP_IO_BUFFER_SIZE and Request::Properties::ioBufferMaxSize,
+ * as set for the client.
+ */
+class IoBufferPool
+{
+public:
+    using ptr_t = std::shared_ptr<IoBufferPool>;
+    using buffer_t = std::vector<char>;
+
+    /*! A borrowed buffer. It is returned to the pool when released. */
+    using handle_t = std::unique_ptr<buffer_t, std::function<void (buffer_t *)>>;
+
+    virtual ~IoBufferPool() = default;
+
+    /*! Borrow a buffer of at least size bytes (within the limits). */
+    virtual handle_t Get(std::size_t size) = 0;
+
+    /*! Bytes in the buffers that are kept in the pool for re-use. */
+    virtual std::size_t GetIdleBytes() const = 0;
+
+    static ptr_t Create(const Request::Properties& properties);
+};
+
+} // restc_cpp
+
+
+#endif // RESTC_CPP_IO_BUFFER_POOL_H_
@@ -1,5 +1,13 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include "restc-cpp/restc-cpp.h"
 #include "restc-cpp/SerializeJson.h"
 
@@ -165,7 +173,7 @@ private:
                     auto data = std::make_unique<objectT>();
                     RapidJsonDeserializer<objectT> handler(
                         *data, *properties_);
-                    json_reader_.Parse(reply_stream_, handler);
+                    json_reader_.Parse<rapidjson::kParseInsituFlag>(reply_stream_, handler);
                     return move(data);
                 } else if (ch == ']') {
                     reply_stream_.Take();
@@ -190,5 +198,485 @@ private:
     const serialize_properties_t *properties_ = nullptr;
 };
 
-} // namespace
+/*! Deserialize a json array a batch of elements at the time
+*
+* NextBatch() parses the next batchSize elements into a vector that is
+* re-used for every batch, and returns them as a span. The objects in the
+* vector are overwritten in place (as with reuse_existing_values), so
+* after the first batch, strings and containers in them keep their
+* memory, and there is only one handler per batch, not one per element.
+*
+* The objects in a batch are valid until the next call to NextBatch().
+* An empty batch means that the array is done.
+*
+* If a Context is given, the batches are parsed on a worker thread, one
+* batch ahead of the caller. The reply is then read by NextBatch() while
+* it waits for the worker, and passed to it like in
+* SerializeFromJsonPipelined(), so reading, parsing and the callers
+* processing of the previous batch overlap.
+*
+* BatchedIteratorFromJsonSerializer<Post> posts(*reply, ctx, 256);
+* for(auto batch = posts.NextBatch(); !batch.empty(); batch = posts.NextBatch()) {
+*     for(const auto& post : batch) {
+*         ...
+*     }
+* }
+*
+* The memory limit in the properties applies to each batch.
+*/
+template <typename objectT>
+class BatchedIteratorFromJsonSerializer
+{
+public:
+    using data_t = typename std::remove_const<typename std::remove_reference<objectT>::type>::type;
+
+    static constexpr std::size_t default_batch_size = 64;
+
+    //! A view of the objects in the current batch
+    class Batch {
+    public:
+        Batch() = default;
+
+        Batch(data_t *data, std::size_t size)
+        : data_{data}, size_{size} {}
+
+        data_t *begin() const noexcept { return data_; }
+        data_t *end() const noexcept { return data_ + size_; }
+        data_t *data() const noexcept { return data_; }
+        std::size_t size() const noexcept { return size_; }
+        bool empty() const noexcept { return size_ == 0; }
+
+        data_t& operator[](std::size_t index) const noexcept {
+            assert(index < size_);
+            return data_[index];
+        }
+
+    private:
+        data_t *data_ = nullptr;
+        std::size_t size_ = 0;
+    };
+
+    //! Parse the batches on the calling thread
+    BatchedIteratorFromJsonSerializer(
+        Reply& reply,
+        std::size_t batchSize = default_batch_size,
+        const serialize_properties_t *properties = nullptr)
+    : reply_{reply}, batch_size_{std::max<std::size_t>(batchSize, 1)}
+    , properties_{GetProperties(properties)}
+    , reply_stream_{std::make_unique<RapidJsonReader>(reply)}
+    {
+    }
+
+    //! Parse the next batch on a worker thread, while the caller processes the current one
+    BatchedIteratorFromJsonSerializer(
+        Reply& reply,
+        Context& ctx,
+        std::size_t batchSize = default_batch_size,
+        const serialize_properties_t *properties = nullptr)
+    : reply_{reply}, ctx_{&ctx}, batch_size_{std::max<std::size_t>(batchSize, 1)}
+    , properties_{GetProperties(properties)}
+    {
+        pipeline_ = std::make_unique<detail::JsonPipeline>(
+            properties_.pipeline_buffers, properties_.pipeline_buffer_size);
+        pipeline_stream_ = std::make_unique<
+            BasicRapidJsonReader<detail::JsonPipeline>>(*pipeline_);
+        worker_ = std::thread([this] { Prefetch(); });
+    }
+
+    BatchedIteratorFromJsonSerializer(const BatchedIteratorFromJsonSerializer&) = delete;
+    BatchedIteratorFromJsonSerializer& operator = (const BatchedIteratorFromJsonSerializer&) = delete;
+
+    ~BatchedIteratorFromJsonSerializer() {
+        StopWorker();
+    }
+
+    /*! Get the next batch of objects.
+    *
+    * The previous batch is overwritten. Returns an empty batch when
+    * there are no more elements in the array.
+    */
+    Batch NextBatch() {
+        if (done_) {
+            return {};
+        }
+
+        if (!pipeline_) {
+            auto& batch = slots_[0].objects;
+            try {
+                ParseBatch(*reply_stream_, batch);
+            } catch(...) {
+                done_ = true;
+                throw;
+            }
+            done_ = batch.empty();
+            return {batch.data(), batch.size()};
+        }
+
+        return NextPrefetchedBatch();
+    }
+
+private:
+    enum class State { PRE, ITERATING, DONE };
+
+    struct Slot {
+        std::vector<data_t> objects;
+        std::exception_ptr error;
+        bool last = false;
+        std::atomic<bool> ready{false}; // Owned by the caller when true
+    };
+
+    static serialize_properties_t GetProperties(const serialize_properties_t *properties) {
+        serialize_properties_t props;
+        if (properties) {
+            props = *properties;
+        }
+        props.reuse_existing_values = true;
+        return props;
+    }
+
+    template <typename streamT>
+    void ParseBatch(streamT& stream, std::vector<data_t>& batch) {
+        static const std::string err_msg{"BatchedIteratorFromJsonSerializer: Unexpected character in input stream: "};
+        static const std::string parse_error{"BatchedIteratorFromJsonSerializer: Failed to parse json array element"};
+
+        RapidJsonDeserializer<std::vector<data_t>> handler(batch, properties_);
+        handler.StartArray();
+        std::size_t count = 0;
+
+        if (state_ == State::PRE) {
+            stream.SkipWhitespace();
+            if (stream.Take() != '[') {
+                throw ParseException("Expected leading json '['");
+            }
+            stream.SkipWhitespace();
+            if (stream.Peek() == ']') {
+                stream.Take();
+                state_ = State::DONE;
+            } else {
+                state_ = State::ITERATING;
+            }
+        }
+
+        while((state_ == State::ITERATING) && (count < batch_size_)) {
+            json_reader_.Parse<rapidjson::kParseInsituFlag
+                | rapidjson::kParseStopWhenDoneFlag>(stream, handler);
+            if (json_reader_.HasParseError()) {
+                throw ParseException(parse_error);
+            }
+            ++count;
+
+            stream.SkipWhitespace();
+            const auto ch = stream.Take();
+            if (ch == ']') {
+                state_ = State::DONE;
+            } else if (ch != ',') {
+                throw ParseException(err_msg + std::string(1, ch));
+            }
+        }
+
+        handler.EndArray(static_cast<rapidjson::SizeType>(count));
+    }
+
+    // Runs on the worker thread
+    void Prefetch() {
+        for(std::size_t i = 0;; i ^= 1) {
+            auto& slot = slots_[i];
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cond_.wait(lock, [&] {
+                    return stop_ || !slot.ready;
+                });
+                if (stop_) {
+                    break;
+                }
+            }
+
+            try {
+                ParseBatch(*pipeline_stream_, slot.objects);
+                slot.last = (state_ == State::DONE);
+            } catch(...) {
+                slot.error = std::current_exception();
+                slot.last = true;
+            }
+
+            const bool last = slot.last;
+            slot.ready = true;
+            if (last) {
+                break;
+            }
+        }
+
+        pipeline_->SetDone();
+    }
+
+    Batch NextPrefetchedBatch() {
+        detail::PipelineBackoff backoff(properties_.pipeline_min_wait,
+                                        properties_.pipeline_max_wait);
+
+        if (current_ != none) {
+            // Let the worker re-use the previous batch
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                slots_[current_].ready = false;
+            }
+            cond_.notify_one();
+        }
+        current_ = next_;
+        next_ ^= 1;
+
+        auto& slot = slots_[current_];
+        try {
+            while(!slot.ready) {
+                std::size_t index = 0;
+                if (eof_ || !pipeline_->TryGetFreeBuffer(index)) {
+                    // The worker is behind
+                    backoff.Wait(*ctx_);
+                    continue;
+                }
+                backoff.Reset();
+                const auto bytes = reply_.ReadInto(pipeline_->GetBuffer(index));
+                pipeline_->Push(index, bytes);
+                eof_ = (bytes == 0);
+            }
+        } catch(...) {
+            done_ = true;
+            StopWorker();
+            throw;
+        }
+
+        done_ = slot.last;
+        if (slot.error) {
+            std::rethrow_exception(slot.error);
+        }
+        return {slot.objects.data(), slot.objects.size()};
+    }
+
+    void StopWorker() {
+        if (worker_.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stop_ = true;
+            }
+            cond_.notify_one();
+            pipeline_->Abort();
+            worker_.join();
+        }
+    }
+
+    static constexpr std::size_t none = 2;
+
+    Reply& reply_;
+    Context *ctx_ = nullptr;
+    const std::size_t batch_size_;
+    const serialize_properties_t properties_;
+    State state_ = State::PRE;
+    rapidjson::Reader json_reader_;
+    Slot slots_[2];
+    bool done_ = false;
+
+    // Parsing on the calling thread
+    std::unique_ptr<RapidJsonReader> reply_stream_;
+
+    // Parsing on the worker thread
+    std::unique_ptr<detail::JsonPipeline> pipeline_;
+    std::unique_ptr<BasicRapidJsonReader<detail::JsonPipeline>> pipeline_stream_;
+    std::size_t current_ = none; // The slot the caller has
+    std::size_t next_ = 0;
+    bool eof_ = false;
+    bool stop_ = false;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::thread worker_;
+};
 
+/*! Deserialize newline-delimited json (NDJSON, JSON Lines) from a reply
+*
+* Each line is one json document, deserialized to objectT as soon as
+* the line has arrived, so a stream that never ends can be consumed.
+* Empty lines are ignored, and the last line does not need a newline.
+*
+* Follows the InputIterator contract like IteratorFromJsonSerializer,
+* but there is only one object, that is overwritten in place (as with
+* reuse_existing_values) for each line. A reference to it is only valid
+* until the iterator is incremented. begin() reads the first line, so it
+* should only be called once.
+*
+* for(const auto& event : IteratorFromNdjsonSerializer<Event>(*reply)) {
+*     ...
+* }
+*
+* The data from the reply is copied into a buffer, where the lines are
+* found with memchr() (which is vectorized in the common C libraries),
+* and parsed in place. A line may not be longer than the memory limit in
+* the properties.
+*/
+template <typename objectT>
+class IteratorFromNdjsonSerializer
+{
+public:
+    using data_t = typename std::remove_const<typename std::remove_reference<objectT>::type>::type;
+
+    class Iterator : public std::iterator<
+        std::input_iterator_tag,
+        data_t,
+        std::ptrdiff_t,
+        const data_t *,
+        data_t&> {
+
+    public:
+        Iterator() {}
+
+        Iterator(IteratorFromNdjsonSerializer *owner)
+        : owner_{owner} {
+            fetch();
+        }
+
+        Iterator& operator++() {
+            if (!owner_) {
+                throw CannotIncrementEndException(
+                    "this is an end() iterator.");
+            }
+            fetch();
+            return *this;
+        }
+
+        bool operator == (const Iterator& other) const {
+            return owner_ == other.owner_;
+        }
+
+        bool operator != (const Iterator& other) const {
+            return ! operator == (other);
+        }
+
+        data_t& operator*() const {
+            if (!owner_) {
+                throw NoDataException("this is an end() iterator.");
+            }
+            return owner_->data_;
+        }
+
+        data_t *operator -> () const {
+            return &operator*();
+        }
+
+    private:
+        void fetch() {
+            if (!owner_->Fetch()) {
+                owner_ = nullptr;
+            }
+        }
+
+        IteratorFromNdjsonSerializer *owner_ = nullptr;
+    };
+
+    using iterator_t = Iterator;
+
+    IteratorFromNdjsonSerializer(
+        Reply& reply,
+        const serialize_properties_t *properties = nullptr)
+    : reply_{reply}, buffer_(default_buffer_size + 1)
+    {
+        if (properties) {
+            properties_ = *properties;
+        }
+        properties_.reuse_existing_values = true;
+    }
+
+    iterator_t begin() {
+        return Iterator{this};
+    }
+
+    iterator_t end() {
+        return Iterator{};
+    }
+
+private:
+    static constexpr std::size_t default_buffer_size = 1024 * 16;
+
+    // Deserialize the next line that is not empty
+    bool Fetch() {
+        while(char *line = NextLine()) {
+            ++line_;
+            if (line[strspn(line, " \t\r")] == 0) {
+                continue;
+            }
+
+            RapidJsonDeserializer<data_t> handler(data_, properties_);
+            rapidjson::InsituStringStream stream(line);
+            json_reader_.Parse<rapidjson::kParseInsituFlag>(stream, handler);
+            if (json_reader_.HasParseError()) {
+                static const std::string err_msg{"IteratorFromNdjsonSerializer: Failed to parse json on line "};
+                throw ParseException(err_msg + std::to_string(line_));
+            }
+            return true;
+        }
+        return false;
+    }
+
+    // Get the next line, with the newline replaced by a zero.
+    // Returns nullptr when there are no more lines.
+    char *NextLine() {
+        while(true) {
+            char *begin = buffer_.data() + begin_;
+            const auto len = end_ - begin_;
+            if (auto nl = static_cast<char *>(memchr(begin + scanned_, '\n', len - scanned_))) {
+                *nl = 0;
+                begin_ += static_cast<std::size_t>(nl + 1 - begin);
+                scanned_ = 0;
+                return begin;
+            }
+
+            if (properties_.GetMaxMemoryConsumption()
+                && (len > static_cast<std::size_t>(properties_.GetMaxMemoryConsumption()))) {
+                throw ConstraintException("IteratorFromNdjsonSerializer: The line is too long");
+            }
+            // Don't search the same data again
+            scanned_ = len;
+
+            if (!Read()) {
+                if (!len) {
+                    return nullptr;
+                }
+                // The last line, without a newline
+                buffer_[end_] = 0;
+                begin_ = end_;
+                scanned_ = 0;
+                return begin;
+            }
+        }
+    }
+
+    // Append data from the reply after the start of the current line
+    bool Read() {
+        const auto data = reply_.GetSomeData();
+        const auto bytes = boost::asio::buffer_size(data);
+        if (!bytes) {
+            return false;
+        }
+
+        const auto len = end_ - begin_;
+        if (begin_) {
+            memmove(buffer_.data(), buffer_.data() + begin_, len);
+            begin_ = 0;
+            end_ = len;
+        }
+        if (buffer_.size() < (len + bytes + 1)) { // Room for a zero after the data
+            buffer_.resize(std::max(len + bytes + 1, buffer_.size() * 2));
+        }
+        memcpy(buffer_.data() + end_, boost::asio::buffer_cast<const char *>(data), bytes);
+        end_ += bytes;
+        return true;
+    }
+
+    Reply& reply_;
+    serialize_properties_t properties_;
+    data_t data_;
+    rapidjson::Reader json_reader_;
+    std::vector<char> buffer_;
+    std::size_t begin_ = 0; // Start of the current line
+    std::size_t end_ = 0; // End of the data in the buffer
+    std::size_t scanned_ = 0; // Bytes after begin_ without a newline
+    std::size_t line_ = 0;
+};
+
+} // namespace
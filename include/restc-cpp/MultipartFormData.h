@@ -0,0 +1,131 @@
+#pragma once
+
+#ifndef RESTC_CPP_MULTIPART_FORM_DATA_H_
+#define RESTC_CPP_MULTIPART_FORM_DATA_H_
+
+#include <deque>
+#include <functional>
+
+#include <boost/filesystem.hpp>
+
+#include "restc-cpp/restc-cpp.h"
+#include "restc-cpp/DataWriter.h"
+
+namespace restc_cpp {
+
+/*! The parts of a multipart/form-data request body
+ *
+ * Nothing is read from the files or the providers before the
+ * body is sent, so the memory use does not depend on the size
+ * of the data.
+ *
+ * Use RequestBody::CreateMultipartBody() to create the body.
+ */
+class MultipartFormData {
+public:
+    /*! Pushes the data for a part to the writer */
+    using provider_fn_t = std::function<void (DataWriter& writer)>;
+
+    struct Part {
+        enum class Type {
+            /// The data is in the data member
+            STRING,
+
+            /// The data is read from the file at path
+            FILE,
+
+            /// The data is pushed by provider. The size is unknown.
+            PROVIDER
+        };
+
+        Type type = Type::STRING;
+        std::string name;
+        std::string fileName;
+        std::string contentType;
+        std::string data;
+        boost::filesystem::path path;
+        provider_fn_t provider;
+    };
+
+    using parts_t = std::deque<Part>;
+
+    /*! Add a form field */
+    MultipartFormData& AddString(std::string name, std::string value,
+                                 std::string contentType = {}) {
+        Part part;
+        part.name = std::move(name);
+        part.data = std::move(value);
+        part.contentType = std::move(contentType);
+        parts_.push_back(std::move(part));
+        return *this;
+    }
+
+    /*! Add a file
+     *
+     * \param name Name of the form field
+     * \param path Path to the file to upload
+     * \param contentType Content-Type of the part
+     * \param fileName File-name to send. Defaults to the file-name in path.
+     */
+    MultipartFormData& AddFile(std::string name,
+                               boost::filesystem::path path,
+                               std::string contentType
+                                    = "application/octet-stream",
+                               std::string fileName = {}) {
+        Part part;
+        part.type = Part::Type::FILE;
+        part.name = std::move(name);
+        part.fileName = fileName.empty()
+            ? path.filename().string() : std::move(fileName);
+        part.path = std::move(path);
+        part.contentType = std::move(contentType);
+        parts_.push_back(std::move(part));
+        return *this;
+    }
+
+    /*! Add a part where the data is supplied by a functor
+     *
+     * Since the size of the data is unknown, the body will be
+     * sent with chunked transfer encoding.
+     */
+    MultipartFormData& AddProvider(std::string name,
+                                   provider_fn_t provider,
+                                   std::string contentType
+                                        = "application/octet-stream",
+                                   std::string fileName = {}) {
+        Part part;
+        part.type = Part::Type::PROVIDER;
+        part.name = std::move(name);
+        part.fileName = std::move(fileName);
+        part.provider = std::move(provider);
+        part.contentType = std::move(contentType);
+        parts_.push_back(std::move(part));
+        return *this;
+    }
+
+    /*! Use a specific boundary. Normally a random one is generated.
+     *
+     * RequestBody::CreateMultipartBody() throws ConstraintException
+     * if the boundary occurs in the data of a string part.
+     */
+    MultipartFormData& SetBoundary(std::string boundary) {
+        boundary_ = std::move(boundary);
+        return *this;
+    }
+
+    const parts_t& GetParts() const noexcept {
+        return parts_;
+    }
+
+    const std::string& GetBoundary() const noexcept {
+        return boundary_;
+    }
+
+private:
+    parts_t parts_;
+    std::string boundary_;
+};
+
+} // restc_cpp
+
+#endif // RESTC_CPP_MULTIPART_FORM_DATA_H_
@@ -5,113 +5,256 @@
 
 
 #include <assert.h>
+#include <algorithm>
+#include <cstring>
+#include <vector>
 
-#include "rapidjson/reader.h"
+// Include first, so that the SIMD settings for rapidjson are in effect
 #include "restc-cpp/restc-cpp.h"
+#include "rapidjson/reader.h"
 
 namespace restc_cpp {
 
 
 /*! Rapidjson input stream implementation
+ *
+ * sourceT is a Reply, or something else with a GetSomeData() method
+ * that works like Reply::GetSomeData().
+ *
+ * The data from the source is copied into a buffer that we own, a
+ * block at the time, with a zero after the data. That keeps Peek()
+ * and Take() down to a pointer compare and increment, and lets us
+ * skip whitespace over the whole block (with SIMD instructions, if
+ * rapidjson is built with them).
+ *
+ * The stream supports rapidjson::kParseInsituFlag. Strings are then
+ * unescaped in place in the buffer, instead of being copied to the
+ * parsers stack. When a string continues into the next block, it is
+ * moved to the start of the buffer and the next data is appended
+ * after it, so that the string is always contiguous.
+ *
+ * The buffer may be given by the caller, so that it can be re-used
+ * for the next document instead of being allocated again.
  *
  * Ref: https://github.com/miloyip/rapidjson/blob/master/doc/stream.md
  */
-class RapidJsonReader {
+template <typename sourceT>
+class BasicRapidJsonReader {
 public:
+    static constexpr std::size_t default_block_size = 1024 * 16;
 
-    RapidJsonReader(Reply& reply)
-    : reply_{reply}
+    BasicRapidJsonReader(sourceT& source, std::size_t blockSize = default_block_size)
+    : BasicRapidJsonReader(source, own_buffer_, blockSize)
     {
-        Read();
     }
 
+    /*! Use the callers buffer
+     *
+     * It is resized to blockSize if it is smaller. It may grow while
+     * we read large strings.
+     */
+    BasicRapidJsonReader(sourceT& source, std::vector<char>& buffer,
+                         std::size_t blockSize = default_block_size)
+    : source_{source}, buffer_{buffer}
+    {
+        const auto size = std::max<std::size_t>(blockSize, 1) + 1;
+        if (buffer_.size() < size) {
+            buffer_.resize(size);
+        }
+        ch_ = end_ = buffer_.data();
+        *end_ = 0;
+    }
+
+    BasicRapidJsonReader(const BasicRapidJsonReader&) = delete;
+    BasicRapidJsonReader& operator = (const BasicRapidJsonReader&) = delete;
+
     using Ch = char;
 
     //! Read the current character from stream without moving the read cursor.
-    Ch Peek() const noexcept {
-        if (IsEof()) {
+    Ch Peek() {
+        if ((ch_ == end_) && !Fill()) {
             return 0; // EOF
         }
 
-        assert(ch_ && (ch_ != end_));
         return *ch_;
     }
 
     //! Read the current character from stream and moving the read cursor to next character.
     Ch Take() {
-        if (IsEof()) {
+        if ((ch_ == end_) && !Fill()) {
             return 0; // EOF
         }
 
-        assert(ch_ && (ch_ != end_));
-        const auto ch = *ch_;
-        ++pos_;
-
-        if (++ch_ == end_) {
-            Read();
-        }
-
-        return ch;
+        return *ch_++;
     }
 
     //! Get the current read cursor.
     //! \return Number of characters read from start.
-    size_t Tell() noexcept {
-        return pos_;
+    size_t Tell() const noexcept {
+        return offset_ + static_cast<size_t>(ch_ - buffer_.data());
+    }
+
+    bool IsEof() {
+        return (ch_ == end_) && !Fill();
     }
 
-    bool IsEof() const noexcept {
-        return ch_ == nullptr;
+    //! Skip spaces, tabs and line breaks
+    void SkipWhitespace() {
+        while(true) {
+#if defined(RAPIDJSON_SSE42) || defined(RAPIDJSON_SSE2) || defined(RAPIDJSON_NEON)
+            ch_ += rapidjson::SkipWhitespace_SIMD(ch_, end_) - ch_;
+#else
+            // The zero after the data stops the loop
+            while((*ch_ == ' ') || (*ch_ == '\n') || (*ch_ == '\r') || (*ch_ == '\t')) {
+                ++ch_;
+            }
+#endif
+            if ((ch_ != end_) || !Fill()) {
+                return;
+            }
+        }
     }
 
     //! Begin writing operation at the current read pointer.
     //! \return The begin writer pointer.
     Ch* PutBegin() {
-        assert(false);
-        return nullptr;
+        BufferString();
+        return write_ = ch_;
     }
 
     //! Write a character.
     void Put(Ch c) {
-        assert(false);
+        // Unescaping never makes a string longer
+        assert(write_ && (write_ < ch_));
+        *write_++ = c;
     }
 
     //! Flush the buffer.
     void Flush() {
-        assert (false);
     }
 
     //! End the writing operation.
     //! \param begin The begin write pointer returned by PutBegin().
     //! \return Number of characters written.
     size_t PutEnd(Ch* begin) {
-        assert(false);
-        return 0;
+        assert(write_ >= begin);
+        const auto len = static_cast<size_t>(write_ - begin);
+        write_ = nullptr;
+        return len;
     }
 
 private:
-    void Read() {
-        const auto buffer = reply_.GetSomeData();
+    size_t GetCapacity() const noexcept {
+        return buffer_.size() - 1;
+    }
+
+    // Called when all the data in the buffer is consumed
+    bool Fill() {
+        assert(ch_ == end_);
+        offset_ += static_cast<size_t>(ch_ - buffer_.data());
+        ch_ = end_ = buffer_.data();
+        return Append();
+    }
 
-        const auto len = boost::asio::buffer_size(buffer);
+    // Copy more data from the source after the data in the buffer.
+    // Returns false if there is no more data, or no room for it.
+    bool Append() {
+        if (!pending_len_) {
+            if (done_) {
+                return false;
+            }
+
+            const auto buffer = source_.GetSomeData();
+            pending_len_ = boost::asio::buffer_size(buffer);
+            if (!pending_len_) {
+                done_ = true;
+                return false;
+            }
+            pending_ = boost::asio::buffer_cast<const char*>(buffer);
+        }
 
-        if (len) {
-            ch_ = boost::asio::buffer_cast<const char*>(buffer);
+        const auto used = static_cast<size_t>(end_ - buffer_.data());
+        const auto bytes = std::min(GetCapacity() - used, pending_len_);
+        if (!bytes) {
+            return false;
+        }
+        memcpy(end_, pending_, bytes);
+        end_ += bytes;
+        *end_ = 0;
+        pending_ += bytes;
+        pending_len_ -= bytes;
+        return true;
+    }
+
+    // Make sure that the rest of the string starting at ch_, including
+    // the closing quote, is in the buffer. If the string is never
+    // terminated, we keep what we got, and let rapidjson report it.
+    void BufferString() {
+        size_t scanned = 0;
+        while(!FindClosingQuote(scanned)) {
+            const auto len = static_cast<size_t>(end_ - ch_);
+            if (ch_ != buffer_.data()) {
+                offset_ += static_cast<size_t>(ch_ - buffer_.data());
+                memmove(buffer_.data(), ch_, len);
+            } else if (len == GetCapacity()) {
+                // The string is larger than the buffer
+                buffer_.resize((GetCapacity() * 2) + 1);
+            }
+            ch_ = buffer_.data();
             end_ = ch_ + len;
-        } else {
-            ch_ = end_ = nullptr;
+            *end_ = 0;
+
+            if (!Append()) {
+                return;
+            }
         }
     }
 
-    const char *ch_ = nullptr;
-    const char *end_ = nullptr;
-    size_t pos_ = 0;
-    Reply& reply_;
+    // Look for an un-escaped '"' after ch_ + scanned. scanned is updated
+    // so that we don't scan the same bytes again after more data is read.
+    bool FindClosingQuote(size_t& scanned) const noexcept {
+        const char *p = ch_ + scanned;
+        while(const auto quote = static_cast<const char *>(
+            memchr(p, '"', static_cast<size_t>(end_ - p)))) {
+
+            const char *escape = quote;
+            while((escape != ch_) && (escape[-1] == '\\')) {
+                --escape;
+            }
+            if (((quote - escape) % 2) == 0) {
+                return true;
+            }
+            p = quote + 1;
+        }
+
+        scanned = static_cast<size_t>(end_ - ch_);
+        return false;
+    }
+
+    sourceT& source_;
+    std::vector<char> own_buffer_;
+    std::vector<char>& buffer_;
+    char *ch_ = nullptr;
+    char *end_ = nullptr; // Always points to a zero
+    char *write_ = nullptr;
+    size_t offset_ = 0; // Stream position of the start of the buffer
+    const char *pending_ = nullptr; // Data from the source not yet in the buffer
+    size_t pending_len_ = 0;
+    bool done_ = false;
 };
 
+using RapidJsonReader = BasicRapidJsonReader<Reply>;
 
+/*! Let rapidjson skip whitespace a block at the time.
+ *
+ * rapidjson calls SkipWhitespace(is) unqualified, so this overload is
+ * found through argument dependent lookup.
+ */
+template <typename sourceT>
+void SkipWhitespace(BasicRapidJsonReader<sourceT>& is) {
+    is.SkipWhitespace();
+}
 
 } // restc_cpp
 
 #endif //RESTC_CPP_RAPID_JSON_READER_H_
-
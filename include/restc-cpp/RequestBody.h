@@ -8,6 +8,8 @@
 
 namespace restc_cpp {
 
+class MultipartFormData;
+
 /*! The body of the request. */
 class RequestBody {
 public:
@@ -40,6 +42,15 @@ public:
         throw NotImplementedException("GetFixedSize()");
     }
 
+    /*! Set the headers required by the body.
+     *
+     * For example, a multipart body will set the Content-Type
+     * with the boundary.
+     */
+    virtual void SetHeaders(Request::headers_t& headers) {
+        ;
+    }
+
     // For unit testing
     virtual std::string GetCopyOfData() const {
         return {};
@@ -63,6 +74,15 @@ public:
      */
     static std::unique_ptr<RequestBody> CreateFileBody(
         boost::filesystem::path path);
+
+    /*! Create a multipart/form-data body
+     *
+     * The parts are streamed when the request is sent. If the size
+     * of all the parts is known, the Content-Length header is set.
+     * Else, the body is sent with chunked transfer encoding.
+     */
+    static std::unique_ptr<RequestBody> CreateMultipartBody(
+        MultipartFormData form);
 };
 
 } // restc_cpp
@@ -13,6 +13,7 @@
 //#include "restc-cpp/DataWriter.h"
 #include "restc-cpp/RequestBody.h"
 #include "restc-cpp/RequestBodyWriter.h"
+#include "restc-cpp/MultipartFormData.h"
 #include "rapidjson/writer.h"
 #include "rapidjson/stringbuffer.h"
 
@@ -285,6 +286,19 @@ public:
         return *this;
     }
 
+    /*! Send a multipart/form-data body
+     *
+     * The parts are streamed to the server, so files of any size
+     * can be uploaded without reading them into memory.
+     *
+     * \param form The parts to send
+     */
+    RequestBuilder& Multipart(MultipartFormData form) {
+        assert(!body_);
+        body_ = RequestBody::CreateMultipartBody(std::move(form));
+        return *this;
+    }
+
     /*! Disable compression */
     RequestBuilder& DisableCompression() {
         assert(!body_);
@@ -355,18 +369,30 @@ public:
     std::unique_ptr<Request> Build() {
         assert(ctx_);
         static const std::string accept_encoding{"Accept-Encoding"};
-        static const std::string gzip{"gzip"};
 #ifdef DEBUG
         assert(!built_);
         built_ = true;
 #endif
-#if RESTC_CPP_WITH_ZLIB
-        if (!disable_compression_) {
+        // The enabled encodings, the fastest to decompress first
+        static const std::string encodings = [] {
+            std::string list;
+#ifdef RESTC_CPP_WITH_ZSTD
+            list += ", zstd";
+#endif
+#ifdef RESTC_CPP_WITH_BROTLI
+            list += ", br";
+#endif
+#ifdef RESTC_CPP_WITH_ZLIB
+            list += ", gzip";
+#endif
+            return list.empty() ? list : list.substr(2);
+        }();
+
+        if (!disable_compression_ && !encodings.empty()) {
             if (!headers_ || (headers_->find(accept_encoding) == headers_->end())) {
-                Header(accept_encoding, gzip);
+                Header(accept_encoding, encodings);
             }
         }
-#endif
         return Request::Create(
             url_, type_, ctx_->GetClient(), move(body_), args_, headers_, auth_);
     }
@@ -0,0 +1,154 @@
+#pragma once
+#ifndef RESTC_CPP_RESPONSE_CACHE_H_
+#define RESTC_CPP_RESPONSE_CACHE_H_
+
+#ifndef RESTC_CPP_H_
+#       error "Include restc-cpp.h first"
+#endif
+
+#include <chrono>
+
+#include <boost/utility/string_ref.hpp>
+
+#include "restc-cpp/DataReader.h"
+
+namespace restc_cpp {
+
+/*! Private HTTP cache for GET replies (RFC 9111)
+ *
+ * Replies are stored according to their Cache-Control and Expires
+ * headers. A fresh entry is returned without contacting the server.
+ * A stale entry with a validator (ETag or Last-Modified) is
+ * revalidated with a conditional request, and if the server
+ * answers "304 Not Modified", the cached body is returned.
+ *
+ * Entries are kept in memory within a byte budget, and the least
+ * recently used are evicted first. If a directory is configured,
+ * entries are also written there, and entries that are not in memory
+ * are memory-mapped from their files. The files have a byte budget
+ * of their own, and the least recently used files are deleted first.
+ *
+ * The cache is enabled per request with
+ * Request::Properties::cacheResponses. Its limits and directory
+ * are set for the client, from the properties given to
+ * RestClient::Create().
+ *
+ * The cache also remembers permanent redirects of GET and HEAD
+ * requests, if Request::Properties::cachePermanentRedirects is set.
+ */
+class ResponseCache
+{
+public:
+    using ptr_t = std::shared_ptr<ResponseCache>;
+    using time_point_t = std::chrono::system_clock::time_point;
+
+    struct Entry {
+        Reply::HttpResponse response;
+        headers_t headers;
+
+        /*! The entry is fresh until this time */
+        time_point_t expires;
+
+        /*! The decoded body. Valid as long as the entry exists. */
+        boost::string_ref body;
+
+        /*! Owns the memory in body (a string or a mapped file) */
+        std::shared_ptr<const void> storage;
+
+        bool IsFresh(time_point_t now = std::chrono::system_clock::now()) const {
+            return now < expires;
+        }
+
+        bool HasValidator() const;
+
+        std::size_t GetSize() const noexcept;
+    };
+
+    using entry_t = std::shared_ptr<const Entry>;
+
+    /*! A cached permanent redirect */
+    struct Redirect {
+        /*! 301 or 308. 308 requires the method and body to be kept. */
+        int status_code = 301;
+        std::string location;
+    };
+
+    virtual ~ResponseCache() = default;
+
+    /*! Get an entry, fresh or stale. Returns nullptr if there is none. */
+    virtual entry_t Get(const std::string& key) = 0;
+
+    /*! Add or replace an entry */
+    virtual void Put(const std::string& key, entry_t entry) = 0;
+
+    virtual void Remove(const std::string& key) = 0;
+
+    /*! Bytes used by the entries in memory */
+    virtual std::size_t GetBytesInMemory() const = 0;
+
+    /*! Bodies larger than this are not stored */
+    virtual std::size_t GetMaxEntrySize() const noexcept = 0;
+
+    /*! Get a cached permanent redirect (301, 308) from url */
+    virtual boost::optional<Redirect>
+        GetPermanentRedirect(const std::string& url) = 0;
+
+    /*! Remember a permanent redirect
+     *
+     * The redirect is kept until it expires according to the
+     * Cache-Control or Expires headers of the reply, if any.
+     */
+    virtual void AddPermanentRedirect(const std::string& url,
+                                      const std::string& location,
+                                      const headers_t& headers,
+                                      int statusCode = 301) = 0;
+
+    /*! Forget the permanent redirect from url, if any */
+    virtual void RemovePermanentRedirect(const std::string& url) = 0;
+
+    /*! Wrap the body reader of a reply, and store the body when it is read.
+     *
+     * The body is only stored if the whole body is read, and it is no
+     * larger than GetMaxEntrySize().
+     */
+    virtual DataReader::ptr_t CreateStoringReader(
+        DataReader::ptr_t&& source,
+        const std::string& key,
+        std::shared_ptr<Entry> entry) = 0;
+
+    /*! Create an entry from the headers of a reply.
+     *
+     * \return nullptr if the reply cannot be stored.
+     */
+    static std::shared_ptr<Entry> CreateEntry(
+        const Reply::HttpResponse& response,
+        const headers_t& headers,
+        time_point_t now = std::chrono::system_clock::now());
+
+    /*! Create a new entry from a stale one and the headers of a
+     * "304 Not Modified" reply.
+     */
+    static entry_t Revalidate(const Entry& entry,
+                              const headers_t& headers,
+                              time_point_t now = std::chrono::system_clock::now());
+
+    /*! Check if the request headers allow us to use or store replies */
+    static bool IsRequestCacheable(const headers_t& headers);
+
+    /*! True if the request requires that a cached reply is revalidated */
+    static bool MustRevalidate(const headers_t& headers);
+
+    /*! Create a reader that returns the body of an entry */
+    static DataReader::ptr_t CreateReader(entry_t entry);
+
+    /*! Parse a HTTP-date (RFC 9110, 5.6.7) */
+    static boost::optional<time_point_t>
+        ParseHttpDate(const std::string& date);
+
+    static ptr_t Create(const Request::Properties& properties);
+};
+
+} // restc_cpp
+
+
+#endif // RESTC_CPP_RESPONSE_CACHE_H_
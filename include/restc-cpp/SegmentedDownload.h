@@ -0,0 +1,64 @@
+#pragma once
+#ifndef RESTC_CPP_SEGMENTED_DOWNLOAD_H_
+#define RESTC_CPP_SEGMENTED_DOWNLOAD_H_
+
+#ifndef RESTC_CPP_H_
+#       error "Include restc-cpp.h first"
+#endif
+
+namespace restc_cpp {
+
+/*! Download a large object as several parallel HTTP Range requests
+ *
+ * The size of the object is found with a HEAD request. If the
+ * server supports byte ranges and the object is large enough, it is
+ * split in segments that are fetched concurrently, each on its own
+ * (pooled) connection, and written directly to their part of the
+ * output file. A segment that fails is retried on its own.
+ *
+ * If the server does not report the size, or don't accept ranges,
+ * the object is downloaded with one plain GET request.
+ */
+class SegmentedDownload
+{
+public:
+    struct Config {
+        /*! Max number of segments to fetch concurrently */
+        std::size_t maxSegments = 4;
+
+        /*! Don't split the object in segments smaller than this */
+        std::uint64_t minSegmentSize = 1024 * 1024 * 4;
+
+        /*! Number of times we retry each failed segment */
+        int maxRetries = 3;
+
+        /*! Delay before the first retry. It is doubled for each retry. */
+        int retryDelayMs = 200;
+
+        /*! Extra headers to send with the requests */
+        headers_t headers;
+    };
+
+    /*! Download url to path.
+     *
+     * The download runs in the RestClients co-routines. Don't wait
+     * for the returned future from inside a co-routine.
+     *
+     * \return A future with the size of the downloaded object,
+     *      or the exception that caused the download to fail.
+     */
+    static std::future<std::uint64_t> Download(RestClient& client,
+                                               std::string url,
+                                               boost::filesystem::path path,
+                                               Config config);
+
+    static std::future<std::uint64_t> Download(RestClient& client,
+                                               std::string url,
+                                               boost::filesystem::path path);
+};
+
+} // restc_cpp
+
+
+#endif // RESTC_CPP_SEGMENTED_DOWNLOAD_H_
+
@@ -4,10 +4,19 @@
 #include <type_traits>
 #include <assert.h>
 #include <stack>
+#include <bitset>
 #include <set>
 #include <deque>
 #include <map>
-
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+
+#include <boost/algorithm/string/predicate.hpp>
 #include <boost/iterator/function_input_iterator.hpp>
 #include <boost/mpl/range_c.hpp>
 #include <boost/mpl/vector.hpp>
@@ -27,7 +36,13 @@
 #include "restc-cpp/restc-cpp.h"
 #include "restc-cpp/logging.h"
 #include "restc-cpp/RapidJsonReader.h"
+#include "restc-cpp/SimdJsonParser.h"
 #include "restc-cpp/internals/for_each_member.hpp"
+#include "restc-cpp/internals/field_index.hpp"
+#include "restc-cpp/internals/json_arena.hpp"
+#include "restc-cpp/internals/json_array_splitter.hpp"
+#include "restc-cpp/internals/json_keys.hpp"
+#include "restc-cpp/internals/json_pipeline.hpp"
 #include "restc-cpp/error.h"
 #include "restc-cpp/typename.h"
 #include "restc-cpp/RapidJsonWriter.h"
@@ -36,6 +51,15 @@
 #include "rapidjson/istreamwrapper.h"
 #include <rapidjson/ostreamwrapper.h>
 
+// std::pmr strings and containers in the deserialized objects
+#if defined(__has_include)
+#   if __has_include(<memory_resource>) \
+        && ((__cplusplus >= 201703L) || (defined(_MSVC_LANG) && (_MSVC_LANG >= 201703L)))
+#       include <memory_resource>
+#       define RESTC_CPP_HAVE_PMR 1
+#   endif
+#endif
+
 namespace restc_cpp {
 
 using excluded_names_t = std::set<std::string>;
@@ -151,21 +175,105 @@ struct SerializeProperties {
     : max_memory_consumption{GetDefaultMaxMemoryConsumption()}
     , ignore_empty_fileds{true}
     , ignore_unknown_properties{true}
+    , reuse_existing_values{false}
     {}
 
     explicit SerializeProperties(const bool ignoreEmptyFields)
     : max_memory_consumption{GetDefaultMaxMemoryConsumption()}
     , ignore_empty_fileds{ignoreEmptyFields}
     , ignore_unknown_properties{true}
+    , reuse_existing_values{false}
     {}
 
     uint64_t max_memory_consumption : 32;
     uint64_t ignore_empty_fileds : 1;
     uint64_t ignore_unknown_properties : 1;
 
+    /*! Overwrite the existing content of the object we deserialize to.
+     *
+     * Normally, new array items are appended to the containers in
+     * the object. With this flag, existing items are overwritten in
+     * place, so strings and containers keep their allocated memory,
+     * and surplus items are removed when the array ends. Members that
+     * are missing in the json are set to their default value, and
+     * maps are cleared before they are filled.
+     *
+     * This is useful when the same object is filled again and again,
+     * for example when polling a server.
+     */
+    uint64_t reuse_existing_values : 1;
+
     const std::set<std::string> *excluded_names = nullptr;
     const JsonFieldMapping *name_mapping = nullptr;
 
+    /*! The json keys, mapped and escaped, when name_mapping or
+     * excluded_names is set.
+     *
+     * RapidJsonSerializer, RapidJsonInserter and SerializeToJson()
+     * create it, so that the keys for each type are only built once.
+     * Reset it if the mapping or the excluded names are changed.
+     *
+     * When we deserialize with a name_mapping, the members are looked
+     * up in a table over the mapped names, which is kept here. Set it
+     * with use_json_key_cache() to build the tables once for several
+     * documents. Else they are built once per document.
+     */
+    std::shared_ptr<detail::JsonKeyCache> json_key_cache;
+
+    /*! Deserialize json arrays in replies with this many threads.
+     *
+     * When the object we deserialize to is a std::vector, std::deque or
+     * std::list, and the reply has a Content-Length below
+     * parallel_max_body_size bytes, the body is read into memory, and
+     * the elements of the array are deserialized in ranges, on their
+     * own threads. Larger replies, and compressed replies or replies
+     * without Content-Length, are deserialized while they are read. The ranges are
+     * appended to the container in order. Each thread may use up to
+     * max_memory_consumption bytes while it works; the total is checked
+     * when all the threads are done.
+     *
+     * Not used together with reuse_existing_values or memory_resource.
+     */
+    unsigned parallel_threads = 0;
+    std::size_t parallel_max_body_size = RESTC_CPP_SANE_DATA_LIMIT;
+
+    /*! The number and size of the buffers SerializeFromJsonPipelined()
+     * reads into, while the previous buffers are parsed.
+     */
+    unsigned pipeline_buffers = 3;
+    std::size_t pipeline_buffer_size = 1024 * 64;
+
+    /*! How long the reading coroutine sleeps while it waits for the
+     * parser to free a buffer or finish.
+     *
+     * The wait starts at pipeline_min_wait, and doubles each time
+     * the parser is still behind, up to pipeline_max_wait.
+     */
+    std::chrono::microseconds pipeline_min_wait{20};
+    std::chrono::microseconds pipeline_max_wait{2000};
+
+#ifdef RESTC_CPP_HAVE_PMR
+    /*! Memory resource for the std::pmr strings, containers and maps
+     * created when we deserialize.
+     *
+     * Empty std::pmr members are re-created with this resource before
+     * they are filled, so the whole document can be released at
+     * once, for example with a std::pmr::monotonic_buffer_resource.
+     * The resource must outlive the deserialized objects.
+     */
+    std::pmr::memory_resource *memory_resource = nullptr;
+#endif
+
+#ifdef RESTC_CPP_WITH_SIMDJSON
+    /*! Replies with a Content-Length up to this size are read into
+     * memory and parsed with simdjson.
+     *
+     * Larger replies, and replies without a Content-Length, are parsed
+     * with rapidjson while they are read. Set to 0 to always use rapidjson.
+     */
+    std::size_t simdjson_max_body_size = RESTC_CPP_SANE_DATA_LIMIT;
+#endif
+
     constexpr static uint64_t GetDefaultMaxMemoryConsumption() { return 1024 * 1024; }
 
     bool is_excluded(const std::string& name) const noexcept {
@@ -192,6 +300,7 @@ struct SerializeProperties {
 };
 
 using serialize_properties_t = SerializeProperties;
+using JsonDeserializerContext = detail::JsonDeserializerContext;
 
 namespace {
 
@@ -441,11 +550,84 @@ struct is_map {
     constexpr static const bool value = false;
 };
 
-template <typename T, typename CompareT, typename AllocT>
-struct is_map<std::map<std::string, T, CompareT, AllocT> > {
+template <typename T, typename TraitsT, typename StrAllocT, typename CompareT, typename AllocT>
+struct is_map<std::map<std::basic_string<char, TraitsT, StrAllocT>, T, CompareT, AllocT> > {
     constexpr static const bool value = true;
 };
 
+template <typename T>
+struct is_string {
+    constexpr static const bool value = false;
+};
+
+template <typename TraitsT, typename AllocT>
+struct is_string<std::basic_string<char, TraitsT, AllocT> > {
+    constexpr static const bool value = true;
+};
+
+// Get a key for a map, with the maps allocator
+template <typename mapT>
+const std::string& to_map_key(const std::string& name, const mapT&,
+    typename std::enable_if<
+        std::is_same<typename mapT::key_type, std::string>::value
+        >::type* = 0) {
+    return name;
+}
+
+template <typename mapT>
+typename mapT::key_type to_map_key(const std::string& name, const mapT& map,
+    typename std::enable_if<
+        !std::is_same<typename mapT::key_type, std::string>::value
+        >::type* = 0) {
+    return typename mapT::key_type(name.data(), name.size(), map.get_allocator());
+}
+
+#ifdef RESTC_CPP_HAVE_PMR
+template <typename T, typename = void>
+struct uses_memory_resource {
+    constexpr static const bool value = false;
+};
+
+template <typename T>
+struct uses_memory_resource<T, std::void_t<typename T::allocator_type> > {
+    constexpr static const bool value = std::is_same<typename T::allocator_type,
+        std::pmr::polymorphic_allocator<typename T::value_type> >::value;
+};
+
+/*! Let a std::pmr string or container allocate from properties.memory_resource
+ *
+ * The allocator of a pmr object cannot be changed by assignment,
+ * so we re-create the object with the right resource. Objects with
+ * content are left alone, unless discardContent is set.
+ */
+template <typename T>
+void use_memory_resource(T& value, const serialize_properties_t& properties,
+    bool discardContent = false,
+    typename std::enable_if<uses_memory_resource<T>::value>::type* = 0) {
+
+    auto *resource = properties.memory_resource;
+    if (!resource
+        || (value.get_allocator().resource() == resource)
+        || (!value.empty() && !discardContent)) {
+        return;
+    }
+
+    value.~T();
+    new (&value) T(typename T::allocator_type{resource});
+}
+
+template <typename T>
+void use_memory_resource(T&, const serialize_properties_t&,
+    bool discardContent = false,
+    typename std::enable_if<!uses_memory_resource<T>::value>::type* = 0) {
+}
+#else
+template <typename T>
+void use_memory_resource(T&, const serialize_properties_t&,
+    bool discardContent = false) {
+}
+#endif
+
 
 template <typename T>
 struct is_container {
@@ -469,6 +651,84 @@ struct is_container<std::deque<T,Alloc> > {
     using data_t = T;
 };
 
+template <typename T, typename = void>
+struct member_count {
+    constexpr static const std::size_t value = 0;
+};
+
+template <typename T>
+struct member_count<T, typename std::enable_if<
+        boost::fusion::traits::is_sequence<T>::value
+        >::type> {
+    constexpr static const std::size_t value = boost::fusion::result_of::size<T>::value;
+};
+
+template <typename T, bool = is_container<T>::value>
+struct container_iterator {
+    using type = int; // Not used
+};
+
+template <typename T>
+struct container_iterator<T, true> {
+    using type = typename T::iterator;
+};
+
+// Set a value to its default, keeping the memory it has allocated if we can
+template <typename T>
+void reset_value(T& value, const T& defaults,
+    typename std::enable_if<
+        boost::fusion::traits::is_sequence<T>::value
+        >::type* = 0);
+
+template <typename T>
+void reset_value(T& value, const T& defaults,
+    typename std::enable_if<
+        is_container<T>::value || is_map<T>::value
+        >::type* = 0) {
+    if (defaults.empty()) {
+        value.clear();
+    } else {
+        value.~T();
+        new (&value) T(defaults);
+    }
+}
+
+template <typename T>
+void reset_value(T& value, const T& defaults,
+    typename std::enable_if<
+        !boost::fusion::traits::is_sequence<T>::value
+        && !is_container<T>::value && !is_map<T>::value
+        && std::is_copy_assignable<T>::value
+        >::type* = 0) {
+    value = defaults;
+}
+
+template <typename T>
+void reset_value(T& value, const T& defaults,
+    typename std::enable_if<
+        !boost::fusion::traits::is_sequence<T>::value
+        && !is_container<T>::value && !is_map<T>::value
+        && !std::is_copy_assignable<T>::value
+        >::type* = 0) {
+    value.~T();
+    new (&value) T(defaults);
+}
+
+template <typename T, size_t... I>
+void reset_members(T& value, const T& defaults, std::index_sequence<I...>) {
+    const int expand[] = {0, (reset_value(boost::fusion::at_c<I>(value),
+                                          boost::fusion::at_c<I>(defaults)), 0)...};
+    (void)expand;
+}
+
+template <typename T>
+void reset_value(T& value, const T& defaults,
+    typename std::enable_if<
+        boost::fusion::traits::is_sequence<T>::value
+        >::type*) {
+    reset_members(value, defaults, std::make_index_sequence<member_count<T>::value>());
+}
+
 class RapidJsonSkipObject :  public RapidJsonDeserializerBase {
 public:
 
@@ -580,6 +840,9 @@ public:
     , properties_{*properties_buffer_}
     , bytes_buffer_{properties_.GetMaxMemoryConsumption()}
     , bytes_{bytes_buffer_ ? &bytes_buffer_ : nullptr}
+    , context_buffer_{std::make_unique<detail::JsonDeserializerContext>()}
+    , context_{*context_buffer_}
+    , current_name_{context_.current_name}
     {}
 
     explicit RapidJsonDeserializer(data_t& object, const serialize_properties_t& properties)
@@ -588,18 +851,51 @@ public:
     , properties_{properties}
     , bytes_buffer_{properties_.GetMaxMemoryConsumption()}
     , bytes_{bytes_buffer_ ? &bytes_buffer_ : nullptr}
-    {}
+    , context_buffer_{std::make_unique<detail::JsonDeserializerContext>()}
+    , context_{*context_buffer_}
+    , current_name_{context_.current_name}
+    {
+        use_memory_resource(object_, properties_);
+    }
+
+    /*! Use the callers context, so that its memory is re-used
+     *
+     * The context must not be used by another deserializer at the
+     * same time.
+     */
+    explicit RapidJsonDeserializer(data_t& object, const serialize_properties_t& properties,
+                                   detail::JsonDeserializerContext& context)
+    : RapidJsonDeserializerBase(nullptr)
+    , object_{object}
+    , properties_{properties}
+    , bytes_buffer_{properties_.GetMaxMemoryConsumption()}
+    , bytes_{bytes_buffer_ ? &bytes_buffer_ : nullptr}
+    , context_{context}
+    , current_name_{context_.current_name}
+    {
+        context_.Reset();
+        use_memory_resource(object_, properties_);
+    }
 
     explicit RapidJsonDeserializer(data_t& object,
                         RapidJsonDeserializerBase *parent,
                         const serialize_properties_t& properties,
-                        std::int64_t *maxBytes)
+                        std::int64_t *maxBytes,
+                        detail::JsonDeserializerContext& context)
     : RapidJsonDeserializerBase(parent)
     , object_{object}
     , properties_{properties}
     , bytes_{maxBytes}
+    , context_{context}
+    , current_name_{context_.current_name}
     {
         assert(parent != nullptr);
+        use_memory_resource(object_, properties_);
+    }
+
+    /*! Bytes counted against max_memory_consumption so far */
+    std::int64_t GetUsedBytes() const noexcept {
+        return bytes_ ? (properties_.GetMaxMemoryConsumption() - *bytes_) : 0;
     }
 
     bool Null() override {
@@ -695,8 +991,8 @@ private:
 
         auto& value = const_cast<field_type_t&>(item);
 
-        recursed_to_ = std::make_unique<RapidJsonDeserializer<field_type_t>>(
-            value, this, properties_, bytes_);
+        recursed_to_ = context_.arena.template Create<RapidJsonDeserializer<field_type_t>>(
+            value, this, properties_, bytes_, context_);
     }
 
     template <typename classT, typename itemT>
@@ -717,13 +1013,11 @@ private:
             && is_container<dataT>::value
             >::type* = 0) {
 
-        object_.push_back({});
-
         using native_type_t = typename std::remove_const<
             typename std::remove_reference<typename dataT::value_type>::type>::type;
-        recursed_to_ = std::make_unique<RapidJsonDeserializer<native_type_t>>(
-            object_.back(), this, properties_, bytes_);
-        saved_state_.push(state_);
+        recursed_to_ = context_.arena.template Create<RapidJsonDeserializer<native_type_t>>(
+            NextElement<dataT>(), this, properties_, bytes_, context_);
+        saved_state_ = state_;
         state_ = State::RECURSED;
     }
 
@@ -743,40 +1037,100 @@ private:
         assert(false);
     }
 
+    // Get the next item in the array we fill, re-using an existing one if we can
+    template <typename dataT>
+    typename dataT::value_type& NextElement() {
+        if (reuse_elements_) {
+            if (next_element_ != object_.end()) {
+                ++reused_elements_;
+                return *next_element_++;
+            }
+            // Appending may invalidate next_element_
+            reuse_elements_ = false;
+        }
+
+        object_.emplace_back();
+        return object_.back();
+    }
 
     template <typename dataT>
-    void RecurseToMember(typename std::enable_if<
+    void StartReusingElements(typename std::enable_if<is_container<dataT>::value>::type* = 0) {
+        reuse_elements_ = properties_.reuse_existing_values;
+        next_element_ = object_.begin();
+        reused_elements_ = 0;
+    }
+
+    template <typename dataT>
+    void StartReusingElements(typename std::enable_if<!is_container<dataT>::value>::type* = 0) {
+    }
+
+    // Remove the items we did not re-use
+    template <typename dataT>
+    void EraseUnusedElements(typename std::enable_if<is_container<dataT>::value>::type* = 0) {
+        if (reuse_elements_) {
+            // resize() does not require the items to be assignable
+            object_.resize(reused_elements_);
+            reuse_elements_ = false;
+        }
+    }
+
+    template <typename dataT>
+    void EraseUnusedElements(typename std::enable_if<!is_container<dataT>::value>::type* = 0) {
+    }
+
+    template <typename dataT>
+    void StartReusingMembers(typename std::enable_if<is_map<dataT>::value>::type* = 0) {
+        if (properties_.reuse_existing_values) {
+            object_.clear();
+        }
+    }
+
+    template <typename dataT>
+    void StartReusingMembers(typename std::enable_if<!is_map<dataT>::value>::type* = 0) {
+        seen_members_.reset();
+    }
+
+    // Set the members that was not in the json to their default value
+    template <typename dataT>
+    void ResetUnseenMembers(typename std::enable_if<
             boost::fusion::traits::is_sequence<dataT>::value
             >::type* = 0) {
-        assert(!recursed_to_);
-        assert(!current_name_.empty());
-
-        bool found = false;
+        if (properties_.reuse_existing_values && !seen_members_.all()) {
+            ResetUnseenMembers<dataT>(std::make_index_sequence<member_count<dataT>::value>());
+        }
+    }
 
-        auto fn = [&](const char *name, auto& val) {
-            if (found) {
-                return;
-            }
+    template <typename dataT, size_t... I>
+    void ResetUnseenMembers(std::index_sequence<I...>) {
+        static const dataT defaults = dataT();
+        const int expand[] = {0, (seen_members_[I] ? 0
+            : (reset_value(boost::fusion::at_c<I>(object_), boost::fusion::at_c<I>(defaults)), 0))...};
+        (void)expand;
+    }
 
-            if (strcmp(name, current_name_.c_str()) == 0) {
-                using const_field_type_t = decltype(val);
-                using native_field_type_t = typename std::remove_const<typename std::remove_reference<const_field_type_t>::type>::type;
+    template <typename dataT>
+    void ResetUnseenMembers(typename std::enable_if<
+            !boost::fusion::traits::is_sequence<dataT>::value
+            >::type* = 0) {
+    }
 
-                /* Very obscure. g++ 5.3 is unable to resolve the symbol below
-                * without "this". I don't know if this is according to the
-                * standard or a bug. It works without in clang 3.6.
-                */
-                this->DoRecurseToMember<native_field_type_t>(val);
-                found = true;
-            }
 
-        };
+    template <typename dataT>
+    void RecurseToMember(typename std::enable_if<
+            boost::fusion::traits::is_sequence<dataT>::value
+            >::type* = 0) {
+        assert(!recursed_to_);
+        assert(!current_name_.empty());
 
-        on_name_and_value<dataT, decltype(fn)> handler(fn);
-        handler.for_each_member(object_);
+        const auto index = GetFieldIndex<dataT>().Find(current_name_);
+        if (index >= 0) {
+            seen_members_.set(static_cast<size_t>(index));
+            RecurseToMemberAt<dataT>(static_cast<size_t>(index),
+                std::make_index_sequence<detail::FieldIndex<dataT>::size>());
+        }
 
         if (!recursed_to_) {
-            assert(!found);
+            assert(index < 0);
             RESTC_CPP_LOG_DEBUG << "RecurseToMember(): Failed to find property-name '"
                 << current_name_
                 << "' in C++ class '" << RESTC_CPP_TYPENAME(dataT)
@@ -785,18 +1139,59 @@ private:
             if (!properties_.ignore_unknown_properties) {
                 throw UnknownPropertyException(current_name_);
             } else {
-                recursed_to_ = std::make_unique<RapidJsonSkipObject>(this);
+                recursed_to_ = context_.arena.template Create<RapidJsonSkipObject>(this);
             }
-        } else {
-            assert(found);
         }
 
         assert(recursed_to_);
-        saved_state_.push(state_);
+        saved_state_ = state_;
         state_ = State::RECURSED;
         current_name_.clear();
     }
 
+    // The index over the member names, or over their json names
+    template <typename dataT>
+    const detail::FieldIndex<dataT>& GetFieldIndex() {
+        const auto *mapping = properties_.name_mapping;
+        if (mapping == nullptr) {
+            return detail::FieldIndex<dataT>::Get();
+        }
+
+        auto *cache = properties_.json_key_cache.get();
+        if (cache == nullptr) {
+            if (!context_.json_key_cache) {
+                context_.json_key_cache = std::make_shared<detail::JsonKeyCache>();
+            }
+            cache = context_.json_key_cache.get();
+        }
+
+        return cache->GetFieldIndex<dataT>(
+            [mapping](const std::string& name) -> const std::string& {
+                return mapping->to_json_name(name);
+            });
+    }
+
+    // Dispatch to the member at index, with one function per member
+    template <typename dataT, size_t... I>
+    void RecurseToMemberAt(size_t index, std::index_sequence<I...>) {
+        using fn_t = void (RapidJsonDeserializer::*)();
+        static const std::array<fn_t, sizeof...(I)> members = {{
+            &RapidJsonDeserializer::RecurseToMemberAt<dataT, I>...}};
+
+        assert(index < members.size());
+        (this->*members[index])();
+    }
+
+    template <typename dataT, size_t I>
+    void RecurseToMemberAt() {
+        auto& val = boost::fusion::at_c<I>(object_);
+
+        using const_field_type_t = decltype(val);
+        using native_field_type_t = typename std::remove_const<typename std::remove_reference<const_field_type_t>::type>::type;
+
+        this->DoRecurseToMember<native_field_type_t>(val);
+    }
+
     template <typename dataT>
     void RecurseToMember( typename std::enable_if<
             !boost::fusion::traits::is_sequence<dataT>::value
@@ -811,35 +1206,12 @@ private:
             >::type* = 0) {
         assert(!current_name_.empty());
 
-        bool found = false;
-
-        auto fn = [&](const char *name, auto& val) {
-            if (found) {
-                return;
-            }
-
-            if (strcmp(name, current_name_.c_str()) == 0) {
-
-                const auto& new_value_ = new_value;
-
-                using const_field_type_t = decltype(val);
-                using native_field_type_t = typename std::remove_const<
-                    typename std::remove_reference<const_field_type_t>::type>::type;
-                using field_type_t = typename std::add_lvalue_reference<native_field_type_t>::type;
-
-                auto& value = const_cast<field_type_t&>(val);
-
-                this->AddBytes(get_len<decltype(new_value_)>()(new_value_));
-                assign_value<decltype(value), decltype(new_value_)>(value, new_value_);
-                found = true;
-            }
-        };
-
-        on_name_and_value<dataT, decltype(fn)> handler(fn);
-        handler.for_each_member(object_);
-
-        if (!found) {
-            assert(!found);
+        const auto index = GetFieldIndex<dataT>().Find(current_name_);
+        if (index >= 0) {
+            seen_members_.set(static_cast<size_t>(index));
+            SetValueOnMemberAt<dataT>(new_value, static_cast<size_t>(index),
+                std::make_index_sequence<detail::FieldIndex<dataT>::size>());
+        } else {
             RESTC_CPP_LOG_DEBUG << "SetValueOnMember(): Failed to find property-name '"
                 << current_name_
                 << "' in C++ class '" << RESTC_CPP_TYPENAME(dataT)
@@ -854,6 +1226,27 @@ private:
         return true;
     }
 
+    template<typename dataT, typename argT, size_t... I>
+    void SetValueOnMemberAt(const argT& new_value, size_t index,
+                            std::index_sequence<I...>) {
+        using fn_t = void (RapidJsonDeserializer::*)(const argT&);
+        static const std::array<fn_t, sizeof...(I)> members = {{
+            &RapidJsonDeserializer::SetValueOnMemberAt<dataT, argT, I>...}};
+
+        assert(index < members.size());
+        (this->*members[index])(new_value);
+    }
+
+    template<typename dataT, typename argT, size_t I>
+    void SetValueOnMemberAt(const argT& new_value) {
+        const auto& new_value_ = new_value;
+        auto& value = boost::fusion::at_c<I>(object_);
+
+        this->AddBytes(get_len<decltype(new_value_)>()(new_value_));
+        use_memory_resource(value, properties_, true);
+        assign_value<decltype(value), decltype(new_value_)>(value, new_value_);
+    }
+
     // std::map / the key must be a string.
     template<typename dataT, typename argT>
     bool SetValueOnMember(const argT& val,
@@ -869,7 +1262,7 @@ private:
             + sizeof(size_t) * 6 // FIXME: Find approximate average overhead for map
         );
 
-		assign_value(object_[current_name_], val);
+        assign_value(object_[to_map_key(current_name_, object_)], val);
         current_name_.clear();
         return true;
     }
@@ -901,8 +1294,8 @@ private:
             + sizeof(size_t) * 3 // Approximate average overhead for container
         );
 
-        object_.push_back({});
-        assign_value<decltype(object_.back()), decltype(val)>(object_.back(), val);
+        auto& item = NextElement<dataT>();
+        assign_value<decltype(item), decltype(val)>(item, val);
     }
 
     template<typename dataT, typename argT>
@@ -926,7 +1319,7 @@ private:
     }
 
     template<typename argT>
-    bool SetValue(argT val) {
+    bool SetValue(const argT& val) {
 #ifdef RESTC_CPP_LOG_JSON_SERIALIZATION
         RESTC_CPP_LOG_TRACE << RESTC_CPP_TYPENAME(data_t)
             << " SetValue: " << current_name_
@@ -978,7 +1371,9 @@ private:
     }
 
     bool DoString(const char* str, std::size_t length, bool copy) {
-        return SetValue(std::string(str, length));
+        // Re-use the buffer, so we only allocate when we copy to the target
+        context_.string_value.assign(str, length);
+        return SetValue(context_.string_value);
     }
 
     bool DoRawNumber(const char* str, std::size_t length, bool copy) {
@@ -997,6 +1392,7 @@ private:
 
             case State::INIT:
                 state_ = State::IN_OBJECT;
+                StartReusingMembers<data_t>();
                 break;
             case State::IN_OBJECT:
                 RecurseToMember<data_t>();
@@ -1013,6 +1409,7 @@ private:
             case State::DONE:
                 RESTC_CPP_LOG_TRACE << "Re-using instance of RapidJsonDeserializer";
                 state_ = State::IN_OBJECT;
+                StartReusingMembers<data_t>();
                 if (bytes_) {
                     *bytes_ = properties_.GetMaxMemoryConsumption();
                 }
@@ -1024,14 +1421,19 @@ private:
         return true;
     }
 
+    /* The member names of a struct are looked up by their json names
+     * in GetFieldIndex(). Other keys, like the keys of maps, are mapped
+     * here.
+     */
     bool DoKey(const char* str, std::size_t length, bool copy) {
         assert(current_name_.empty());
 
-        if (properties_.name_mapping == nullptr) {
+        if ((properties_.name_mapping == nullptr)
+            || boost::fusion::traits::is_sequence<data_t>::value) {
             current_name_.assign(str, length);
         } else {
-            std::string name{str, length};
-            current_name_ = properties_.name_mapping->to_native_name(name);
+            context_.json_name.assign(str, length);
+            current_name_ = properties_.name_mapping->to_native_name(context_.json_name);
         }
 #ifdef RESTC_CPP_LOG_JSON_SERIALIZATION
         RESTC_CPP_LOG_TRACE << RESTC_CPP_TYPENAME(data_t)
@@ -1049,6 +1451,7 @@ private:
 
         switch (state_) {
             case State::IN_OBJECT:
+                ResetUnseenMembers<data_t>();
                 state_ = State::DONE;
                 break;
             case State::IN_ARRAY:
@@ -1075,6 +1478,7 @@ private:
         switch (state_) {
             case State::INIT:
                 state_ = State::IN_ARRAY;
+                StartReusingElements<data_t>();
                 break;
             case State::IN_ARRAY:
                 RecurseToContainerValue<data_t>();
@@ -1103,6 +1507,7 @@ private:
                 assert(false); // FIXME?
                 break;
             case State::IN_ARRAY:
+                EraseUnusedElements<data_t>();
                 state_ = State::DONE;
                 break;
             default:
@@ -1124,10 +1529,8 @@ private:
             << " OnChildIsDone";
 #endif
         assert(state_ == State::RECURSED);
-        assert(!saved_state_.empty());
 
-        state_ = saved_state_.top();
-        saved_state_.pop();
+        state_ = saved_state_;
         recursed_to_.reset();
     }
 
@@ -1152,11 +1555,20 @@ private:
     std::int64_t bytes_buffer_ = {};
     std::int64_t *bytes_ = &bytes_buffer_;
 
-    //const JsonFieldMapping *name_mapping_ = nullptr;
-    std::string current_name_;
+    // The root object owns the arena for the child objects and the key
+    // buffer. Child objects gets a reference in the constructor.
+    std::unique_ptr<detail::JsonDeserializerContext> context_buffer_;
+    detail::JsonDeserializerContext& context_;
+    std::string& current_name_;
     State state_ = State::INIT;
-    std::stack<State> saved_state_;
-    std::unique_ptr<RapidJsonDeserializerBase> recursed_to_;
+    State saved_state_ = State::INIT;
+    detail::JsonArena::ptr_t<RapidJsonDeserializerBase> recursed_to_;
+
+    // Used with reuse_existing_values
+    std::bitset<member_count<data_t>::value> seen_members_;
+    typename container_iterator<data_t>::type next_element_ = {};
+    std::size_t reused_elements_ = 0;
+    bool reuse_elements_ = false;
 };
 
 
@@ -1166,7 +1578,7 @@ constexpr bool is_empty_field_(const T& value,
     typename std::enable_if<
         !std::is_integral<T>::value
         && !std::is_floating_point<T>::value
-        && !std::is_same<T, std::string>::value
+        && !is_string<T>::value
         && !is_container<T>::value
         >::type* = 0) {
 
@@ -1185,7 +1597,7 @@ constexpr bool is_empty_field_(const T& value,
 template <typename T>
 constexpr bool is_empty_field_(const T& value,
     typename std::enable_if<
-        std::is_same<T, std::string>::value || is_container<T>::value
+        is_string<T>::value || is_container<T>::value
         >::type* = 0) {
     return value.empty();
 }
@@ -1250,7 +1662,7 @@ void do_serialize(const dataT& object, serializerT& serializer,
         !boost::fusion::traits::is_sequence<dataT>::value
         && !std::is_integral<dataT>::value
         && !std::is_floating_point<dataT>::value
-        && !std::is_same<dataT, std::string>::value
+        && !is_string<dataT>::value
         && !is_container<dataT>::value
         && !is_map<dataT>::value
         >::type* = 0) {
@@ -1272,7 +1684,7 @@ template <typename dataT, typename serializerT>
 void do_serialize(const dataT& object, serializerT& serializer,
                 const serialize_properties_t& properties,
     typename std::enable_if<
-        std::is_same<dataT, std::string>::value
+        is_string<dataT>::value
         >::type* = 0) {
 
     serializer.String(object.c_str(),
@@ -1287,6 +1699,50 @@ void do_serialize(const dataT& object, serializerT& serializer,
         boost::fusion::traits::is_sequence<dataT>::value
         >::type* = 0);
 
+// The mapped and escaped json keys for the members of dataT,
+// or nullptr if they must be mapped as we go.
+template <typename dataT>
+const detail::JsonKeys<dataT> *get_json_keys(const serialize_properties_t& properties) {
+    if (!properties.name_mapping && !properties.excluded_names) {
+        return &detail::JsonKeys<dataT>::GetDefault();
+    }
+
+    if (properties.json_key_cache) {
+        return &properties.json_key_cache->Get<dataT>(
+            [&properties](const std::string& name) -> const std::string& {
+                return properties.map_name_to_json(name);
+            },
+            [&properties](const std::string& name) {
+                return properties.is_excluded(name);
+            });
+    }
+
+    return nullptr;
+}
+
+// Let the serializer build the json keys for each type once
+inline void use_json_key_cache(serialize_properties_t& properties) {
+    if ((properties.name_mapping || properties.excluded_names)
+        && !properties.json_key_cache) {
+        properties.json_key_cache = std::make_shared<detail::JsonKeyCache>();
+    }
+}
+
+// Writers that can write raw json get the escaped key as it is
+template <typename serializerT>
+auto write_json_key(serializerT& serializer, const std::string& key,
+                    const char *, const serialize_properties_t&, int)
+    -> decltype(serializer.RawValue(key.data(), key.size(), rapidjson::kStringType)) {
+    return serializer.RawValue(key.data(), key.size(), rapidjson::kStringType);
+}
+
+// Other handlers get the mapped name
+template <typename serializerT>
+bool write_json_key(serializerT& serializer, const std::string&,
+                    const char *name, const serialize_properties_t& properties, long) {
+    return serializer.Key(properties.map_name_to_json(name).c_str());
+}
+
 template <typename dataT, typename serializerT>
 void do_serialize(const dataT& object, serializerT& serializer,
                 const serialize_properties_t& properties,
@@ -1333,7 +1789,7 @@ void do_serialize(const dataT& object, serializerT& serializer,
         using native_field_type_t = typename std::remove_const<
             typename std::remove_reference<typename dataT::mapped_type>::type>::type;
 
-        do_serialize<std::string>(v.first, serializer, map_name_properties);
+        do_serialize<typename dataT::key_type>(v.first, serializer, map_name_properties);
         do_serialize<native_field_type_t>(v.second, serializer, properties);
     }
 #ifdef RESTC_CPP_LOG_JSON_SERIALIZATION
@@ -1355,11 +1811,15 @@ void do_serialize(const dataT& object, serializerT& serializer,
     RESTC_CPP_LOG_TRACE << RESTC_CPP_TYPENAME(dataT)
         << " StartObject: ";
 #endif
+    const auto *keys = get_json_keys<typename std::remove_cv<dataT>::type>(properties);
+    std::size_t index = 0;
+
     auto fn = [&](const char *name, auto& val) {
 #ifdef RESTC_CPP_LOG_JSON_SERIALIZATION
         RESTC_CPP_LOG_TRACE << RESTC_CPP_TYPENAME(dataT)
             << " Key: " << name;
 #endif
+        const auto member = index++;
         if (properties.ignore_empty_fileds) {
             if (is_empty_field(val)) {
 #ifdef RESTC_CPP_LOG_JSON_SERIALIZATION
@@ -1370,8 +1830,8 @@ void do_serialize(const dataT& object, serializerT& serializer,
             }
         }
 
-        if (properties.excluded_names
-            && properties.is_excluded(name)) {
+        if (keys ? keys->IsExcluded(member)
+            : (properties.excluded_names && properties.is_excluded(name))) {
 #ifdef RESTC_CPP_LOG_JSON_SERIALIZATION
             RESTC_CPP_LOG_TRACE << RESTC_CPP_TYPENAME(dataT)
                 << " ignoring excluded field.";
@@ -1379,7 +1839,11 @@ void do_serialize(const dataT& object, serializerT& serializer,
             return;
         }
 
-        serializer.Key(properties.map_name_to_json(name).c_str());
+        if (keys) {
+            write_json_key(serializer, keys->GetKey(member), name, properties, 0);
+        } else {
+            serializer.Key(properties.map_name_to_json(name).c_str());
+        }
 
         using const_field_type_t = decltype(val);
         using native_field_type_t = typename std::remove_const<typename std::remove_reference<const_field_type_t>::type>::type;
@@ -1416,6 +1880,7 @@ public:
 
     // See https://github.com/miloyip/rapidjson/blob/master/doc/sax.md#writer-writer
     void Serialize() {
+        use_json_key_cache(properties_);
         do_serialize<data_t>(object_, serializer_, properties_);
     }
 
@@ -1426,10 +1891,12 @@ public:
     // Set to nullptr to disable lookup
     void ExcludeNames(excluded_names_t *names) {
         properties_.excluded_names = names;
+        properties_.json_key_cache.reset();
     }
 
     void SetNameMapping(const JsonFieldMapping *mapping) {
         properties_.name_mapping = mapping;
+        properties_.json_key_cache.reset();
     }
 
 private:
@@ -1449,6 +1916,13 @@ public:
     using stream_t = RapidJsonWriter<char>;
     using writer_t = rapidjson::Writer<stream_t>;
 
+    //! How the objects are written
+    enum class Format {
+        OBJECT, //!< One json object
+        LIST, //!< A json list of objects
+        NDJSON //!< Newline-delimited json (JSON Lines), one object per line
+    };
+
     /*! Constructor
      *
      * \param writer Output DataWriter
@@ -1456,12 +1930,27 @@ public:
      *      If false, we can only Add() one object.
      */
     RapidJsonInserter(DataWriter& writer, bool isList = false)
-    : is_list_{isList}, stream_{writer}, writer_{stream_} {}
+    : RapidJsonInserter(writer, isList ? Format::LIST : Format::OBJECT) {}
 
     RapidJsonInserter(DataWriter& writer, bool isList,
          const serialize_properties_t& properties)
-    : is_list_{isList}, stream_{writer}, writer_{stream_}
-    , properties_{properties} {}
+    : RapidJsonInserter(writer, isList ? Format::LIST : Format::OBJECT, properties) {}
+
+    /*! Constructor
+     *
+     * \param writer Output DataWriter
+     * \param format How to write the objects. With NDJSON, the lines are
+     *      collected in the streams buffer, and written when it is full,
+     *      or when Flush() or Done() is called.
+     */
+    RapidJsonInserter(DataWriter& writer, Format format,
+         const serialize_properties_t& properties = {})
+    : format_{format}, stream_{writer}, writer_{stream_}
+    , line_stream_{stream_}, line_writer_{line_stream_}
+    , properties_{properties}
+    {
+        use_json_key_cache(properties_);
+    }
 
     ~RapidJsonInserter() {
         Done();
@@ -1469,7 +1958,7 @@ public:
 
     /*! Serialize one object
      *
-     * If the constructor was called with isList = false,
+     * If the format is OBJECT (isList = false),
      * it can only be called once.
      */
     void Add(const T& v) {
@@ -1478,20 +1967,35 @@ public:
         }
 
         if (state_ == State::PRE) {
-            if (is_list_) {
+            if (format_ == Format::LIST) {
                 writer_.StartArray();
             }
             state_ = State::ITERATING;
         }
 
+        if (format_ == Format::NDJSON) {
+            // Each line is a json document of its own
+            line_writer_.Reset(line_stream_);
+            do_serialize<T>(v, line_writer_, properties_);
+            stream_.Put('\n');
+            return;
+        }
+
         do_serialize<T>(v, writer_, properties_);
     }
 
+    //! Write what is buffered so far
+    void Flush() {
+        stream_.Flush();
+    }
+
     /*! Mark the serialization as complete */
     void Done() {
         if (state_ == State::ITERATING) {
-            if (is_list_) {
+            if (format_ == Format::LIST) {
                 writer_.EndArray();
+            } else if (format_ == Format::NDJSON) {
+                stream_.Flush();
             }
         }
         state_ = State::DONE;
@@ -1504,22 +2008,241 @@ public:
     // Set to nullptr to disable lookup
     void ExcludeNames(const excluded_names_t *names) {
         properties_.excluded_names = names;
+        properties_.json_key_cache.reset();
+        use_json_key_cache(properties_);
     }
 
     void SetNameMapping(const JsonFieldMapping *mapping) {
         properties_.name_mapping = mapping;
+        properties_.json_key_cache.reset();
+        use_json_key_cache(properties_);
     }
 
 private:
     enum class State { PRE, ITERATING, DONE };
 
+    // rapidjson flushes the stream after each document. For NDJSON
+    // that would be one write (and one chunk) per line, so here
+    // flushing is left to us.
+    class LineStream {
+    public:
+        using Ch = stream_t::Ch;
+
+        LineStream(stream_t& stream)
+        : stream_{stream} {}
+
+        void Put(Ch c) {
+            stream_.Put(c);
+        }
+
+        void Flush() {
+        }
+
+    private:
+        stream_t& stream_;
+    };
+
     State state_ = State::PRE;
-    const bool is_list_;
+    const Format format_;
     stream_t stream_;
     writer_t writer_;
+    LineStream line_stream_;
+    rapidjson::Writer<LineStream> line_writer_;
     serialize_properties_t properties_;
 };
 
+namespace {
+
+template <typename T>
+void reserve_elements(T&, std::size_t) {
+}
+
+template <typename T, typename AllocT>
+void reserve_elements(std::vector<T, AllocT>& data, std::size_t elements) {
+    data.reserve(data.size() + elements);
+}
+
+// Deserialize some of the elements of a json array in memory
+template <typename dataT>
+std::int64_t deserialize_array_elements(dataT& data, char *json,
+    const detail::JsonArrayElement *begin,
+    const detail::JsonArrayElement *end,
+    const serialize_properties_t& properties) {
+
+    static const std::string parse_error{"Failed to parse json array element"};
+
+    RapidJsonDeserializer<dataT> handler(data, properties);
+    rapidjson::Reader reader;
+
+    handler.StartArray();
+    for(auto element = begin; element != end; ++element) {
+        // The character after an element is whitespace, ',' or ']'
+        json[element->end] = 0;
+        rapidjson::InsituStringStream stream(json + element->begin);
+        reader.Parse<rapidjson::kParseInsituFlag>(stream, handler);
+        if (reader.HasParseError()) {
+            throw ParseException(parse_error);
+        }
+    }
+    handler.EndArray(static_cast<rapidjson::SizeType>(end - begin));
+    return handler.GetUsedBytes();
+}
+
+template <typename dataT>
+bool deserialize_reply_in_parallel(dataT& rootData, Reply& reply,
+                                   const serialize_properties_t& properties,
+                                   std::true_type /* is container */);
+
+template <typename dataT>
+bool deserialize_reply_in_parallel(dataT&, Reply&,
+                                   const serialize_properties_t&,
+                                   std::false_type /* is container */) {
+    return false;
+}
+
+} // anonymous namespace
+
+/*! Deserialize a json array in memory to a container, with several threads
+ *
+ * The elements in the array are found with a quick scan, split in
+ * ranges, and deserialized on properties.parallel_threads threads
+ * (including the calling thread). The elements are appended to
+ * rootData in the same order as in the json array.
+ *
+ * The strings in json are unescaped in place, so the buffer is
+ * modified.
+ */
+template <typename dataT>
+void SerializeFromJsonInParallel(dataT& rootData, std::string& json,
+                                 const serialize_properties_t& properties) {
+
+    static_assert(is_container<dataT>::value,
+                  "Only std::vector, std::deque and std::list are supported");
+
+    const auto elements = detail::SplitJsonArray(json.data(), json.size());
+
+    // A few ranges per thread, so that one slow range does not hold up the rest
+    const std::size_t threads = std::max(properties.parallel_threads, 1U);
+    const auto num_ranges = std::min(elements.size(), threads * 4);
+    const auto num_threads = std::min(threads, num_ranges);
+
+    std::vector<dataT> ranges(num_ranges);
+    std::vector<std::int64_t> used_bytes(num_ranges);
+    std::vector<std::exception_ptr> errors(num_ranges);
+    std::atomic<std::size_t> next_range{0};
+
+    auto worker = [&] {
+        for(auto i = next_range++; i < num_ranges; i = next_range++) {
+            const auto first = elements.data() + (i * elements.size() / num_ranges);
+            const auto last = elements.data() + ((i + 1) * elements.size() / num_ranges);
+            try {
+                used_bytes[i] = deserialize_array_elements(ranges[i], &json[0],
+                                                           first, last, properties);
+            } catch(...) {
+                errors[i] = std::current_exception();
+            }
+        }
+    };
+
+    // The threads that were started, and this one, take all the ranges, so
+    // if a thread cannot be started, we go on with the ones we have.
+    std::vector<std::thread> workers;
+    workers.reserve(num_threads);
+    for(std::size_t i = 1; i < num_threads; ++i) {
+        try {
+            workers.emplace_back(worker);
+        } catch(const std::system_error& ex) {
+            RESTC_CPP_LOG_WARN << "SerializeFromJsonInParallel: Could only start "
+                << (workers.size() + 1) << " of " << num_threads
+                << " threads: " << ex.what();
+            break;
+        }
+    }
+    worker();
+    for(auto& thread : workers) {
+        thread.join();
+    }
+
+    for(const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    if (properties.GetMaxMemoryConsumption()) {
+        std::int64_t total = 0;
+        for(const auto bytes : used_bytes) {
+            total += bytes;
+        }
+        if (total >= properties.GetMaxMemoryConsumption()) {
+            throw ConstraintException("Exceed memory usage constraint");
+        }
+    }
+
+    reserve_elements(rootData, elements.size());
+    for(auto& range : ranges) {
+        for(auto& value : range) {
+            rootData.push_back(std::move(value));
+        }
+    }
+}
+
+namespace {
+
+/* The size of the body, if we know it before we read it.
+ *
+ * Content-Length is the size of the encoded body, so we don't
+ * know the size of compressed bodies.
+ */
+inline boost::optional<std::size_t> get_reply_body_size(Reply& reply) {
+    const auto encoding = reply.GetHeader("Content-Encoding");
+    if (encoding && !boost::iequals(*encoding, "identity")) {
+        return {};
+    }
+
+    const auto value = reply.GetHeader("Content-Length");
+    if (!value || value->empty()) {
+        return {};
+    }
+
+    char *end = nullptr;
+    const auto length = std::strtoull(value->c_str(), &end, 10);
+    if (*end != 0) {
+        return {};
+    }
+
+    return static_cast<std::size_t>(length);
+}
+
+template <typename dataT>
+bool deserialize_reply_in_parallel(dataT& rootData, Reply& reply,
+                                   const serialize_properties_t& properties,
+                                   std::true_type /* is container */) {
+    if ((properties.parallel_threads < 2) || properties.reuse_existing_values) {
+        return false;
+    }
+#ifdef RESTC_CPP_HAVE_PMR
+    if (properties.memory_resource) {
+        return false;
+    }
+#endif
+
+    // Deserialize large bodies, and bodies of unknown size, while they
+    // are read, rather than failing when they don't fit in memory.
+    const auto size = get_reply_body_size(reply);
+    if (!size || (*size >= properties.parallel_max_body_size)) {
+        return false;
+    }
+
+    std::string json;
+    json.reserve(*size);
+    reply.GetBodyInto(json, *size + 1);
+    SerializeFromJsonInParallel(rootData, json, properties);
+    return true;
+}
+
+} // anonymous namespace
+
 /*! Serialize a std::istream to a C++ class instance */
 template <typename dataT>
 void SerializeFromJson(dataT& rootData,
@@ -1540,15 +2263,109 @@ void SerializeFromJson(dataT& rootData,
     SerializeFromJson(rootData, stream, properties);
 }
 
+/*! Serialize a reply to a C++ class instance, re-using context
+ *
+ * When the same resource is polled, the context keeps the memory for
+ * the parser state and the read buffer from one reply to the next.
+ * Together with reuse_existing_values, a poll can then be done
+ * without any heap allocations when the values fit in the memory
+ * they already have.
+ */
+template <typename dataT>
+void SerializeFromJson(dataT& rootData, Reply& reply,
+                       const serialize_properties_t& properties,
+                       JsonDeserializerContext& context) {
+
+    if (deserialize_reply_in_parallel(rootData, reply, properties,
+        std::integral_constant<bool, is_container<dataT>::value>{})) {
+        return;
+    }
+
+    RapidJsonDeserializer<dataT> handler(rootData, properties, context);
+
+#ifdef RESTC_CPP_WITH_SIMDJSON
+    if (properties.simdjson_max_body_size
+        && SimdJsonParser::CanParse(reply, properties.simdjson_max_body_size)) {
+        SimdJsonParser::Get().Parse(reply, handler,
+                                    properties.simdjson_max_body_size);
+        return;
+    }
+#endif
+
+    RapidJsonReader reply_stream(reply, context.read_buffer);
+    rapidjson::Reader json_reader;
+    json_reader.Parse<rapidjson::kParseInsituFlag>(reply_stream, handler);
+}
+
 /*! Serialize a reply to a C++ class instance */
 template <typename dataT>
 void SerializeFromJson(dataT& rootData, Reply& reply,
                        const serialize_properties_t& properties) {
+    JsonDeserializerContext context;
+    SerializeFromJson(rootData, reply, properties, context);
+}
 
-    RapidJsonDeserializer<dataT> handler(rootData, properties);
-    RapidJsonReader reply_stream(reply);
-    rapidjson::Reader json_reader;
-    json_reader.Parse(reply_stream, handler);
+/*! Deserialize a reply on a worker thread, while the rest of it is read
+ *
+ * The calling coroutine reads the body into properties.pipeline_buffers
+ * buffers, and hands the full buffers to a parser on a worker thread
+ * through a bounded ring. While the parser works on one buffer, the
+ * next ones are read from the network, so for large replies the time
+ * approaches the larger of the network and parse times, rather than
+ * their sum.
+ *
+ * ctx must be the context of the coroutine that reads the reply.
+ */
+template <typename dataT>
+void SerializeFromJsonPipelined(dataT& rootData, Reply& reply, Context& ctx,
+                                const serialize_properties_t& properties) {
+
+    detail::JsonPipeline pipeline(properties.pipeline_buffers,
+                                  properties.pipeline_buffer_size);
+    detail::PipelineBackoff backoff(properties.pipeline_min_wait,
+                                    properties.pipeline_max_wait);
+    std::exception_ptr parse_error;
+
+    std::thread parser([&] {
+        try {
+            RapidJsonDeserializer<dataT> handler(rootData, properties);
+            BasicRapidJsonReader<detail::JsonPipeline> stream(pipeline);
+            rapidjson::Reader json_reader;
+            json_reader.Parse<rapidjson::kParseInsituFlag>(stream, handler);
+        } catch(...) {
+            parse_error = std::current_exception();
+        }
+        pipeline.SetDone();
+    });
+
+    try {
+        for(bool eof = false; !eof && !pipeline.IsDone();) {
+            std::size_t index = 0;
+            if (!pipeline.TryGetFreeBuffer(index)) {
+                // The parser is behind
+                backoff.Wait(ctx);
+                continue;
+            }
+            backoff.Reset();
+            const auto bytes = reply.ReadInto(pipeline.GetBuffer(index));
+            pipeline.Push(index, bytes);
+            eof = (bytes == 0);
+        }
+
+        backoff.Reset();
+        while(!pipeline.IsDone()) {
+            backoff.Wait(ctx);
+        }
+    } catch(...) {
+        pipeline.Abort();
+        parser.join();
+        throw;
+    }
+
+    parser.join();
+    if (parse_error) {
+        std::rethrow_exception(parse_error);
+    }
 }
 
 /*! Serialize a reply to a C++ class instance */
@@ -1600,7 +2417,9 @@ void SerializeToJson(dataT& rootData,
 
     rapidjson::OStreamWrapper osw(ostream);
     rapidjson::Writer<rapidjson::OStreamWrapper> writer(osw);
-    do_serialize<dataT>(rootData, writer, properties);
+    auto props = properties;
+    use_json_key_cache(props);
+    do_serialize<dataT>(rootData, writer, props);
 }
 
 
@@ -0,0 +1,235 @@
+#pragma once
+
+#ifndef RESTC_CPP_SIMDJSON_PARSER_H_
+#define RESTC_CPP_SIMDJSON_PARSER_H_
+
+#include "restc-cpp/config.h"
+
+#ifdef RESTC_CPP_WITH_SIMDJSON
+
+#include <climits>
+#include <cstdlib>
+#include <string>
+
+#include <boost/algorithm/string/predicate.hpp>
+
+#include <simdjson.h>
+
+#include "restc-cpp/restc-cpp.h"
+#include "restc-cpp/error.h"
+
+namespace restc_cpp {
+
+/*! Parse complete json documents with simdjson
+ *
+ * The document is parsed with the simdjson on-demand API, and the
+ * values are passed on to a rapidjson SAX handler, like
+ * RapidJsonDeserializer. The handler sees the same events, in the
+ * same order, as it would from rapidjson::Reader.
+ *
+ * simdjson needs the whole document in memory, so this is only used
+ * for replies with a Content-Length. Other replies are parsed with
+ * rapidjson while they are read.
+ *
+ * Use Get() to get an instance for the current thread. It re-uses
+ * its memory for the next document.
+ */
+class SimdJsonParser {
+public:
+    /*! Get the parser for this thread */
+    static SimdJsonParser& Get() {
+        static thread_local SimdJsonParser parser;
+        return parser;
+    }
+
+    /*! Check if the body of a reply can be read into memory and parsed.
+     *
+     * It requires a Content-Length of no more than maxSize bytes, and
+     * no Content-Encoding, so that we know how large the body is
+     * before we start reading it.
+     */
+    static bool CanParse(Reply& reply, std::size_t maxSize) {
+        const auto length = GetContentLength(reply);
+        if (!length || (*length > maxSize)) {
+            return false;
+        }
+
+        const auto encoding = reply.GetHeader("Content-Encoding");
+        return !encoding || boost::iequals(*encoding, "identity");
+    }
+
+    /*! Read the body of a reply into memory and parse it */
+    template <typename handlerT>
+    void Parse(Reply& reply, handlerT& handler, std::size_t maxSize) {
+        std::string buffer;
+        if (const auto length = GetContentLength(reply)) {
+            buffer.reserve(*length + simdjson::SIMDJSON_PADDING);
+        }
+        reply.GetBodyInto(buffer, maxSize + 1);
+        Parse(buffer, handler);
+    }
+
+    /*! Parse a json document in buffer
+     *
+     * The capacity of buffer is increased if there is not room for
+     * the padding that simdjson needs after the data.
+     */
+    template <typename handlerT>
+    void Parse(std::string& buffer, handlerT& handler) {
+        if ((buffer.capacity() - buffer.size()) < simdjson::SIMDJSON_PADDING) {
+            buffer.reserve(buffer.size() + simdjson::SIMDJSON_PADDING);
+        }
+
+        try {
+            simdjson::padded_string_view json(buffer.data(), buffer.size(),
+                                              buffer.capacity());
+            simdjson::ondemand::document doc = parser_.iterate(json);
+            switch(doc.type()) {
+                case simdjson::ondemand::json_type::object:
+                case simdjson::ondemand::json_type::array: {
+                    simdjson::ondemand::value root = doc.get_value();
+                    Walk(root, handler);
+                } break;
+                default:
+                    // get_value() fails for a scalar document, like 42
+                    WalkScalar(doc, handler);
+            }
+            if (!doc.at_end()) {
+                throw ParseException("Unexpected data after the json document");
+            }
+        } catch(const simdjson::simdjson_error& ex) {
+            throw ParseException(std::string{"Failed to parse json: "} + ex.what());
+        }
+    }
+
+private:
+    SimdJsonParser() = default;
+
+    static boost::optional<std::size_t> GetContentLength(Reply& reply) {
+        const auto value = reply.GetHeader("Content-Length");
+        if (!value) {
+            return {};
+        }
+
+        char *end = nullptr;
+        const auto length = std::strtoull(value->c_str(), &end, 10);
+        if (value->empty() || (*end != 0)) {
+            return {};
+        }
+        return static_cast<std::size_t>(length);
+    }
+
+    template <typename handlerT>
+    static void Walk(simdjson::ondemand::value& value, handlerT& handler) {
+        using simdjson::ondemand::json_type;
+
+        switch(value.type()) {
+            case json_type::object: {
+                handler.StartObject();
+                std::size_t members = 0;
+                for(auto result : value.get_object()) {
+                    simdjson::ondemand::field field = std::move(result);
+                    const auto key = field.unescaped_key().value();
+                    handler.Key(key.data(), key.size(), true);
+                    simdjson::ondemand::value member = field.value();
+                    Walk(member, handler);
+                    ++members;
+                }
+                handler.EndObject(members);
+            } break;
+            case json_type::array: {
+                handler.StartArray();
+                std::size_t elements = 0;
+                for(auto result : value.get_array()) {
+                    simdjson::ondemand::value element = std::move(result);
+                    Walk(element, handler);
+                    ++elements;
+                }
+                handler.EndArray(elements);
+            } break;
+            default:
+                WalkScalar(value, handler);
+        }
+    }
+
+    // value is a value or a document
+    template <typename valueT, typename handlerT>
+    static void WalkScalar(valueT& value, handlerT& handler) {
+        using simdjson::ondemand::json_type;
+
+        switch(value.type()) {
+            case json_type::string: {
+                const auto str = value.get_string().value();
+                handler.String(str.data(), str.size(), true);
+            } break;
+            case json_type::number:
+                WalkNumber(value, handler);
+                break;
+            case json_type::boolean:
+                handler.Bool(value.get_bool());
+                break;
+            case json_type::null:
+                if (!value.is_null()) {
+                    throw ParseException("Invalid json value");
+                }
+                handler.Null();
+                break;
+            default:
+                throw ParseException("Invalid json value");
+        }
+    }
+
+    // Report numbers like rapidjson does
+    template <typename valueT, typename handlerT>
+    static void WalkNumber(valueT& value, handlerT& handler) {
+        using simdjson::ondemand::number_type;
+
+        switch(value.get_number_type()) {
+            case number_type::signed_integer: {
+                const std::int64_t i = value.get_int64();
+                if (i >= 0) {
+                    if (i <= UINT_MAX) {
+                        handler.Uint(static_cast<unsigned>(i));
+                    } else {
+                        handler.Uint64(static_cast<std::uint64_t>(i));
+                    }
+                } else if (i >= INT_MIN) {
+                    handler.Int(static_cast<int>(i));
+                } else {
+                    handler.Int64(i);
+                }
+            } break;
+            case number_type::unsigned_integer:
+                handler.Uint64(value.get_uint64());
+                break;
+            case number_type::floating_point_number:
+                handler.Double(value.get_double());
+                break;
+            default: {
+                // Too large for 64 bits
+                const auto token = GetValue(value.raw_json_token());
+                const std::string number{token.data(), token.size()};
+                handler.Double(std::strtod(number.c_str(), nullptr));
+            }
+        }
+    }
+
+    // Some document methods return a simdjson_result where value returns T
+    template <typename T>
+    static T GetValue(T value) {
+        return value;
+    }
+
+    template <typename T>
+    static T GetValue(simdjson::simdjson_result<T> result) {
+        return result.value();
+    }
+
+    simdjson::ondemand::parser parser_;
+};
+
+} // restc_cpp
+
+#endif // RESTC_CPP_WITH_SIMDJSON
+
+#endif // RESTC_CPP_SIMDJSON_PARSER_H_
@@ -32,9 +32,34 @@ public:
     virtual std::size_t AsyncReadSome(boost::asio::mutable_buffers_1 buffers,
                                         boost::asio::yield_context& yield) = 0;
 
+    /*! Wait until there is data to read, without reading it
+     *
+     * This allows the caller to not allocate a buffer before
+     * there is something to put in it. TLS sockets return at once,
+     * as their data may already be buffered by the TLS layer.
+     */
+    virtual void AsyncWaitForData(boost::asio::yield_context& yield) = 0;
+
     virtual std::size_t AsyncRead(boost::asio::mutable_buffers_1 buffers,
                                     boost::asio::yield_context& yield) = 0;
 
+    /*! True if AsyncSpliceTo() is supported by this socket */
+    virtual bool CanSplice() const noexcept {
+        return false;
+    }
+
+    /*! Move up to maxBytes from the socket to the file fd
+     *
+     * The data is moved by the kernel, without copying it
+     * through our buffers.
+     *
+     * \return The number of bytes moved. 0 on end of stream.
+     */
+    virtual std::size_t AsyncSpliceTo(int /*fd*/, std::size_t /*maxBytes*/,
+                                      boost::asio::yield_context& /*yield*/) {
+        throw NotSupportedException("Splice is not supported by this socket");
+    }
+
     virtual void AsyncWrite(const boost::asio::const_buffers_1& buffers,
         boost::asio::yield_context& yield) = 0;
 
@@ -0,0 +1,160 @@
+#pragma once
+
+/**
+* \brief Maps the member names of a Fusion adapted struct to their index.
+*
+* The table is built once per type, the first time it is used.
+* It is an open addressing hash table with a load factor below 0.5,
+* and we pick the hash seed that gives the fewest collisions. For
+* most structs, a lookup is one hash calculation and one compare.
+*
+* With a name mapping, the table is built over the json names of the
+* members instead. JsonKeyCache keeps these per type.
+*
+* BOOST_FUSION_ADAPT_STRUCT(ns::point,
+*       (int, x)
+*       (int, y));
+*
+* FieldIndex<ns::point>::Get().Find("y", 1) == 1
+*/
+#ifndef RESTC_CPP_FIELD_INDEX_HPP
+#define RESTC_CPP_FIELD_INDEX_HPP
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/fusion/include/adapt_struct.hpp>
+#include <boost/fusion/sequence/intrinsic/size.hpp>
+
+namespace restc_cpp {
+namespace detail {
+
+template <typename T>
+class FieldIndex {
+public:
+    static constexpr std::size_t size = boost::fusion::result_of::size<T>::value;
+
+    static const FieldIndex& Get() {
+        static const FieldIndex instance;
+        return instance;
+    }
+
+    /*! Build the table over the json names of the members
+     *
+     * toJsonName(name) returns the json name for the name of a member.
+     */
+    template <typename mapT>
+    explicit FieldIndex(const mapT& toJsonName) {
+        const auto names = GetNames(std::make_index_sequence<size>());
+        std::array<const char *, size> json_names;
+        for(std::size_t i = 0; i < size; ++i) {
+            json_names_[i] = toJsonName(std::string{names[i]});
+            json_names[i] = json_names_[i].c_str();
+        }
+        Build(json_names);
+    }
+
+    // The slots point to the names
+    FieldIndex(const FieldIndex&) = delete;
+    FieldIndex& operator = (const FieldIndex&) = delete;
+
+    /*! Get the index of the member with this name, or -1 */
+    int Find(const char *name, std::size_t len) const noexcept {
+        if (slots_.empty()) {
+            return -1;
+        }
+
+        for(auto i = Hash(seed_, name, len) & mask_;; i = (i + 1) & mask_) {
+            const auto& slot = slots_[i];
+            if (slot.index < 0) {
+                return -1;
+            }
+            if ((slot.len == len) && (memcmp(slot.name, name, len) == 0)) {
+                return slot.index;
+            }
+        }
+    }
+
+    int Find(const std::string& name) const noexcept {
+        return Find(name.c_str(), name.size());
+    }
+
+private:
+    struct Slot {
+        const char *name = nullptr;
+        std::size_t len = 0;
+        int index = -1;
+    };
+
+    FieldIndex() {
+        Build(GetNames(std::make_index_sequence<size>()));
+    }
+
+    void Build(const std::array<const char *, size>& names) {
+        if (!size) {
+            return;
+        }
+
+        std::size_t table_size = 1;
+        while(table_size < (size * 2)) {
+            table_size *= 2;
+        }
+        mask_ = table_size - 1;
+
+        // Try a few seeds, and keep the one with the shortest probes
+        std::size_t best_probes = ~static_cast<std::size_t>(0);
+        for(std::uint32_t seed = 0; (seed < 32) && (best_probes > 0); ++seed) {
+            std::vector<Slot> slots(table_size);
+            std::size_t probes = 0;
+            for(std::size_t n = 0; n < size; ++n) {
+                const auto len = strlen(names[n]);
+                auto i = Hash(seed, names[n], len) & mask_;
+                while(slots[i].index >= 0) {
+                    i = (i + 1) & mask_;
+                    ++probes;
+                }
+                slots[i] = {names[n], len, static_cast<int>(n)};
+            }
+
+            if (probes < best_probes) {
+                best_probes = probes;
+                seed_ = seed;
+                slots_ = std::move(slots);
+            }
+        }
+    }
+
+    template <std::size_t... I>
+    static std::array<const char *, size> GetNames(std::index_sequence<I...>) {
+        return {{boost::fusion::extension::struct_member_name<T, I>::call()...}};
+    }
+
+    // FNV-1a
+    static std::size_t Hash(std::uint32_t seed, const char *name,
+                            std::size_t len) noexcept {
+        std::uint32_t hash = 2166136261u ^ seed;
+        for(std::size_t i = 0; i < len; ++i) {
+            hash ^= static_cast<unsigned char>(name[i]);
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    std::vector<Slot> slots_;
+    std::size_t mask_ = 0;
+    std::uint32_t seed_ = 0;
+    // Only used with a name mapping
+    std::array<std::string, size> json_names_;
+};
+
+template <typename T>
+constexpr std::size_t FieldIndex<T>::size;
+
+} // detail
+} // restc_cpp
+
+#endif
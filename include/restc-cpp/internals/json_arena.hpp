@@ -0,0 +1,182 @@
+#pragma once
+
+/**
+* \brief Memory for the nested handlers of one JSON deserialization.
+*
+* Memory is handed out from large blocks by bumping an offset. The
+* handlers in RapidJsonDeserializer are strictly nested, so when a
+* handler is done, the arena is rewound to where that handler was
+* allocated, and the next sibling gets the same memory. After the
+* first object in an array, deserializing the rest of the array
+* does not touch the heap for bookkeeping.
+*
+* The blocks are kept until the arena is destroyed.
+*/
+#ifndef RESTC_CPP_JSON_ARENA_HPP
+#define RESTC_CPP_JSON_ARENA_HPP
+
+#include <assert.h>
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace restc_cpp {
+namespace detail {
+
+class JsonArena {
+public:
+    struct Mark {
+        std::size_t block = 0;
+        std::size_t used = 0;
+    };
+
+    /*! Destroys an object and returns its memory to the arena */
+    class Deleter {
+    public:
+        Deleter() = default;
+        Deleter(JsonArena *arena, const Mark& mark) noexcept
+        : arena_{arena}, mark_{mark} {}
+
+        template <typename T>
+        void operator()(T *object) const noexcept {
+            assert(arena_ != nullptr);
+            object->~T();
+            arena_->Rewind(mark_);
+        }
+
+    private:
+        JsonArena *arena_ = nullptr;
+        Mark mark_;
+    };
+
+    template <typename T>
+    using ptr_t = std::unique_ptr<T, Deleter>;
+
+    explicit JsonArena(std::size_t blockSize = 4096)
+    : block_size_{blockSize} {}
+
+    JsonArena(const JsonArena&) = delete;
+    JsonArena& operator = (const JsonArena&) = delete;
+
+    /*! Construct an object in the arena.
+     *
+     * Objects must be destroyed in the reverse order of their creation.
+     */
+    template <typename T, typename... Args>
+    ptr_t<T> Create(Args&&... args) {
+        const auto mark = GetMark();
+        void *mem = Allocate(sizeof(T), alignof(T));
+        try {
+            return ptr_t<T>{new (mem) T(std::forward<Args>(args)...),
+                            Deleter{this, mark}};
+        } catch(...) {
+            Rewind(mark);
+            throw;
+        }
+    }
+
+    void *Allocate(std::size_t bytes, std::size_t alignment) {
+        assert(alignment <= alignof(std::max_align_t));
+
+        while(true) {
+            if (current_ == blocks_.size()) {
+                blocks_.push_back({std::make_unique<char[]>(
+                    std::max(block_size_, bytes)), std::max(block_size_, bytes)});
+            }
+
+            auto& block = blocks_[current_];
+            const auto offset = (used_ + alignment - 1) & ~(alignment - 1);
+            if ((offset + bytes) <= block.size) {
+                used_ = offset + bytes;
+                return block.data.get() + offset;
+            }
+
+            // Try the next block, or add one
+            ++current_;
+            used_ = 0;
+        }
+    }
+
+    Mark GetMark() const noexcept {
+        return {current_, used_};
+    }
+
+    /*! Release everything allocated after mark was taken */
+    void Rewind(const Mark& mark) noexcept {
+        assert((mark.block < current_)
+            || ((mark.block == current_) && (mark.used <= used_)));
+        current_ = mark.block;
+        used_ = mark.used;
+    }
+
+    /*! Release everything. The memory is kept for the next document. */
+    void Reset() noexcept {
+        current_ = 0;
+        used_ = 0;
+    }
+
+    /*! Bytes held in blocks */
+    std::size_t GetCapacity() const noexcept {
+        std::size_t bytes = 0;
+        for(const auto& block : blocks_) {
+            bytes += block.size;
+        }
+        return bytes;
+    }
+
+private:
+    struct Block {
+        std::unique_ptr<char[]> data;
+        std::size_t size;
+    };
+
+    const std::size_t block_size_;
+    std::vector<Block> blocks_;
+    std::size_t current_ = 0;
+    std::size_t used_ = 0;
+};
+
+class JsonKeyCache;
+
+/*! State shared by all the handlers deserializing one document
+ *
+ * It can be given to SerializeFromJson() to be re-used for the next
+ * document, so that its memory is not allocated again.
+ */
+struct JsonDeserializerContext {
+    JsonArena arena;
+
+    // The member indexes for the name mapping, if the properties
+    // don't have a json_key_cache
+    std::shared_ptr<JsonKeyCache> json_key_cache;
+
+    // The key we are about to assign a value to. Only one level
+    // in the document can have a pending key at any time.
+    std::string current_name;
+
+    // Scratch buffer for the json name, when we apply a name mapping
+    std::string json_name;
+
+    // Scratch buffer for string values
+    std::string string_value;
+
+    // The buffer RapidJsonReader copies the data from the reply to
+    std::vector<char> read_buffer;
+
+    //! Prepare for the next document. The memory is kept.
+    void Reset() noexcept {
+        arena.Reset();
+        current_name.clear();
+        // The next document may use another name mapping
+        json_key_cache.reset();
+    }
+};
+
+} // detail
+} // restc_cpp
+
+#endif
@@ -0,0 +1,145 @@
+#pragma once
+
+/**
+* \brief Finds the elements of a top level json array.
+*
+* This is a quick structural scan. It only tracks strings and the
+* nesting of brackets and braces, so that the elements can be handed
+* to different threads and parsed on their own. The elements are
+* validated when they are parsed.
+*
+* SplitJsonArray(R"([{"a":1}, 2, "three"])") returns the ranges of
+* `{"a":1}`, `2` and `"three"`.
+*/
+#ifndef RESTC_CPP_JSON_ARRAY_SPLITTER_HPP
+#define RESTC_CPP_JSON_ARRAY_SPLITTER_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "restc-cpp/error.h"
+
+namespace restc_cpp {
+namespace detail {
+
+struct JsonArrayElement {
+    std::size_t begin = 0; // Offset of the first character
+    std::size_t end = 0; // Offset after the last character
+};
+
+inline bool is_json_whitespace(const char ch) noexcept {
+    return (ch == ' ') || (ch == '\n') || (ch == '\r') || (ch == '\t');
+}
+
+inline std::vector<JsonArrayElement> SplitJsonArray(const char *json,
+                                                    const std::size_t len) {
+    static const std::string not_array{"SplitJsonArray: The json document is not an array"};
+    static const std::string bad_array{"SplitJsonArray: Malformed json array"};
+
+    std::vector<JsonArrayElement> elements;
+    const char *p = json;
+    const char *const end = json + len;
+
+    while((p != end) && is_json_whitespace(*p)) {
+        ++p;
+    }
+    if ((p == end) || (*p != '[')) {
+        throw ParseException(not_array);
+    }
+    ++p;
+
+    const char *element = nullptr; // Start of the current element
+    const char *last = nullptr; // The last non-whitespace character in it
+    std::size_t depth = 0;
+    bool done = false;
+
+    while(!done && (p != end)) {
+        const char ch = *p;
+        if ((depth == 0) && !element) {
+            if (is_json_whitespace(ch)) {
+                ++p;
+                continue;
+            }
+            if ((ch == ',') || ((ch == ']') && !elements.empty())) {
+                throw ParseException(bad_array);
+            }
+            if (ch != ']') {
+                element = p;
+            }
+        }
+
+        switch(ch) {
+            case '"':
+                // Jump to the closing quote
+                for(++p; p != end; ++p) {
+                    if (*p == '\\') {
+                        if (++p == end) {
+                            break;
+                        }
+                    } else if (*p == '"') {
+                        break;
+                    }
+                }
+                if (p == end) {
+                    throw ParseException(bad_array);
+                }
+                break;
+            case '[':
+            case '{':
+                ++depth;
+                break;
+            case ']':
+            case '}':
+                if (depth == 0) {
+                    if (ch != ']') {
+                        throw ParseException(bad_array);
+                    }
+                    if (element) {
+                        elements.push_back({static_cast<std::size_t>(element - json),
+                                            static_cast<std::size_t>(last + 1 - json)});
+                    }
+                    done = true;
+                    continue;
+                }
+                --depth;
+                break;
+            case ',':
+                if (depth == 0) {
+                    elements.push_back({static_cast<std::size_t>(element - json),
+                                        static_cast<std::size_t>(last + 1 - json)});
+                    element = nullptr;
+                    ++p;
+                    continue;
+                }
+                break;
+            default:
+                if (is_json_whitespace(ch)) {
+                    ++p;
+                    continue;
+                }
+        }
+
+        last = p;
+        ++p;
+    }
+
+    if (!done) {
+        throw ParseException(bad_array);
+    }
+
+    // Only whitespace is allowed after the array
+    for(++p; p != end; ++p) {
+        if (!is_json_whitespace(*p)) {
+            throw ParseException(bad_array);
+        }
+    }
+
+    return elements;
+}
+
+} // detail
+} // restc_cpp
+
+#endif
@@ -0,0 +1,177 @@
+#pragma once
+
+/**
+* \brief The json keys for the members of a Fusion adapted struct.
+*
+* Each key is mapped, quoted and escaped once, so that it can be written
+* as it is with the writers RawValue(), instead of being looked up in the
+* name mapping and escaped again for every object. The members that are
+* excluded are kept in a bitset.
+*
+* BOOST_FUSION_ADAPT_STRUCT(ns::point,
+*       (int, x)
+*       (int, y));
+*
+* JsonKeys<ns::point>::GetDefault().GetKey(1) == "\"y\""
+*/
+#ifndef RESTC_CPP_JSON_KEYS_HPP
+#define RESTC_CPP_JSON_KEYS_HPP
+
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/fusion/include/adapt_struct.hpp>
+#include <boost/fusion/sequence/intrinsic/size.hpp>
+
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+
+#include "restc-cpp/internals/field_index.hpp"
+
+namespace restc_cpp {
+namespace detail {
+
+template <typename T>
+class JsonKeys {
+public:
+    static constexpr std::size_t size = boost::fusion::result_of::size<T>::value;
+
+    /*! Build the keys
+     *
+     * toJsonName(name) returns the json name for the name of a member,
+     * and isExcluded(name) returns true if the member is not written.
+     */
+    template <typename mapT, typename excludedT>
+    JsonKeys(const mapT& toJsonName, const excludedT& isExcluded) {
+        const auto names = GetNames(std::make_index_sequence<size>());
+        for(std::size_t i = 0; i < size; ++i) {
+            const std::string name{names[i]};
+            excluded_[i] = isExcluded(name);
+
+            const std::string& json_name = toJsonName(name);
+            rapidjson::StringBuffer buffer;
+            rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+            writer.String(json_name.c_str(),
+                          static_cast<rapidjson::SizeType>(json_name.size()));
+            keys_[i].assign(buffer.GetString(), buffer.GetSize());
+        }
+    }
+
+    //! The keys when there is no name mapping or excluded names
+    static const JsonKeys& GetDefault() {
+        static const JsonKeys instance{
+            [](const std::string& name) -> const std::string& { return name; },
+            [](const std::string&) { return false; }};
+        return instance;
+    }
+
+    //! The quoted and escaped json key for the member at index
+    const std::string& GetKey(std::size_t index) const noexcept {
+        return keys_[index];
+    }
+
+    bool IsExcluded(std::size_t index) const noexcept {
+        return excluded_[index];
+    }
+
+private:
+    template <std::size_t... I>
+    static std::array<const char *, size> GetNames(std::index_sequence<I...>) {
+        return {{boost::fusion::extension::struct_member_name<T, I>::call()...}};
+    }
+
+    std::array<std::string, size> keys_;
+    std::bitset<size> excluded_;
+};
+
+template <typename T>
+constexpr std::size_t JsonKeys<T>::size;
+
+/*! JsonKeys for a name mapping and excluded names, per type.
+ *
+ * A serializer owns one, so that the keys are built once for all the
+ * objects it writes. The mapping and the excluded names must not change
+ * while it is in use. The deserializer keeps the FieldIndex over the
+ * mapped names in it as well.
+ *
+ * Copies of serialize_properties_t share the cache, so it may be used
+ * by serializers on several threads at the same time. Get() is
+ * thread safe, and the keys it returns are never moved or removed.
+ *
+ * Get() is called for every object that is written. Keys that are
+ * built are therefore published in a table indexed by type, and read
+ * from there without taking the mutex.
+ */
+class JsonKeyCache {
+public:
+    template <typename T, typename mapT, typename excludedT>
+    const JsonKeys<T>& Get(const mapT& toJsonName, const excludedT& isExcluded) {
+        return GetOrBuild<JsonKeys<T>>(toJsonName, isExcluded);
+    }
+
+    //! The FieldIndex over the json names of the members of T
+    template <typename T, typename mapT>
+    const FieldIndex<T>& GetFieldIndex(const mapT& toJsonName) {
+        return GetOrBuild<FieldIndex<T>>(toJsonName);
+    }
+
+private:
+    template <typename V, typename... argsT>
+    const V& GetOrBuild(const argsT&... args) {
+        const auto index = GetTypeIndex<V>();
+        if (index < published_.size()) {
+            if (const auto *value = published_[index].load(std::memory_order_acquire)) {
+                return *static_cast<const V *>(value);
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        for(const auto& entry : entries_) {
+            if (entry.first == index) {
+                return *static_cast<const V *>(entry.second.get());
+            }
+        }
+
+        auto value = std::make_shared<const V>(args...);
+        const auto& rval = *value;
+        entries_.emplace_back(index, std::move(value));
+        if (index < published_.size()) {
+            published_[index].store(&rval, std::memory_order_release);
+        }
+        return rval;
+    }
+
+    static std::size_t GetNextTypeIndex() noexcept {
+        static std::atomic<std::size_t> next{0};
+        return next++;
+    }
+
+    template <typename T>
+    static std::size_t GetTypeIndex() noexcept {
+        static const std::size_t index = GetNextTypeIndex();
+        return index;
+    }
+
+    // Types with a higher index are only found in entries_
+    static constexpr std::size_t max_published_types = 64;
+
+    std::array<std::atomic<const void *>, max_published_types> published_{};
+
+    // Owns the keys and indexes. There are normally only a few types,
+    // so a linear search is fine when we build them.
+    std::vector<std::pair<std::size_t, std::shared_ptr<const void>>> entries_;
+    std::mutex mutex_;
+};
+
+constexpr std::size_t JsonKeyCache::max_published_types;
+
+} // detail
+} // restc_cpp
+
+#endif
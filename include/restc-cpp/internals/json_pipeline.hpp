@@ -0,0 +1,187 @@
+#pragma once
+
+/**
+* \brief Passes the body of a reply from the IO thread to a parser thread.
+*
+* The IO thread (the producer) reads data into free buffers, and pushes
+* them to the parser thread (the consumer). The parser gives each buffer
+* back when it asks for the next one, so there are never more than
+* `buffers` buffers in use, and the IO thread is never more than that
+* many buffers ahead of the parser.
+*
+* The consumer side has a GetSomeData() method that works like
+* Reply::GetSomeData(), so it can be read with BasicRapidJsonReader.
+*
+* The consumer blocks on a condition variable when there is no data.
+* The producer runs in a coroutine, and must not block its thread, so
+* it polls TryGetFreeBuffer() and IsDone() when it has to wait, with
+* PipelineBackoff between the polls.
+*/
+#ifndef RESTC_CPP_JSON_PIPELINE_HPP
+#define RESTC_CPP_JSON_PIPELINE_HPP
+
+#include <assert.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+#include <boost/asio/buffer.hpp>
+
+#include "restc-cpp/internals/spsc_ring.hpp"
+
+namespace restc_cpp {
+namespace detail {
+
+class JsonPipeline {
+public:
+    JsonPipeline(std::size_t buffers, std::size_t bufferSize)
+    : buffers_(std::max<std::size_t>(buffers, 1),
+               std::vector<char>(std::max<std::size_t>(bufferSize, 1)))
+    , free_(buffers_.size())
+    , filled_(buffers_.size())
+    {
+        for(std::size_t i = 0; i < buffers_.size(); ++i) {
+            free_.TryPush(i);
+        }
+    }
+
+    JsonPipeline(const JsonPipeline&) = delete;
+    JsonPipeline& operator = (const JsonPipeline&) = delete;
+
+    // Producer
+
+    //! Get a buffer to read into. Returns false if all are in use.
+    bool TryGetFreeBuffer(std::size_t& index) {
+        return free_.TryPop(index);
+    }
+
+    boost::asio::mutable_buffers_1 GetBuffer(std::size_t index) {
+        return {buffers_[index].data(), buffers_[index].size()};
+    }
+
+    //! Pass a buffer to the consumer. 0 bytes means end of data.
+    void Push(std::size_t index, std::size_t bytes) {
+        const bool pushed = filled_.TryPush({index, bytes});
+        assert(pushed);
+        (void)pushed;
+        Notify();
+    }
+
+    //! Let the consumer see end of data, without using a buffer.
+    void Abort() {
+        aborted_ = true;
+        Notify();
+    }
+
+    //! True when the consumer is done, or has given up.
+    bool IsDone() const noexcept {
+        return done_;
+    }
+
+    // Consumer
+
+    boost::asio::const_buffers_1 GetSomeData() {
+        if (eof_) {
+            return {nullptr, 0};
+        }
+
+        if (current_ != none) {
+            free_.TryPush(current_);
+            current_ = none;
+        }
+
+        Chunk chunk;
+        while(!filled_.TryPop(chunk)) {
+            if (aborted_) {
+                return {nullptr, 0};
+            }
+            std::unique_lock<std::mutex> lock(mutex_);
+            cond_.wait(lock, [this] {
+                return aborted_ || !filled_.IsEmpty();
+            });
+        }
+
+        if (!chunk.bytes) {
+            eof_ = true;
+            return {nullptr, 0};
+        }
+
+        current_ = chunk.index;
+        return {buffers_[chunk.index].data(), chunk.bytes};
+    }
+
+    //! Called by the consumer when it does not want more data.
+    void SetDone() noexcept {
+        done_ = true;
+    }
+
+private:
+    struct Chunk {
+        std::size_t index = 0;
+        std::size_t bytes = 0;
+    };
+
+    static constexpr std::size_t none = std::numeric_limits<std::size_t>::max();
+
+    void Notify() {
+        {
+            // Make sure the consumer is either waiting, or will see the change
+            std::lock_guard<std::mutex> lock(mutex_);
+        }
+        cond_.notify_one();
+    }
+
+    std::vector<std::vector<char>> buffers_;
+    SpscRing<std::size_t> free_;
+    SpscRing<Chunk> filled_;
+    std::size_t current_ = none; // The buffer the consumer is reading from
+    bool eof_ = false;
+    std::atomic<bool> aborted_{false};
+    std::atomic<bool> done_{false};
+    std::mutex mutex_;
+    std::condition_variable cond_;
+};
+
+/*! How long the producer sleeps between polls of the pipeline
+ *
+ * The first wait is minWait. Each wait in a row doubles it, up to
+ * maxWait, so a parser that is far behind is not polled more than
+ * needed, while one that just needed a little time is polled again
+ * soon. Call Reset() when the producer got what it waited for.
+ */
+class PipelineBackoff {
+public:
+    PipelineBackoff(std::chrono::microseconds minWait,
+                    std::chrono::microseconds maxWait)
+    : min_wait_{std::max(minWait, std::chrono::microseconds{1})}
+    , max_wait_{std::max(maxWait, min_wait_)}
+    , wait_{min_wait_}
+    {
+    }
+
+    //! Sleep in ctx (a Context) for the current wait
+    template <typename ctxT>
+    void Wait(ctxT& ctx) {
+        ctx.Sleep(wait_);
+        wait_ = std::min(wait_ * 2, max_wait_);
+    }
+
+    void Reset() noexcept {
+        wait_ = min_wait_;
+    }
+
+private:
+    const std::chrono::microseconds min_wait_;
+    const std::chrono::microseconds max_wait_;
+    std::chrono::microseconds wait_;
+};
+
+} // detail
+} // restc_cpp
+
+#endif
@@ -0,0 +1,83 @@
+#pragma once
+
+/**
+* \brief A bounded, lock-free queue for one producer and one consumer thread.
+*
+* The producer only writes head_, and the consumer only writes tail_.
+* They are kept in separate cache lines, so that the two threads don't
+* invalidate each others caches when they update them.
+*
+* SpscRing<int> ring(2);
+* ring.TryPush(1); // true
+* ring.TryPush(2); // true
+* ring.TryPush(3); // false, the ring is full
+*/
+#ifndef RESTC_CPP_SPSC_RING_HPP
+#define RESTC_CPP_SPSC_RING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace restc_cpp {
+namespace detail {
+
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(std::size_t capacity)
+    : slots_(capacity + 1) // One slot is always empty
+    {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator = (const SpscRing&) = delete;
+
+    //! Called by the producer. Returns false if the ring is full.
+    bool TryPush(T value) {
+        const auto head = head_.load(std::memory_order_relaxed);
+        const auto next = Next(head);
+        if (next == tail_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        slots_[head] = std::move(value);
+        head_.store(next, std::memory_order_release);
+        return true;
+    }
+
+    //! Called by the consumer. Returns false if the ring is empty.
+    bool TryPop(T& value) {
+        const auto tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = std::move(slots_[tail]);
+        tail_.store(Next(tail), std::memory_order_release);
+        return true;
+    }
+
+    bool IsEmpty() const noexcept {
+        return tail_.load(std::memory_order_acquire)
+            == head_.load(std::memory_order_acquire);
+    }
+
+    std::size_t GetCapacity() const noexcept {
+        return slots_.size() - 1;
+    }
+
+private:
+    std::size_t Next(std::size_t index) const noexcept {
+        return (++index == slots_.size()) ? 0 : index;
+    }
+
+    static constexpr std::size_t cache_line_size = 64;
+
+    std::vector<T> slots_;
+    alignas(cache_line_size) std::atomic<std::size_t> head_{0};
+    alignas(cache_line_size) std::atomic<std::size_t> tail_{0};
+};
+
+} // detail
+} // restc_cpp
+
+#endif
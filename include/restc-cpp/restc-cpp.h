@@ -47,11 +47,16 @@
 #   define RESTC_CPP_SANE_DATA_LIMIT (1024 * 1024 * 16)
 #endif
 
-/*! Size of fixed size (per connection) IO buffers */
+/*! Initial (and smallest) size of the IO buffers used for reading */
 #ifndef RESTC_CPP_IO_BUFFER_SIZE
 #   define RESTC_CPP_IO_BUFFER_SIZE (1024 * 16)
 #endif
 
+/*! Max compressed size of bodies we decompress in one go with libdeflate */
+#ifndef RESTC_CPP_LIBDEFLATE_MAX_SIZE
+#   define RESTC_CPP_LIBDEFLATE_MAX_SIZE (1024 * 1024)
+#endif
+
 namespace restc_cpp {
 
 class RestClient;
@@ -65,6 +70,8 @@ class Request;
 class Reply;
 class Context;
 class DataWriter;
+class IoBufferPool;
+class ResponseCache;
 
 using write_buffers_t = std::vector<boost::asio::const_buffer>;
 
@@ -152,6 +159,98 @@ public:
         std::size_t cacheMaxConnections = 128;
         int cacheTtlSeconds = 60;
         int cacheCleanupIntervalSeconds = 3;
+
+        /*! Disable Nagle's algorithm on the connections (TCP_NODELAY) */
+        bool tcpNodelay = false;
+
+        /*! Hold back partial frames while the request is sent (TCP_CORK)
+         *
+         * Only supported on Linux. The socket is uncorked when
+         * the reply is requested.
+         */
+        bool tcpCork = false;
+
+        /*! Send "Expect: 100-continue" with requests that have a body
+         *
+         * The body is sent when the server accepts the request
+         * headers, or when it has not answered within
+         * expectContinueTimeoutMs. If the server rejects the request,
+         * the body is not sent at all, and the connection is closed
+         * after the reply.
+         *
+         * The wait is only done for plain HTTP. Over HTTPS, and when
+         * expectContinueTimeoutMs is 0 or less, the body is sent right
+         * after the headers.
+         */
+        bool expectContinue = false;
+        int expectContinueTimeoutMs = 1000;
+
+        /*! Drain unread reply bodies so the connection can be reused
+         *
+         * If a Reply is destroyed before its body is read, the rest of
+         * the body is read and discarded by a new co-routine if it is
+         * no larger than drainMaxBytes and arrives within drainTimeoutMs.
+         * The connection is then returned to the pool. Else the connection
+         * is closed. Set drainMaxBytes to 0 to always close.
+         */
+        std::size_t drainMaxBytes = 1024 * 64;
+        int drainTimeoutMs = 500;
+
+        /*! Largest read buffer. Reads grow towards this for bulk transfers.
+         *
+         * Client-level setting. It is read from the properties given to
+         * RestClient::Create(), and ignored in the properties of a request.
+         */
+        std::size_t ioBufferMaxSize = 1024 * 256;
+
+        /*! Max bytes of unused read buffers kept by the client for re-use
+         *
+         * Client-level setting, like ioBufferMaxSize.
+         */
+        std::size_t ioBufferPoolMaxIdleBytes = 1024 * 1024 * 4;
+
+        /*! Use the clients ResponseCache for GET requests
+         *
+         * Cacheable replies are stored according to their Cache-Control
+         * and Expires headers, and stale replies are revalidated with
+         * conditional requests.
+         */
+        bool cacheResponses = false;
+
+        /*! Max bytes of replies the ResponseCache keeps in memory
+         *
+         * The ResponseCache is created once per client. This and the
+         * other settings of the cache below are read from the properties
+         * given to RestClient::Create(), and ignored in the properties
+         * of a request.
+         */
+        std::size_t responseCacheMaxBytes = 1024 * 1024 * 32;
+
+        /*! Bodies larger than this are not stored in the ResponseCache */
+        std::size_t responseCacheMaxEntrySize = 1024 * 1024 * 2;
+
+        /*! If set, the ResponseCache also stores replies in this directory */
+        std::string responseCacheDirectory;
+
+        /*! Max bytes of files the ResponseCache keeps in its directory
+         *
+         * The least recently used files are deleted first. Files left
+         * by earlier runs count towards the limit.
+         */
+        std::size_t responseCacheMaxDiskBytes = 1024 * 1024 * 256;
+
+        /*! Remember permanent redirects (301, 308) in the ResponseCache
+         *
+         * Later GET and HEAD requests to the same url go straight to the
+         * new location. Only redirects of GET and HEAD requests are
+         * remembered. A successful POST, PUT, DELETE or PATCH to the url
+         * makes the client forget its redirect.
+         */
+        bool cachePermanentRedirects = false;
+
+        /*! Max number of permanent redirects the ResponseCache remembers */
+        std::size_t maxCachedRedirects = 1024;
+
         headers_t headers;
         args_t args;
         Proxy proxy;
@@ -226,6 +325,63 @@ public:
     virtual std::string GetBodyAsString(size_t maxSize
         = RESTC_CPP_SANE_DATA_LIMIT) = 0;
 
+    /*! Get the complete data from the server into buffer.
+     *
+     * The previous content of buffer is replaced, but its capacity
+     * is re-used. This is useful when polling a resource repeatedly.
+     *
+     * If there is no decompression or chunked transfer encoding,
+     * the data is read directly from the connection into buffer.
+     */
+    virtual void GetBodyInto(std::string& buffer, size_t maxSize
+        = RESTC_CPP_SANE_DATA_LIMIT) = 0;
+
+    /*! Get the complete data from the server into buffer.
+     *
+     * \see GetBodyInto(std::string&, size_t)
+     */
+    virtual void GetBodyInto(std::vector<char>& buffer, size_t maxSize
+        = RESTC_CPP_SANE_DATA_LIMIT) = 0;
+
+    /*! Read some data from the server into buffer.
+     *
+     * Like GetSomeData(), but the data is put in the callers
+     * buffer. If there is no decompression or chunked transfer
+     * encoding, it is read directly from the connection.
+     *
+     * \return The number of bytes read. 0 when there is
+     *      no more data to read.
+     */
+    virtual std::size_t ReadInto(boost::asio::mutable_buffers_1 buffer) = 0;
+
+    /*! Save the rest of the body to a file.
+     *
+     * Any existing file is overwritten.
+     *
+     * On Linux, a plain (not TLS) body without decompression or
+     * chunked transfer encoding is moved from the socket to the
+     * file with splice(2), without copying it through user space.
+     * Else it is written in large blocks.
+     *
+     * \param path File to write to.
+     * \param preallocate If true, and the server sent Content-Length,
+     *      reserve the disk space before we start writing.
+     * \return The number of bytes written.
+     */
+    virtual std::uint64_t SaveToFile(const boost::filesystem::path& path,
+                                     bool preallocate = true) = 0;
+
+    /*! Write the rest of the body into an existing file at offset.
+     *
+     * Like SaveToFile(), but the file is not truncated. This
+     * allows several replies to fill in different parts of the
+     * same file.
+     *
+     * \return The number of bytes written.
+     */
+    virtual std::uint64_t WriteToFileAt(const boost::filesystem::path& path,
+                                        std::uint64_t offset) = 0;
+
     /*! Get some data from the server.
      *
      * This is the lowest level to fetch data. Buffers will be
@@ -254,6 +410,38 @@ public:
     virtual std::deque<std::string> GetHeaders(const std::string& name) = 0;
 };
 
+/*! Base for Reply implementations that only provide GetSomeData()
+ *
+ * GetBodyInto(), ReadInto(), SaveToFile() and WriteToFileAt() copy the
+ * data from GetSomeData(). ReadInto() keeps what does not fit for the
+ * next call. SaveToFile() ignores preallocate.
+ */
+class BasicReply : public Reply {
+public:
+    void GetBodyInto(std::string& buffer, size_t maxSize
+        = RESTC_CPP_SANE_DATA_LIMIT) override;
+
+    void GetBodyInto(std::vector<char>& buffer, size_t maxSize
+        = RESTC_CPP_SANE_DATA_LIMIT) override;
+
+    std::size_t ReadInto(boost::asio::mutable_buffers_1 buffer) override;
+
+    std::uint64_t SaveToFile(const boost::filesystem::path& path,
+                             bool preallocate = true) override;
+
+    std::uint64_t WriteToFileAt(const boost::filesystem::path& path,
+                                std::uint64_t offset) override;
+
+private:
+    boost::asio::const_buffers_1 GetUnreadOrSomeData();
+    template <typename T> void CopyBodyInto(T& buffer, size_t maxSize);
+    std::uint64_t CopyBodyToFile(const boost::filesystem::path& path,
+                                 const boost::optional<std::uint64_t>& offset);
+
+    // Data from GetSomeData() that did not fit in the buffer given to ReadInto()
+    boost::asio::const_buffer unread_;
+};
+
 /*! The context is used to keep state within a co-routine.
  *
  * The Request and Reply classes depend on an instance of the
@@ -380,6 +568,13 @@ public:
 
 
     virtual std::shared_ptr<ConnectionPool> GetConnectionPool() = 0;
+
+    /*! Get the pool of read buffers shared by the requests */
+    virtual std::shared_ptr<IoBufferPool> GetIoBufferPool() = 0;
+
+    /*! Get the cache used by requests with Properties::cacheResponses */
+    virtual std::shared_ptr<ResponseCache> GetResponseCache() = 0;
+
     virtual boost::asio::io_service& GetIoService() = 0;
 
 #ifdef RESTC_CPP_WITH_TLS
@@ -0,0 +1,102 @@
+#include <brotli/decode.h>
+
+#include "restc-cpp/restc-cpp.h"
+#include "restc-cpp/DataReader.h"
+
+using namespace std;
+
+namespace restc_cpp {
+
+/*! Decompress a "br" (brotli) encoded body */
+class BrotliReaderImpl : public DataReader {
+public:
+    BrotliReaderImpl(std::unique_ptr<DataReader>&& source)
+    : source_{move(source)}
+    , state_{BrotliDecoderCreateInstance(nullptr, nullptr, nullptr)}
+    {
+        if (!state_) {
+            throw DecompressException("Failed to initialize brotli decompression");
+        }
+    }
+
+    ~BrotliReaderImpl() {
+        BrotliDecoderDestroyInstance(state_);
+    }
+
+    bool IsEof() const override {
+        return done_;
+    }
+
+    void SetContext(Context& ctx) override {
+        source_->SetContext(ctx);
+    }
+
+    void SetAddHeaderFn(add_header_fn_t fn) override {
+        source_->SetAddHeaderFn(move(fn));
+    }
+
+    boost::asio::const_buffers_1 ReadSome() override {
+        size_t data_len = 0;
+
+        while(!done_ && (data_len < out_buffer_.size())) {
+            if ((avail_in_ == 0)
+                && (result_ == BROTLI_DECODER_RESULT_NEEDS_MORE_INPUT)) {
+                if (data_len > 0) {
+                    break; // Return what we have before we do IO
+                }
+
+                const auto buffers = source_->ReadSome();
+                next_in_ = boost::asio::buffer_cast<const uint8_t *>(buffers);
+                avail_in_ = boost::asio::buffer_size(buffers);
+
+                if (avail_in_ == 0) {
+                    throw DecompressException("Decompression failed - premature end of stream.");
+                }
+            }
+
+            auto next_out = reinterpret_cast<uint8_t *>(
+                out_buffer_.data() + data_len);
+            size_t avail_out = out_buffer_.size() - data_len;
+
+            result_ = BrotliDecoderDecompressStream(state_,
+                                                    &avail_in_, &next_in_,
+                                                    &avail_out, &next_out,
+                                                    nullptr);
+            data_len = out_buffer_.size() - avail_out;
+
+            switch(result_) {
+                case BROTLI_DECODER_RESULT_SUCCESS:
+                    done_ = true;
+                    break;
+                case BROTLI_DECODER_RESULT_NEEDS_MORE_INPUT:
+                case BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT:
+                    break;
+                default:
+                    throw DecompressException(
+                        string("Decompression failed: ")
+                        + BrotliDecoderErrorString(
+                            BrotliDecoderGetErrorCode(state_)));
+            }
+        }
+
+        return {out_buffer_.data(), data_len};
+    }
+
+private:
+    unique_ptr<DataReader> source_;
+    BrotliDecoderState *state_ = nullptr;
+    BrotliDecoderResult result_ = BROTLI_DECODER_RESULT_NEEDS_MORE_INPUT;
+    const uint8_t *next_in_ = nullptr;
+    size_t avail_in_ = 0;
+    array<char, RESTC_CPP_IO_BUFFER_SIZE> out_buffer_;
+    bool done_ = false;
+};
+
+
+std::unique_ptr<DataReader>
+DataReader::CreateBrotliReader(std::unique_ptr<DataReader>&& source) {
+    return make_unique<BrotliReaderImpl>(move(source));
+}
+
+} // namepsace
+
@@ -25,35 +25,12 @@ public:
         return stream_->IsEof();
     }
 
-    string ToPrintable(boost::string_ref buf) const {
-        ostringstream out;
-        locale loc;
-        auto pos = 0;
-        out << endl;
-
-        for(const auto ch : buf) {
-            if (!(++pos % 80)) {
-                out << endl;
-            }
-            if (std::isprint(ch, loc)) {
-                out << ch;
-            } else {
-                out << '.';
-            }
-        }
-
-        return out.str();
+    void SetContext(Context& ctx) override {
+        stream_->SetContext(ctx);
     }
 
-    void Log(const boost::asio::const_buffers_1 buffers, const char *tag) {
-        const auto buf_len = boost::asio::buffer_size(*buffers.begin());
-
-        // At the time of the implementation, there are never multiple buffers.
-        RESTC_CPP_LOG_TRACE << tag << ' ' << "# " << buf_len
-            << " bytes: "
-            << ToPrintable({
-                boost::asio::buffer_cast<const char *>(*buffers.begin()),
-                           buf_len});
+    void SetAddHeaderFn(add_header_fn_t fn) override {
+        add_header_ = move(fn);
     }
 
     boost::asio::const_buffers_1 ReadSome() override {
@@ -65,11 +42,7 @@ public:
         }
 
         if (chunk_len_ == 0) {
-            RESTC_CPP_LOG_TRACE << "ChunkedReaderImpl::ReadSome(): Need new chunk.";
             chunk_len_ = GetNextChunkLen();
-            RESTC_CPP_LOG_TRACE << "ChunkedReaderImpl::ReadSome(): "
-                << "Next chunk is " << chunk_len_ << " bytes ("
-                << hex << chunk_len_ << " hex)";
             if (chunk_len_ == 0) {
                 // Read the trailer
                 RESTC_CPP_LOG_TRACE << "ChunkedReaderImpl::ReadSome(): End of chunked stream - reading headers";
@@ -80,11 +53,26 @@ public:
             }
         }
 
-        auto data = GetData();
-
-        Log(data, "ChunkedReaderImpl::ReadSome()");
+        // No tracing per chunk. With small chunks, even disabled trace
+        // statements cost more than the decoding.
+        return GetData();
+    }
 
-        return data;
+    void ReadSomeBuffers(write_buffers_t& buffers) override {
+        const auto data = ReadSome();
+        if (!boost::asio::buffer_size(data)) {
+            return;
+        }
+        buffers.push_back(*data.begin());
+
+        // Add the following chunks for as long as we have them in the
+        // buffer. We must not do IO here, as that would overwrite the
+        // data the buffers point to.
+        while(IsNextChunkBuffered()) {
+            const auto more = ReadSome();
+            assert(boost::asio::buffer_size(more));
+            buffers.push_back(*more.begin());
+        }
     }
 
 private:
@@ -116,34 +104,75 @@ private:
         return rval;
     }
 
-    size_t GetNextChunkLen() {
-        size_t chunk_len = 0;
-        char ch = stream_->Getc();
+    /* Check if the padding, the size-line and at least one byte of the
+     * next chunk is in the streams buffer.
+     */
+    bool IsNextChunkBuffered() const {
+        if (chunk_len_ || stream_->IsEof()) {
+            return false;
+        }
 
-        if (!isxdigit(ch)) {
-            throw ParseException("Missing chunk-length in new chunk.");
+        auto buffered = stream_->GetBuffered();
+        if (eat_chunk_padding_) {
+            if (buffered.size() < 2) {
+                return false;
+            }
+            buffered.remove_prefix(2);
+        }
+
+        // The size-line must end with CRLF, like GetLine() requires.
+        // Anything else is left for the normal path to report.
+        const auto cr = buffered.find('\r');
+        if ((cr == boost::string_ref::npos) || ((cr + 2) >= buffered.size())
+            || (buffered[cr + 1] != '\n')) {
+            return false;
         }
 
-        for(; isxdigit(ch); ch = stream_->Getc()) {
-            chunk_len *= 16;
+        // The last chunk is followed by the trailer, which may need IO.
+        size_t chunk_len = 0;
+        return ParseChunkLen(buffered.substr(0, cr), chunk_len)
+            && (chunk_len > 0);
+    }
+
+    /* Parse the hex chunk-size at the start of line.
+     *
+     * Any chunk extensions after the size are ignored.
+     */
+    static bool ParseChunkLen(boost::string_ref line, size_t& chunkLen) {
+        static const size_t max_digits = sizeof(size_t) * 2;
+        size_t digits = 0;
+        chunkLen = 0;
+
+        for(const auto ch : line) {
+            if (!isxdigit(static_cast<unsigned char>(ch))) {
+                // Only white-space before an extension may follow the size
+                if ((ch != ';') && (ch != ' ') && (ch != '\t')) {
+                    throw ParseException("Chunk: Invalid chunk-size line.");
+                }
+                break;
+            }
+            if (++digits > max_digits) {
+                throw ParseException("Chunk: Too many digits in chunk-length.");
+            }
+            chunkLen *= 16;
             if (ch >= 'a') {
-                chunk_len += 10 + (ch - 'a');
+                chunkLen += 10 + (ch - 'a');
             } else if (ch >= 'A') {
-                chunk_len += 10 + (ch - 'A');
+                chunkLen += 10 + (ch - 'A');
             } else {
-                chunk_len += ch - '0';
+                chunkLen += ch - '0';
             }
         }
 
-        for(; ch != '\r'; ch = stream_->Getc())
-            ;
+        return digits > 0;
+    }
 
-        if (ch != '\r') {
-            throw ParseException("Missing CR in first chunk line");
-        }
+    size_t GetNextChunkLen() {
+        size_t chunk_len = 0;
+        const auto line = stream_->GetLine(1024 * 4);
 
-        if ((ch = stream_->Getc()) != '\n') {
-            throw ParseException("Missing LF in first chunk line");
+        if (!ParseChunkLen(line, chunk_len)) {
+            throw ParseException("Missing chunk-length in new chunk.");
         }
 
         return chunk_len;
@@ -22,6 +22,20 @@ public:
         next_->WriteDirect(buffers);
     }
 
+    void WriteDirect(boost::asio::const_buffers_1 headers,
+                     const write_buffers_t& buffers) override {
+        const auto len = boost::asio::buffer_size(buffers);
+        if (len == 0) {
+            next_->WriteDirect(headers);
+            return;
+        }
+        buffers_.resize(1);
+        for(auto &b : buffers) {
+            buffers_.push_back(b);
+        }
+        DoWrite(len, &headers);
+    }
+
     void Write(boost::asio::const_buffers_1 buffers) override {
         const auto len = boost::asio::buffer_size(buffers);
         buffers_.resize(2);
@@ -64,7 +78,8 @@ public:
 
 private:
     // Set the chunk header and send the data
-    void DoWrite(const size_t len) {
+    void DoWrite(const size_t len,
+                 const boost::asio::const_buffers_1 *headers = nullptr) {
         if (len == 0) {
             return;
         }
@@ -95,7 +110,11 @@ private:
         header[digits++] = '\n';
 
         buffers_[0] = {header.data(), static_cast<size_t>(digits)};
-        next_->Write(buffers_);
+        if (headers) {
+            next_->WriteDirect(*headers, buffers_);
+        } else {
+            next_->Write(buffers_);
+        }
     }
 
     bool first_ = true;
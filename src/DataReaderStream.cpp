@@ -1,4 +1,7 @@
 
+#include <cctype>
+#include <cstring>
+
 #include "restc-cpp/DataReaderStream.h"
 #include "restc-cpp/error.h"
 #include "restc-cpp/url_encode.h"
@@ -49,6 +52,34 @@ DataReaderStream::ReadSome() {
     return rval;
 }
 
+size_t DataReaderStream::ReadInto(boost::asio::mutable_buffers_1 buffer) {
+    const auto buffered = GetBuffered();
+    if (!buffered.empty()) {
+        const auto bytes = boost::asio::buffer_copy(buffer,
+            boost::asio::const_buffers_1{buffered.data(), buffered.size()});
+        curr_ += bytes;
+
+        RESTC_CPP_LOG_TRACE << "DataReaderStream::ReadInto: Copied "
+            << bytes << " buffered bytes.";
+        return bytes;
+    }
+
+    const auto bytes = source_->ReadInto(buffer);
+    if (source_->IsEof()) {
+        SetEof();
+    }
+    return bytes;
+}
+
+size_t DataReaderStream::SpliceTo(int fd, size_t maxBytes) {
+    assert(GetBuffered().empty());
+    const auto bytes = source_->SpliceTo(fd, maxBytes);
+    if (source_->IsEof()) {
+        SetEof();
+    }
+    return bytes;
+}
+
 boost::asio::const_buffers_1
 DataReaderStream::GetData(size_t maxBytes) {
     Fetch();
@@ -68,71 +99,151 @@ DataReaderStream::GetData(size_t maxBytes) {
 }
 
 
+namespace {
+
+const size_t max_header_name_len = 256;
+const size_t max_header_value_len = 1024 * 4;
+const size_t max_header_line_len = max_header_name_len + max_header_value_len + 8;
+
+boost::string_ref Trim(boost::string_ref value) {
+    while(!value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+        value.remove_prefix(1);
+    }
+    while(!value.empty() && (value.back() == ' ' || value.back() == '\t')) {
+        value.remove_suffix(1);
+    }
+    return value;
+}
+
+} // anonymous namespace
+
+/* Get the next line, without the CRLF
+ *
+ * If the whole line is in the current buffer, we return a view
+ * into the buffer, located with memchr() (which the C library
+ * vectorizes). Only lines that span buffers are copied, one
+ * char at a time, to line_.
+ *
+ * The view is valid until the next read from the stream.
+ */
+boost::string_ref DataReaderStream::GetLine(const size_t maxLen) {
+    if (!curr_ || ((curr_ + 1) >= end_)) {
+        // Nothing buffered. Get more data, and step back so that
+        // curr_ points to the last consumed char, as after Getc().
+        Fetch();
+        --curr_;
+    }
+
+    const char *begin = curr_ + 1;
+    const auto len = static_cast<size_t>(end_ - begin);
+    const auto cr = static_cast<const char *>(memchr(begin, '\r', len));
+    if (cr && ((cr + 1) < end_)) {
+        if (cr[1] != '\n') {
+            throw ProtocolException("GetLine(): Missing LF after CR!");
+        }
+
+        const auto line_len = static_cast<size_t>(cr - begin);
+        if (line_len > maxLen) {
+            throw ConstraintException("GetLine(): Too long header line!");
+        }
+
+        curr_ = cr + 1; // Last consumed char is the LF
+        getc_bytes_ += line_len + 2;
+        return {begin, line_len};
+    }
+
+    line_.clear();
+    char ch = {};
+    for(ch = Getc(); ch != '\r'; ch = Getc()) {
+        line_ += ch;
+        if (line_.size() > maxLen) {
+            throw ConstraintException("GetLine(): Too long header line!");
+        }
+    }
+
+    if (Getc() != '\n') {
+        throw ProtocolException("GetLine(): Missing LF after CR!");
+    }
+
+    return line_;
+}
+
+/* Check if the next line is a continuation of the current header value.
+ *
+ * If it is, the leading white-space is consumed.
+ */
+bool DataReaderStream::SkipContinuation() {
+    const char ch = Getc();
+    if ((ch != ' ') && (ch != '\t')) {
+        Ungetc();
+        return false;
+    }
+    return true;
+}
+
 void DataReaderStream::ReadServerResponse(Reply::HttpResponse& response)
 {
-    string http_1_1{"HTTP/1.1"};
-    char ch = {};
+    static const string http_1_1{"HTTP/1.1"};
     getc_bytes_ = 0;
 
+    auto line = GetLine(16 + 1 + 3 + 1 + 256);
+
     // Get HTTP version
-    std::string value;
-    for(ch = Getc(); ch != ' '; ch = Getc()) {
-        value += ch;
-        if (value.size() > 16) {
+    auto pos = line.find(' ');
+    if (pos == boost::string_ref::npos) {
+        if (line.size() > 16) {
             throw ProtocolException("ReadHeaders(): Too much HTTP version!");
         }
-    }
-    if (ch != ' ') {
         throw ProtocolException("ReadHeaders(): No space after HTTP version");
     }
-    if (value.empty()) {
+    if (pos > 16) {
+        throw ProtocolException("ReadHeaders(): Too much HTTP version!");
+    }
+    if (pos == 0) {
         throw ProtocolException("ReadHeaders(): No HTTP version");
     }
-    if (ciEqLibC()(value, http_1_1)) {
+    const auto version = line.substr(0, pos);
+    if (ciEqLibC()(version.to_string(), http_1_1)) {
         ; // Do nothing HTTP 1.1 is the default value
     } else {
         throw ProtocolException(
             string("ReadHeaders(): unsupported HTTP version: ")
-                + url_encode(value));
+                + url_encode(version.to_string()));
     }
+    line.remove_prefix(pos + 1);
 
     // Get response code
-    value.clear();
-    for(ch = Getc(); ch != ' '; ch = Getc()) {
-        value += ch;
-        if (value.size() > 3) {
-            throw ProtocolException("ReadHeaders(): Too much HTTP response code!");
-        }
+    pos = line.find(' ');
+    const auto code = line.substr(0, pos);
+    if (code.size() > 3) {
+        throw ProtocolException("ReadHeaders(): Too much HTTP response code!");
     }
-    if (value.size() != 3) {
+    // Not isdigit(), as the bytes from the wire may be negative chars
+    const auto is_digit = [](const char ch) {
+        return (ch >= '0') && (ch <= '9');
+    };
+    if ((code.size() != 3)
+        || !is_digit(code[0]) || !is_digit(code[1]) || !is_digit(code[2])) {
         throw ProtocolException(
             string("ReadHeaders(): Incorrect length of HTTP response code!: ")
-            + value);
+            + code.to_string());
     }
 
-    response.status_code = stoi(value);
-
-    if (ch != ' ') {
-        throw ProtocolException("ReadHeaders(): No space after HTTP response code");
-    }
+    response.status_code = (code[0] - '0') * 100
+        + (code[1] - '0') * 10
+        + (code[2] - '0');
 
     // Get response text
-    value.clear();
-    for(ch = Getc(); ch != '\r'; ch = Getc()) {
-        value += ch;
-        if (value.size() > 256) {
+    if (pos == boost::string_ref::npos) {
+        response.reason_phrase.clear();
+    } else {
+        line.remove_prefix(pos + 1);
+        if (line.size() > 256) {
             throw ConstraintException("ReadHeaders(): Too long HTTP response phrase!");
         }
+        response.reason_phrase.assign(line.data(), line.size());
     }
 
-    // Skip CRLF
-    assert(ch == '\r');
-    ch = Getc();
-    if (ch != '\n') {
-        throw ProtocolException("ReadHeaders(): No CR/LF after HTTP response phrase!");
-    }
-
-    response.reason_phrase = move(value);
     RESTC_CPP_LOG_TRACE << "ReadServerResponse: getc_bytes is " <<  getc_bytes_;
 
     RESTC_CPP_LOG_TRACE << "HTTP Response: "
@@ -144,82 +255,51 @@ void DataReaderStream::ReadServerResponse(Reply::HttpResponse& response)
 
 void DataReaderStream::ReadHeaderLines(const add_header_fn_t& addHeader) {
     while(true) {
-        char ch;
-        std::string name, value;
-        for(ch = Getc(); ch != '\r'; ch = Getc()) {
-            if (ch == ' ' || ch == '\t') {
-                continue;
-            }
-            if (ch == ':') {
-                value = GetHeaderValue();
-                ch = '\n';
-                break;
-            }
-            name += ch;
-            if (name.size() > 256) {
-                throw ConstraintException("Chunk Trailer: Header name too long!");
-            }
-        }
-
-        if (ch == '\r') {
-            ch = Getc();
-        }
-
-        if (ch != '\n') {
-            throw ProtocolException("Chunk Trailer: Missing LF after parse!");
-        }
+        const auto line = GetLine(max_header_line_len);
 
-        if (name.empty()) {
-            if (!value.empty()) {
-                throw ProtocolException("Chunk Trailer: Header value without name!");
-            }
+        if (line.empty()) {
             RESTC_CPP_LOG_TRACE << "ReadHeaderLines: getc_bytes is " <<  getc_bytes_;
             getc_bytes_ = 0;
             return; // An empty line marks the end of the trailer
         }
 
-        if (++num_headers_ > 256) {
-            throw ConstraintException("Chunk Trailer: Too many lines in header!");
+        const auto colon = line.find(':');
+        const auto name_view = Trim(line.substr(0, colon));
+        const auto value_view = (colon == boost::string_ref::npos)
+            ? boost::string_ref{} : Trim(line.substr(colon + 1));
+
+        if (name_view.empty()) {
+            throw ProtocolException("Chunk Trailer: Header value without name!");
         }
 
-        RESTC_CPP_LOG_TRACE << name << ": " << value;
-        addHeader(move(name), move(value));
-        name.clear();
-        value.clear();
-    }
-}
+        if (name_view.size() > max_header_name_len) {
+            throw ConstraintException("Chunk Trailer: Header name too long!");
+        }
 
-std::string DataReaderStream::GetHeaderValue() {
-    std::string value;
-    char ch;
+        if (value_view.size() > max_header_value_len) {
+            throw ConstraintException("Chunk Trailer: Header value too long!");
+        }
 
-    while(true) {
-        for (ch = Getc(); ch == ' ' || ch == '\t'; ch = Getc())
-            ; // skip space
+        // Copy before we read more, as that may invalidate the views
+        std::string name{name_view.data(), name_view.size()};
+        std::string value{value_view.data(), value_view.size()};
 
-        for (; ch != '\r'; ch = Getc()) {
-            value += ch;
-            if (value.size() > (1024 * 4)) {
+        // Obsolete line folding
+        while(SkipContinuation()) {
+            const auto more = Trim(GetLine(max_header_line_len));
+            value += ' ';
+            value.append(more.data(), more.size());
+            if (value.size() > max_header_value_len) {
                 throw ConstraintException("Chunk Trailer: Header value too long!");
             }
         }
 
-        if (ch != '\r') {
-            throw ProtocolException("Chunk Trailer: Missing CR!");
-        }
-
-        if ((ch = Getc()) != '\n') {
-            throw ProtocolException("Chunk Trailer: Missing LF!");
-        }
-
-        // Peek
-        ch = Getc();
-        if ((ch != ' ') && (ch != '\t')) {
-            Ungetc();
-            return value;
+        if (++num_headers_ > 256) {
+            throw ConstraintException("Chunk Trailer: Too many lines in header!");
         }
 
-        value += ' ';
+        RESTC_CPP_LOG_TRACE << name << ": " << value;
+        addHeader(move(name), move(value));
     }
 }
 
@@ -0,0 +1,90 @@
+
+#include <map>
+#include <mutex>
+
+#include "restc-cpp/restc-cpp.h"
+#include "restc-cpp/logging.h"
+#include "restc-cpp/IoBufferPool.h"
+
+using namespace std;
+
+namespace restc_cpp {
+
+class IoBufferPoolImpl : public IoBufferPool
+    , public std::enable_shared_from_this<IoBufferPoolImpl> {
+public:
+    IoBufferPoolImpl(const Request::Properties& properties)
+    : max_size_{max<size_t>(properties.ioBufferMaxSize,
+                            RESTC_CPP_IO_BUFFER_SIZE)}
+    , max_idle_bytes_{properties.ioBufferPoolMaxIdleBytes}
+    {
+    }
+
+    handle_t Get(size_t size) override {
+        const auto actual_size = GetActualSize(size);
+        unique_ptr<buffer_t> buffer;
+
+        {
+            lock_guard<mutex> lock(mutex_);
+            auto& idle = idle_[actual_size];
+            if (!idle.empty()) {
+                buffer = move(idle.back());
+                idle.pop_back();
+                idle_bytes_ -= actual_size;
+            }
+        }
+
+        if (!buffer) {
+            buffer = make_unique<buffer_t>(actual_size);
+        }
+
+        weak_ptr<IoBufferPoolImpl> weak_pool = shared_from_this();
+        return {buffer.release(), [weak_pool](buffer_t *b) {
+            unique_ptr<buffer_t> returned{b};
+            if (auto pool = weak_pool.lock()) {
+                pool->Release(move(returned));
+            }
+        }};
+    }
+
+    size_t GetIdleBytes() const override {
+        lock_guard<mutex> lock(mutex_);
+        return idle_bytes_;
+    }
+
+private:
+    void Release(unique_ptr<buffer_t>&& buffer) {
+        const auto size = buffer->size();
+
+        lock_guard<mutex> lock(mutex_);
+        if ((idle_bytes_ + size) > max_idle_bytes_) {
+            return; // Let it go
+        }
+
+        idle_[size].push_back(move(buffer));
+        idle_bytes_ += size;
+    }
+
+    // Round up to the next power of two within our limits
+    size_t GetActualSize(const size_t size) const noexcept {
+        size_t actual_size = RESTC_CPP_IO_BUFFER_SIZE;
+        while((actual_size < size) && (actual_size < max_size_)) {
+            actual_size *= 2;
+        }
+        return actual_size;
+    }
+
+    const size_t max_size_;
+    const size_t max_idle_bytes_;
+    size_t idle_bytes_ = 0;
+    map<size_t, vector<unique_ptr<buffer_t>>> idle_;
+    mutable mutex mutex_;
+};
+
+
+IoBufferPool::ptr_t
+IoBufferPool::Create(const Request::Properties& properties) {
+    return make_shared<IoBufferPoolImpl>(properties);
+}
+
+} // restc_cpp
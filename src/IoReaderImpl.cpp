@@ -4,35 +4,122 @@
 #include "restc-cpp/DataReader.h"
 #include "restc-cpp/logging.h"
 #include "restc-cpp/IoTimer.h"
+#include "restc-cpp/IoBufferPool.h"
 
 using namespace std;
 
 namespace restc_cpp {
 
 
+/*! Reads from the socket into buffers borrowed from the clients IoBufferPool
+ *
+ * The buffer is kept until the next read, so the data returned
+ * remains valid until then. When the previous read did not fill
+ * the buffer, we wait for the socket to become readable before we
+ * borrow the next buffer. The buffer size grows while the reads
+ * fill the buffers, and shrinks again when they don't.
+ */
 class IoReaderImpl : public DataReader {
 public:
-    using buffer_t = std::array<char, RESTC_CPP_IO_BUFFER_SIZE>;
-
     IoReaderImpl(const Connection::ptr_t& conn, Context& ctx,
                  const ReadConfig& cfg)
-    : ctx_{ctx}, connection_{conn}, cfg_{cfg}
+    : ctx_{&ctx}, connection_{conn}, cfg_{cfg}
+    , pool_{ctx.GetClient().GetIoBufferPool()}
     {
     }
 
+    void SetContext(Context& ctx) override {
+        ctx_ = &ctx;
+    }
+
     boost::asio::const_buffers_1 ReadSome() override {
         if (auto conn = connection_.lock()) {
+            // Let the buffer go while we wait
+            const bool was_full = buffer_ && (last_read_ == buffer_->size());
+            buffer_.reset();
+
+            auto timer = IoTimer::Create("IoReaderImpl",
+                                        cfg_.msReadTimeout,
+                                        conn);
+
+            if (!was_full) {
+                conn->GetSocket().AsyncWaitForData(ctx_->GetYield());
+            }
+
+            buffer_ = pool_->Get(read_size_);
+            last_read_ = conn->GetSocket().AsyncReadSome(
+                {buffer_->data(), buffer_->size()}, ctx_->GetYield());
+
+            timer->Cancel();
+
+            AdjustReadSize();
+
+            RESTC_CPP_LOG_TRACE << "Read #" << last_read_
+                << " bytes from " << conn;
+            return {buffer_->data(), last_read_};
+        }
+
+        throw ObjectExpiredException("Connection expired");
+    }
+
+    bool CanReadInto() const noexcept override {
+        return true;
+    }
+
+    size_t ReadInto(boost::asio::mutable_buffers_1 buffer) override {
+        if (auto conn = connection_.lock()) {
+            // The data from the previous read is no longer valid
+            buffer_.reset();
+            last_read_ = 0;
+
             auto timer = IoTimer::Create("IoReaderImpl",
                                         cfg_.msReadTimeout,
                                         conn);
+
             const auto bytes = conn->GetSocket().AsyncReadSome(
-                {buffer_.data(), buffer_.size()}, ctx_.GetYield());
+                buffer, ctx_->GetYield());
 
             timer->Cancel();
 
             RESTC_CPP_LOG_TRACE << "Read #" << bytes
-                << " bytes from " << conn;
-            return {buffer_.data(), bytes};
+                << " bytes directly into the callers buffer from " << conn;
+            return bytes;
+        }
+
+        throw ObjectExpiredException("Connection expired");
+    }
+
+    bool CanSpliceTo() const noexcept override {
+        if (auto conn = connection_.lock()) {
+            return conn->GetSocket().CanSplice();
+        }
+        return false;
+    }
+
+    size_t SpliceTo(int fd, size_t maxBytes) override {
+        if (auto conn = connection_.lock()) {
+            buffer_.reset();
+            last_read_ = 0;
+
+            auto timer = IoTimer::Create("IoReaderImpl",
+                                        cfg_.msReadTimeout,
+                                        conn);
+
+            const auto bytes = conn->GetSocket().AsyncSpliceTo(
+                fd, maxBytes, ctx_->GetYield());
+
+            timer->Cancel();
+
+            if ((bytes == 0) && maxBytes) {
+                RESTC_CPP_LOG_TRACE << "End of stream while splicing from "
+                    << conn << ". Closing it.";
+                conn->GetSocket().Close();
+                return 0;
+            }
+
+            RESTC_CPP_LOG_TRACE << "Spliced #" << bytes
+                << " bytes to fd " << fd << " from " << conn;
+            return bytes;
         }
 
         throw ObjectExpiredException("Connection expired");
@@ -46,10 +133,26 @@ public:
     }
 
 private:
-    Context& ctx_;
+    void AdjustReadSize() noexcept {
+        const auto size = buffer_->size();
+        if (last_read_ == size) {
+            // The pool caps the size to the configured max
+            read_size_ = size * 2;
+        } else if ((last_read_ < (size / 4))
+            && (size > RESTC_CPP_IO_BUFFER_SIZE)) {
+            read_size_ = size / 2;
+        } else {
+            read_size_ = size;
+        }
+    }
+
+    Context *ctx_;
     const std::weak_ptr<Connection> connection_;
     const ReadConfig cfg_;
-    buffer_t buffer_;
+    const IoBufferPool::ptr_t pool_;
+    IoBufferPool::handle_t buffer_;
+    std::size_t read_size_ = RESTC_CPP_IO_BUFFER_SIZE;
+    std::size_t last_read_ = 0;
 };
 
 
@@ -23,6 +23,20 @@ public:
         Write(buffers);
     }
 
+    void WriteDirect(boost::asio::const_buffers_1 headers,
+                     const write_buffers_t& buffers) override {
+        if (buffers.empty()) {
+            Write(headers);
+            return;
+        }
+
+        write_buffers_t gathered;
+        gathered.reserve(buffers.size() + 1);
+        gathered.push_back(*headers.begin());
+        gathered.insert(gathered.end(), buffers.begin(), buffers.end());
+        Write(gathered);
+    }
+
     void Write(boost::asio::const_buffers_1 buffers) override {
 
         {
@@ -17,6 +17,14 @@ public:
     boost::asio::const_buffers_1 ReadSome() override {
         return {nullptr, 0};
     }
+
+    bool CanReadInto() const noexcept override {
+        return true;
+    }
+
+    size_t ReadInto(boost::asio::mutable_buffers_1 /*buffer*/) override {
+        return 0;
+    }
 };
 
 DataReader::ptr_t
@@ -19,6 +19,10 @@ public:
         return remaining_ == 0;
     }
 
+    void SetContext(Context& ctx) override {
+        source_->SetContext(ctx);
+    }
+
     boost::asio::const_buffers_1 ReadSome() override {
 
         if (IsEof()) {
@@ -36,6 +40,47 @@ public:
         return buffer;
     }
 
+    bool CanReadInto() const noexcept override {
+        return source_->CanReadInto();
+    }
+
+    size_t ReadInto(boost::asio::mutable_buffers_1 buffer) override {
+        if (IsEof()) {
+            return 0;
+        }
+
+        // Don't read into the next response on the connection
+        const auto max_bytes = std::min(remaining_,
+                                        boost::asio::buffer_size(buffer));
+        const auto bytes = source_->ReadInto(
+            {boost::asio::buffer_cast<char *>(buffer), max_bytes});
+        if ((bytes == 0) && source_->IsEof()) {
+            throw ProtocolException("Body-size is less than content-size");
+        }
+        remaining_ -= bytes;
+        return bytes;
+    }
+
+    bool CanSpliceTo() const noexcept override {
+        return source_->CanSpliceTo();
+    }
+
+    size_t SpliceTo(int fd, size_t maxBytes) override {
+        if (IsEof()) {
+            return 0;
+        }
+
+        // splice() moves nothing when the server closed the connection,
+        // even if the socket is still open at our end.
+        const auto max_bytes = std::min(remaining_, maxBytes);
+        const auto bytes = source_->SpliceTo(fd, max_bytes);
+        if ((bytes == 0) && max_bytes) {
+            throw ProtocolException("Body-size is less than content-size");
+        }
+        remaining_ -= bytes;
+        return bytes;
+    }
+
 private:
     size_t remaining_;
     ptr_t source_;
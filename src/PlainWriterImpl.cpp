@@ -21,6 +21,11 @@ public:
         next_->WriteDirect(buffers);
     }
 
+    void WriteDirect(boost::asio::const_buffers_1 headers,
+                     const write_buffers_t& buffers) override {
+        next_->WriteDirect(headers, buffers);
+    }
+
     void Write(boost::asio::const_buffers_1 buffers) override {
         next_->Write(buffers);
     }
@@ -3,6 +3,11 @@
 
 #include<boost/tokenizer.hpp>
 
+#ifdef __linux__
+#   include <fcntl.h>
+#   include <unistd.h>
+#endif
+
 #include "restc-cpp/logging.h"
 #include "restc-cpp/helper.h"
 #include "restc-cpp/error.h"
@@ -16,6 +21,213 @@ using namespace std;
 
 namespace restc_cpp {
 
+namespace {
+
+/* The file we write to in SaveToFile()
+ *
+ * On Linux we use the file descriptor directly, so that
+ * we can splice data into it and preallocate space.
+ */
+#ifdef __linux__
+class OutputFile {
+public:
+    OutputFile(const boost::filesystem::path& path,
+               const boost::optional<uint64_t>& offset)
+    : path_{path}
+    {
+        fd_ = ::open(path.c_str(),
+                     O_WRONLY | O_CREAT | O_CLOEXEC | (offset ? 0 : O_TRUNC),
+                     0666);
+        if (fd_ < 0) {
+            Throw("Failed to open file: ");
+        }
+
+        if (offset && (::lseek(fd_, static_cast<off_t>(*offset), SEEK_SET) < 0)) {
+            Throw("Failed to seek in file: ");
+        }
+    }
+
+    ~OutputFile() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+
+    bool CanSplice() const noexcept {
+        return true;
+    }
+
+    int GetFd() const noexcept {
+        return fd_;
+    }
+
+    void Preallocate(uint64_t offset, uint64_t size) {
+        // Reserve the blocks without changing the file size. This is
+        // only a hint, so we ignore file-systems that don't support it.
+        if (fallocate(fd_, FALLOC_FL_KEEP_SIZE, static_cast<off_t>(offset),
+                      static_cast<off_t>(size)) != 0) {
+            RESTC_CPP_LOG_DEBUG << "Failed to preallocate " << size
+                << " bytes for " << path_ << ": " << strerror(errno);
+        }
+    }
+
+    void Write(const char *data, size_t len) {
+        while(len) {
+            const auto written = ::write(fd_, data, len);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                Throw("file write failed: ");
+            }
+            data += written;
+            len -= static_cast<size_t>(written);
+        }
+    }
+
+    void Close() {
+        const auto fd = fd_;
+        fd_ = -1;
+        if (::close(fd) != 0) {
+            Throw("Failed to close file: ");
+        }
+    }
+
+private:
+    [[noreturn]] void Throw(const char *what) const {
+        const auto err = errno;
+        throw IoException(string{what} + path_.string() + ": "
+            + to_string(err) + " " + strerror(err));
+    }
+
+    const boost::filesystem::path path_;
+    int fd_ = -1;
+};
+#else
+class OutputFile {
+public:
+    OutputFile(const boost::filesystem::path& path,
+               const boost::optional<uint64_t>& offset)
+    : path_{path}
+    {
+        if (offset) {
+            // Open an existing file without truncating it
+            file_.open(path.string(), ios::binary | ios::in | ios::out);
+            file_.seekp(static_cast<streamoff>(*offset));
+        } else {
+            file_.open(path.string(), ios::binary | ios::out | ios::trunc);
+        }
+
+        if (!file_) {
+            throw IoException(string{"Failed to open file: "}
+                + path_.string());
+        }
+    }
+
+    bool CanSplice() const noexcept {
+        return false;
+    }
+
+    int GetFd() const noexcept {
+        return -1;
+    }
+
+    void Preallocate(uint64_t /*offset*/, uint64_t /*size*/) {}
+
+    void Write(const char *data, size_t len) {
+        if (!file_.write(data, static_cast<streamsize>(len))) {
+            throw IoException(string{"file write failed: "}
+                + path_.string());
+        }
+    }
+
+    void Close() {
+        file_.close();
+        if (!file_) {
+            throw IoException(string{"Failed to close file: "}
+                + path_.string());
+        }
+    }
+
+private:
+    const boost::filesystem::path path_;
+    fstream file_;
+};
+#endif
+
+} // anonymous namespace
+
+void BasicReply::GetBodyInto(std::string& buffer, const size_t maxSize) {
+    CopyBodyInto(buffer, maxSize);
+}
+
+void BasicReply::GetBodyInto(std::vector<char>& buffer, const size_t maxSize) {
+    CopyBodyInto(buffer, maxSize);
+}
+
+size_t BasicReply::ReadInto(boost::asio::mutable_buffers_1 buffer) {
+    const boost::asio::const_buffer data = *GetUnreadOrSomeData().begin();
+    const auto bytes = boost::asio::buffer_copy(buffer, data);
+    unread_ = data + bytes;
+    return bytes;
+}
+
+uint64_t BasicReply::SaveToFile(const boost::filesystem::path& path,
+                           const bool /*preallocate*/) {
+    return CopyBodyToFile(path, {});
+}
+
+uint64_t BasicReply::WriteToFileAt(const boost::filesystem::path& path,
+                              const uint64_t offset) {
+    return CopyBodyToFile(path, offset);
+}
+
+boost::asio::const_buffers_1 BasicReply::GetUnreadOrSomeData() {
+    if (boost::asio::buffer_size(unread_)) {
+        const boost::asio::const_buffers_1 rval{unread_};
+        unread_ = {};
+        return rval;
+    }
+
+    return MoreDataToRead() ? GetSomeData()
+        : boost::asio::const_buffers_1{nullptr, 0};
+}
+
+template <typename T>
+void BasicReply::CopyBodyInto(T& buffer, const size_t maxSize) {
+    buffer.clear();
+
+    for(auto data = GetUnreadOrSomeData(); boost::asio::buffer_size(data);
+        data = GetUnreadOrSomeData()) {
+
+        const auto bytes = boost::asio::buffer_size(data);
+        if ((buffer.size() + bytes) >= maxSize) {
+            throw ConstraintException(
+                "Too much data for the curent buffer limit.");
+        }
+
+        const auto *ptr = boost::asio::buffer_cast<const char*>(data);
+        buffer.insert(buffer.end(), ptr, ptr + bytes);
+    }
+}
+
+uint64_t BasicReply::CopyBodyToFile(const boost::filesystem::path& path,
+                               const boost::optional<uint64_t>& offset) {
+    OutputFile file{path, offset};
+
+    uint64_t bytes = 0;
+    for(auto data = GetUnreadOrSomeData(); boost::asio::buffer_size(data);
+        data = GetUnreadOrSomeData()) {
+
+        const auto len = boost::asio::buffer_size(data);
+        file.Write(boost::asio::buffer_cast<const char*>(data), len);
+        bytes += len;
+    }
+
+    file.Close();
+    return bytes;
+}
+
 
 boost::optional<string> ReplyImpl::GetHeader(const string& name) {
     boost::optional<string> rval;
@@ -68,6 +280,17 @@ ReplyImpl::ReplyImpl(Connection::ptr_t connection,
 
 
 ReplyImpl::~ReplyImpl() {
+    if (connection_ && connection_->GetSocket().IsOpen()) {
+        try {
+            if (DrainBody()) {
+                return;
+            }
+        } catch(std::exception& ex) {
+            RESTC_CPP_LOG_TRACE << "~ReplyImpl(): Failed to start draining the body: "
+                << ex.what();
+        }
+    }
+
     if (connection_ && connection_->GetSocket().IsOpen()) {
         try {
             RESTC_CPP_LOG_TRACE << "~ReplyImpl(): " << *connection_
@@ -81,6 +304,80 @@ ReplyImpl::~ReplyImpl() {
     }
 }
 
+/* Read and discard the rest of a small body in a new co-routine,
+ * so that the connection can go back to the pool without blocking
+ * the co-routine that owns the reply.
+ *
+ * Returns true if the connection was handed over to the co-routine.
+ */
+bool ReplyImpl::DrainBody() {
+    if (!reader_ || do_close_connection_ || !properties_->drainMaxBytes) {
+        return false;
+    }
+
+    // The readers may be in an undefined state after an error
+#if __cplusplus >= 201703L
+    if (std::uncaught_exceptions()) {
+#else
+    if (std::uncaught_exception()) {
+#endif
+        return false;
+    }
+
+    const auto max_bytes = properties_->drainMaxBytes;
+    if (content_length_ && (*content_length_ > max_bytes)) {
+        return false;
+    }
+
+    struct Drain {
+        Connection::ptr_t connection;
+        DataReader::ptr_t reader;
+    };
+
+    auto drain = make_shared<Drain>();
+    drain->connection = move(connection_);
+    drain->reader = move(reader_);
+
+    // The trailer of a chunked body would be added to our headers_
+    drain->reader->SetAddHeaderFn([](string&& /*name*/, string&& /*value*/) {});
+    pending_ = {};
+
+    const auto timeout = properties_->drainTimeoutMs;
+    owner_.Process([drain, max_bytes, timeout](Context& ctx) {
+        static const auto timer_name = "DrainBody"s;
+
+        try {
+            drain->reader->SetContext(ctx);
+            auto timer = IoTimer::Create(timer_name, timeout, drain->connection);
+
+            size_t bytes = 0;
+            while(!drain->reader->IsEof()) {
+                bytes += boost::asio::buffer_size(drain->reader->ReadSome());
+                if (bytes > max_bytes) {
+                    throw ConstraintException("The body is too large to drain");
+                }
+            }
+
+            timer->Cancel();
+
+            RESTC_CPP_LOG_TRACE << "DrainBody(): Drained " << bytes
+                << " bytes from " << *drain->connection;
+        } catch(std::exception& ex) {
+            RESTC_CPP_LOG_TRACE << "DrainBody(): Failed to drain the body from "
+                << *drain->connection << ": " << ex.what();
+            if (drain->connection->GetSocket().IsOpen()) {
+                drain->connection->GetSocket().Close();
+            }
+        }
+
+        // Release the connection (to the pool if it is still open)
+        drain->reader.reset();
+        drain->connection.reset();
+    });
+
+    return true;
+}
+
 void ReplyImpl::StartReceiveFromServer(DataReader::ptr_t&& reader) {
     if (reader_) {
         throw RestcCppException("StartReceiveFromServer() is already called.");
@@ -94,24 +391,76 @@ void ReplyImpl::StartReceiveFromServer(DataReader::ptr_t&& reader) {
 
     assert(reader);
     auto stream = make_unique<DataReaderStream>(move(reader));
-    stream->ReadServerResponse(response_);
-    stream->ReadHeaderLines(
+
+    // Skip interim responses, like a "100 Continue" that arrived late
+    do {
+        ReadResponseHeader(*stream);
+    } while (IsInterimResponse());
+
+    FinishReceiveHeader(move(stream));
+}
+
+bool ReplyImpl::ReceiveContinue(DataReader::ptr_t&& reader) {
+    if (reader_) {
+        throw RestcCppException("StartReceiveFromServer() is already called.");
+    }
+
+    static const auto timer_name = "ReceiveContinue"s;
+
+    auto timer = IoTimer::Create(timer_name,
+                                     properties_->replyTimeoutMs,
+                                     connection_);
+
+    assert(reader);
+    auto stream = make_unique<DataReaderStream>(move(reader));
+    ReadResponseHeader(*stream);
+
+    if (IsInterimResponse()) {
+        RESTC_CPP_LOG_TRACE << "Got interim response "
+            << response_.status_code << " " << response_.reason_phrase;
+
+        // The request owns the connection. Don't close it in the destructor.
+        connection_.reset();
+        return true;
+    }
+
+    FinishReceiveHeader(move(stream));
+    return false;
+}
+
+void ReplyImpl::ReadResponseHeader(DataReaderStream& stream) {
+    headers_.clear();
+    stream.ReadServerResponse(response_);
+    stream.ReadHeaderLines(
         [this](std::string&& name, std::string&& value) {
             headers_.insert({move(name), move(value)});
     });
+}
 
+void ReplyImpl::FinishReceiveHeader(unique_ptr<DataReaderStream>&& stream) {
     HandleContentType(move(stream));
     HandleConnectionLifetime();
     HandleDecompression();
     CheckIfWeAreDone();
 }
 
+bool ReplyImpl::IsInterimResponse() const noexcept {
+    // 101 Switching Protocols is the last response on the connection
+    return (response_.status_code >= 100)
+        && (response_.status_code < 200)
+        && (response_.status_code != 101);
+}
+
 void ReplyImpl::HandleContentType(unique_ptr<DataReaderStream>&& stream) {
     static const std::string content_len_name{"Content-Length"};
     static const std::string transfer_encoding_name{"Transfer-Encoding"};
     static const std::string chunked_name{"chunked"};
 
-    if (request_type_ == Request::Type::HEAD) {
+    // RFC 9112, 6.3: These never have a body, whatever the headers say
+    const auto status = response_.status_code;
+    if ((request_type_ == Request::Type::HEAD)
+        || ((status >= 100) && (status < 200))
+        || (status == 204) || (status == 304)) {
         reader_ = DataReader::CreateNoBodyReader();
     } else if (const auto cl = GetHeader(content_len_name)) {
         content_length_ = stoi(*cl);
@@ -144,10 +493,33 @@ void ReplyImpl::HandleConnectionLifetime() {
     }
 }
 
+#ifdef RESTC_CPP_WITH_ZLIB
+DataReader::ptr_t ReplyImpl::CreateZipReader(DataReader::ptr_t&& source,
+                                             const bool gzip,
+                                             const bool readsBody) {
+#ifdef RESTC_CPP_WITH_LIBDEFLATE
+    // Content-Length is only the size of the input to the first decoder
+    if (readsBody && content_length_
+        && (*content_length_ <= RESTC_CPP_LIBDEFLATE_MAX_SIZE)) {
+        return gzip
+            ? DataReader::CreateGzipBufferReader(move(source), *content_length_)
+            : DataReader::CreateZipBufferReader(move(source), *content_length_);
+    }
+#else
+    (void)readsBody;
+#endif
+    return gzip
+        ? DataReader::CreateGzipReader(move(source))
+        : DataReader::CreateZipReader(move(source));
+}
+#endif // RESTC_CPP_WITH_ZLIB
+
 void ReplyImpl::HandleDecompression() {
     static const std::string content_encoding{"Content-Encoding"};
     static const std::string gzip{"gzip"};
     static const std::string deflate{"deflate"};
+    static const std::string br{"br"};
+    static const std::string zstd{"zstd"};
 
     const auto te_hdr = GetHeader(content_encoding);
     if (!te_hdr) {
@@ -159,12 +531,24 @@ void ReplyImpl::HandleDecompression() {
 #ifdef RESTC_CPP_WITH_ZLIB
         if (ciEqLibC()(gzip, *it)) {
             RESTC_CPP_LOG_TRACE << "Adding gzip reader to " << *connection_;
-            reader_ = DataReader::CreateGzipReader(move(reader_));
+            reader_ = CreateZipReader(move(reader_), true, it == tok.begin());
         } else if (ciEqLibC()(deflate, *it)) {
             RESTC_CPP_LOG_TRACE << "Adding deflate reader to " << *connection_;
-            reader_ = DataReader::CreateZipReader(move(reader_));
+            reader_ = CreateZipReader(move(reader_), false, it == tok.begin());
         } else
 #endif // RESTC_CPP_WITH_ZLIB
+#ifdef RESTC_CPP_WITH_BROTLI
+        if (ciEqLibC()(br, *it)) {
+            RESTC_CPP_LOG_TRACE << "Adding brotli reader to " << *connection_;
+            reader_ = DataReader::CreateBrotliReader(move(reader_));
+        } else
+#endif // RESTC_CPP_WITH_BROTLI
+#ifdef RESTC_CPP_WITH_ZSTD
+        if (ciEqLibC()(zstd, *it)) {
+            RESTC_CPP_LOG_TRACE << "Adding zstd reader to " << *connection_;
+            reader_ = DataReader::CreateZstdReader(move(reader_));
+        } else
+#endif // RESTC_CPP_WITH_ZSTD
         {
             RESTC_CPP_LOG_ERROR << "Unsupported compression: '"
                 << url_encode(*it)
@@ -175,6 +559,13 @@ void ReplyImpl::HandleDecompression() {
 }
 
 boost::asio::const_buffers_1 ReplyImpl::GetSomeData()  {
+    if (boost::asio::buffer_size(pending_)) {
+        boost::asio::const_buffers_1 rval{pending_};
+        pending_ = {};
+        CheckIfWeAreDone();
+        return rval;
+    }
+
     auto rval = reader_
         ? reader_->ReadSome()
         : boost::asio::const_buffers_1{nullptr, 0};
@@ -182,14 +573,81 @@ boost::asio::const_buffers_1 ReplyImpl::GetSomeData()  {
     return rval;
 }
 
+size_t ReplyImpl::ReadInto(boost::asio::mutable_buffers_1 buffer) {
+    size_t bytes = 0;
+    if (!boost::asio::buffer_size(pending_)
+        && reader_ && reader_->CanReadInto()) {
+        bytes = reader_->ReadInto(buffer);
+    } else {
+        while (!boost::asio::buffer_size(pending_)
+            && reader_ && !reader_->IsEof()) {
+            pending_ = *reader_->ReadSome().begin();
+        }
+        bytes = boost::asio::buffer_copy(buffer, pending_);
+        pending_ = pending_ + bytes;
+    }
+
+    CheckIfWeAreDone();
+    return bytes;
+}
+
 string ReplyImpl::GetBodyAsString(const size_t maxSize) {
     std::string buffer;
+    ReadBodyInto(buffer, maxSize);
+    return buffer;
+}
+
+void ReplyImpl::GetBodyInto(std::string& buffer, const size_t maxSize) {
+    ReadBodyInto(buffer, maxSize);
+}
+
+void ReplyImpl::GetBodyInto(std::vector<char>& buffer, const size_t maxSize) {
+    ReadBodyInto(buffer, maxSize);
+}
+
+template <typename T>
+void ReplyImpl::ReadBodyInto(T& buffer, const size_t maxSize) {
+    buffer.clear();
+
+    if (content_length_ && reader_ && reader_->CanReadInto()
+        && !boost::asio::buffer_size(pending_)) {
+
+        // Read straight from the connection into the callers memory
+        if (*content_length_ >= maxSize) {
+            throw ConstraintException(
+                "Too much data for the curent buffer limit.");
+        }
+
+        buffer.resize(*content_length_);
+        size_t used = 0;
+        while((used < buffer.size()) && !IsEof()) {
+            const auto bytes = reader_->ReadInto({&buffer[used],
+                                                  buffer.size() - used});
+            if (!bytes) {
+                break;
+            }
+            used += bytes;
+        }
+        buffer.resize(used);
+
+        ReleaseConnection();
+        return;
+    }
+
     if (content_length_) {
         buffer.reserve(*content_length_);
     }
 
-    while(!IsEof()) {
-        auto data = reader_->ReadSome();
+    write_buffers_t data;
+    if (boost::asio::buffer_size(pending_)) {
+        data.push_back(pending_);
+        pending_ = {};
+    }
+
+    while(!data.empty() || !IsEof()) {
+        if (data.empty()) {
+            reader_->ReadSomeBuffers(data);
+        }
 
         const auto buffer_size = boost::asio::buffer_size(data);
         if ((buffer.size() + buffer_size) >= maxSize) {
@@ -197,12 +655,73 @@ string ReplyImpl::GetBodyAsString(const size_t maxSize) {
                 "Too much data for the curent buffer limit.");
         }
 
-        buffer.append(boost::asio::buffer_cast<const char*>(data),
-                      buffer_size);
+        for(const auto& b : data) {
+            const auto *ptr = boost::asio::buffer_cast<const char*>(b);
+            buffer.insert(buffer.end(), ptr, ptr + boost::asio::buffer_size(b));
+        }
+        data.clear();
     }
 
     ReleaseConnection();
-    return buffer;
+}
+
+uint64_t ReplyImpl::SaveToFile(const boost::filesystem::path& path,
+                               const bool preallocate) {
+    return WriteBodyToFile(path, {}, preallocate);
+}
+
+uint64_t ReplyImpl::WriteToFileAt(const boost::filesystem::path& path,
+                                  const uint64_t offset) {
+    return WriteBodyToFile(path, offset, true);
+}
+
+uint64_t ReplyImpl::WriteBodyToFile(const boost::filesystem::path& path,
+                                    const boost::optional<uint64_t>& offset,
+                                    const bool preallocate) {
+    static constexpr size_t block_size = 1024 * 1024;
+
+    OutputFile file{path, offset};
+    if (preallocate && content_length_) {
+        file.Preallocate(offset.value_or(0), *content_length_);
+    }
+
+    uint64_t bytes = 0;
+    vector<char> buffer;
+    size_t used = 0;
+
+    auto flush = [&] {
+        file.Write(buffer.data(), used);
+        bytes += used;
+        used = 0;
+    };
+
+    while(!IsEof()) {
+        if (file.CanSplice() && reader_->CanSpliceTo()
+            && !boost::asio::buffer_size(pending_)) {
+            flush();
+            bytes += reader_->SpliceTo(file.GetFd(), block_size);
+            continue;
+        }
+
+        // Collect the data in large blocks before we write it
+        if (buffer.empty()) {
+            buffer.resize(block_size);
+        }
+
+        used += ReadInto({buffer.data() + used, buffer.size() - used});
+        if (used == buffer.size()) {
+            flush();
+        }
+    }
+
+    flush();
+    file.Close();
+
+    RESTC_CPP_LOG_DEBUG << "Saved " << bytes << " bytes to " << path
+        << " at offset " << offset.value_or(0);
+
+    ReleaseConnection();
+    return bytes;
 }
 
 void ReplyImpl::CheckIfWeAreDone() {
@@ -227,6 +746,39 @@ void ReplyImpl::ReleaseConnection() {
     }
 }
 
+bool ReplyImpl::StoreInCache(ResponseCache& cache, const std::string& key) {
+    assert(reader_);
+
+    auto entry = ResponseCache::CreateEntry(response_, headers_);
+    if (!entry) {
+        return false;
+    }
+
+    if (content_length_
+        && (*content_length_ > cache.GetMaxEntrySize())) {
+        return false;
+    }
+
+    reader_ = cache.CreateStoringReader(move(reader_), key, move(entry));
+    return true;
+}
+
+std::unique_ptr<ReplyImpl>
+ReplyImpl::CreateFromCache(Context& ctx,
+                           RestClient& owner,
+                           Request::Properties::ptr_t& properties,
+                           Request::Type type,
+                           ResponseCache::entry_t entry) {
+
+    assert(entry);
+    auto reply = make_unique<ReplyImpl>(nullptr, ctx, owner, properties, type);
+    reply->response_ = entry->response;
+    reply->headers_ = entry->headers;
+    reply->content_length_ = entry->body.size();
+    reply->reader_ = ResponseCache::CreateReader(move(entry));
+    return reply;
+}
+
 std::unique_ptr<ReplyImpl>
 ReplyImpl::Create(Connection::ptr_t connection,
        Context& ctx,
@@ -13,6 +13,7 @@
 #include "restc-cpp/Socket.h"
 #include "restc-cpp/IoTimer.h"
 #include "restc-cpp/DataReader.h"
+#include "restc-cpp/ResponseCache.h"
 
 using namespace std;
 
@@ -37,6 +38,20 @@ public:
 
     void StartReceiveFromServer(DataReader::ptr_t&& reader);
 
+    /*! Read the servers answer to "Expect: 100-continue"
+     *
+     * \return true if the server sent "100 Continue". The instance
+     *      is then of no further use. If the server sent a final
+     *      response, the reply is ready as if StartReceiveFromServer()
+     *      was called, and false is returned.
+     */
+    bool ReceiveContinue(DataReader::ptr_t&& reader);
+
+    /*! Close the connection when we are done with the reply */
+    void CloseConnectionWhenDone() {
+        do_close_connection_ = true;
+    }
+
     int GetResponseCode() const override {
         return response_.status_code;
     }
@@ -50,6 +65,20 @@ public:
     string GetBodyAsString(size_t maxSize
         = RESTC_CPP_SANE_DATA_LIMIT) override;
 
+    void GetBodyInto(std::string& buffer, size_t maxSize
+        = RESTC_CPP_SANE_DATA_LIMIT) override;
+
+    void GetBodyInto(std::vector<char>& buffer, size_t maxSize
+        = RESTC_CPP_SANE_DATA_LIMIT) override;
+
+    size_t ReadInto(boost::asio::mutable_buffers_1 buffer) override;
+
+    uint64_t SaveToFile(const boost::filesystem::path& path,
+                        bool preallocate = true) override;
+
+    uint64_t WriteToFileAt(const boost::filesystem::path& path,
+                           uint64_t offset) override;
+
     bool MoreDataToRead() override {
         return !IsEof();
     }
@@ -65,22 +94,53 @@ public:
            Request::Properties::ptr_t& properties,
            Request::Type type);
 
+    /*! Create a reply that returns a cached entry */
+    static std::unique_ptr<ReplyImpl>
+    CreateFromCache(Context& ctx,
+                    RestClient& owner,
+                    Request::Properties::ptr_t& properties,
+                    Request::Type type,
+                    ResponseCache::entry_t entry);
+
+    /*! Store the reply in cache when the body is read
+     *
+     * \return false if the reply cannot be cached.
+     */
+    bool StoreInCache(ResponseCache& cache, const std::string& key);
+
+    const headers_t& GetAllHeaders() const noexcept {
+        return headers_;
+    }
+
     static boost::string_ref b2sr(boost::asio::const_buffers_1 buffer) {
         return { boost::asio::buffer_cast<const char*>(buffer),
             boost::asio::buffer_size(buffer)};
     }
 
     bool IsEof() const {
-        return !reader_ || reader_->IsEof();
+        return (!reader_ || reader_->IsEof())
+            && (boost::asio::buffer_size(pending_) == 0);
     }
 
 
 protected:
+    void ReadResponseHeader(DataReaderStream& stream);
+    void FinishReceiveHeader(std::unique_ptr<DataReaderStream>&& stream);
+    bool IsInterimResponse() const noexcept;
     void CheckIfWeAreDone();
+    bool DrainBody();
     void ReleaseConnection();
     void HandleDecompression();
+#ifdef RESTC_CPP_WITH_ZLIB
+    DataReader::ptr_t CreateZipReader(DataReader::ptr_t&& source, bool gzip,
+                                      bool readsBody);
+#endif
     void HandleContentType(std::unique_ptr<DataReaderStream>&& stream);
     void HandleConnectionLifetime();
+    template <typename T> void ReadBodyInto(T& buffer, size_t maxSize);
+    uint64_t WriteBodyToFile(const boost::filesystem::path& path,
+                             const boost::optional<uint64_t>& offset,
+                             bool preallocate);
 
     Connection::ptr_t connection_;
     Context& ctx_;
@@ -92,6 +152,8 @@ protected:
     boost::optional<size_t> content_length_;
     const boost::uuids::uuid connection_id_;
     std::unique_ptr<DataReader> reader_;
+    // Data from reader_ that did not fit in the buffer given to ReadInto()
+    boost::asio::const_buffer pending_;
     const Request::Type request_type_;
 };
 
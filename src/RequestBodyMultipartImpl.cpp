@@ -0,0 +1,296 @@
+#include <assert.h>
+#include <array>
+
+#include <boost/uuid/uuid_generators.hpp>
+
+#include "restc-cpp/restc-cpp.h"
+#include "restc-cpp/logging.h"
+#include "restc-cpp/RequestBody.h"
+#include "restc-cpp/MultipartFormData.h"
+#include "restc-cpp/DataWriter.h"
+
+using namespace std;
+
+
+namespace restc_cpp {
+namespace impl {
+
+class RequestBodyMultipartImpl : public RequestBody
+{
+public:
+    using part_t = MultipartFormData::Part;
+
+    RequestBodyMultipartImpl(MultipartFormData form)
+    : form_{move(form)}
+    {
+        boundary_ = form_.GetBoundary();
+        if (boundary_.empty()) {
+            do {
+                boundary_ = "restc-cpp-"s
+                    + boost::uuids::to_string(boost::uuids::random_generator()());
+            } while(!IsBoundaryUnused());
+        } else if (!IsBoundaryUnused()) {
+            throw ConstraintException("The multipart boundary \""s
+                + boundary_ + "\" occurs in the data of a part");
+        }
+
+        bool first = true;
+        for(const auto& part : form_.GetParts()) {
+            preambles_.push_back(BuildPreamble(part, first));
+            first = false;
+
+            switch(part.type) {
+                case part_t::Type::STRING:
+                    size_ += part.data.size();
+                    break;
+                case part_t::Type::FILE:
+                    size_ += boost::filesystem::file_size(part.path);
+                    break;
+                case part_t::Type::PROVIDER:
+                    have_provider_ = true;
+                    break;
+            }
+            size_ += preambles_.back().size();
+        }
+
+        closing_ = (first ? "--"s : "\r\n--"s) + boundary_ + "--\r\n";
+        size_ += closing_.size();
+    }
+
+    Type GetType() const noexcept override {
+        return have_provider_ ? Type::CHUNKED_LAZY_PUSH : Type::FIXED_SIZE;
+    }
+
+    uint64_t GetFixedSize() const override {
+        if (have_provider_) {
+            throw NotImplementedException("GetFixedSize()");
+        }
+        return size_;
+    }
+
+    bool GetData(write_buffers_t & buffers) override {
+        if (eof_) {
+            return false;
+        }
+
+        const auto& parts = form_.GetParts();
+        if (current_part_ == parts.size()) {
+            buffers.push_back({closing_.c_str(), closing_.size()});
+            eof_ = true;
+            return true;
+        }
+
+        const auto& part = parts[current_part_];
+        if (!sent_preamble_) {
+            const auto& preamble = preambles_[current_part_];
+            buffers.push_back({preamble.c_str(), preamble.size()});
+            sent_preamble_ = true;
+        }
+
+        if (!GetPartData(part, buffers) || part_done_) {
+            NextPart();
+        }
+
+        return true;
+    }
+
+    void PushData(DataWriter& writer) override {
+        write_buffers_t buffers;
+        const auto& parts = form_.GetParts();
+        for(; current_part_ < parts.size(); NextPart()) {
+            const auto& part = parts[current_part_];
+            const auto& preamble = preambles_[current_part_];
+            writer.Write({preamble.c_str(), preamble.size()});
+            sent_preamble_ = true;
+
+            if (part.type == part_t::Type::PROVIDER) {
+                part.provider(writer);
+                continue;
+            }
+
+            while(true) {
+                buffers.clear();
+                if (!GetPartData(part, buffers)) {
+                    break;
+                }
+                writer.Write(buffers);
+            }
+        }
+
+        writer.Write({closing_.c_str(), closing_.size()});
+        eof_ = true;
+    }
+
+    void SetHeaders(Request::headers_t& headers) override {
+        static const string content_type{"Content-Type"};
+        headers[content_type] = "multipart/form-data; boundary=" + boundary_;
+    }
+
+    void Reset() override {
+        eof_ = false;
+        current_part_ = 0;
+        sent_preamble_ = false;
+        part_done_ = false;
+        file_.reset();
+    }
+
+    std::string GetCopyOfData() const override {
+        std::string data;
+        const auto& parts = form_.GetParts();
+        for(size_t i = 0; i < parts.size(); ++i) {
+            data += preambles_[i];
+            if (parts[i].type == part_t::Type::FILE) {
+                ifstream file(parts[i].path.string(), ios::binary);
+                data.append(istreambuf_iterator<char>(file),
+                            istreambuf_iterator<char>());
+            } else {
+                data += parts[i].data;
+            }
+        }
+        data += closing_;
+        return data;
+    }
+
+private:
+    /* Add the next piece of data from the part to buffers.
+     *
+     * Returns false when there is no more data in the part.
+     */
+    bool GetPartData(const part_t& part, write_buffers_t& buffers) {
+        switch(part.type) {
+            case part_t::Type::STRING:
+                if (part_done_) {
+                    return false;
+                }
+                part_done_ = true;
+                if (!part.data.empty()) {
+                    buffers.push_back({part.data.c_str(), part.data.size()});
+                }
+                return true;
+            case part_t::Type::FILE:
+                return GetFileData(part, buffers);
+            case part_t::Type::PROVIDER:
+                break;
+        }
+
+        return false;
+    }
+
+    bool GetFileData(const part_t& part, write_buffers_t& buffers) {
+        if (!file_) {
+            file_ = make_unique<ifstream>(part.path.string(), ios::binary);
+            if (!file_->is_open()) {
+                throw IoException(string{"Failed to open file: "}
+                    + part.path.string());
+            }
+        }
+
+        file_->read(buffer_.data(), buffer_.size());
+        const size_t read_this_time = static_cast<size_t>(file_->gcount());
+        if (read_this_time == 0) {
+            if (file_->eof()) {
+                RESTC_CPP_LOG_DEBUG << "Successfully added file "
+                    << part.path << " to the multipart body.";
+                file_.reset();
+                return false;
+            }
+
+            const auto err = errno;
+            throw IoException(string{"file read failed: "}
+                + to_string(err) + " " + strerror(err));
+        }
+
+        buffers.push_back({buffer_.data(), read_this_time});
+        return true;
+    }
+
+    /* The boundary must not occur in the data.
+     *
+     * Only the string parts can be checked up front. The files and
+     * providers are not read before the body is sent.
+     */
+    bool IsBoundaryUnused() const {
+        for(const auto& part : form_.GetParts()) {
+            if ((part.type == part_t::Type::STRING)
+                && (part.data.find(boundary_) != std::string::npos)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void NextPart() {
+        ++current_part_;
+        sent_preamble_ = false;
+        part_done_ = false;
+        file_.reset();
+    }
+
+    std::string BuildPreamble(const part_t& part, bool first) const {
+        std::string preamble = first ? "--"s : "\r\n--"s;
+        preamble += boundary_;
+        preamble += "\r\nContent-Disposition: form-data; name=\"";
+        preamble += Quote(part.name);
+        preamble += '\"';
+        if (!part.fileName.empty()) {
+            preamble += "; filename=\"";
+            preamble += Quote(part.fileName);
+            preamble += '\"';
+        }
+        preamble += "\r\n";
+        if (!part.contentType.empty()) {
+            preamble += "Content-Type: ";
+            preamble += part.contentType;
+            preamble += "\r\n";
+        }
+        preamble += "\r\n";
+        return preamble;
+    }
+
+    // Escape the characters that can't go into a quoted value
+    static std::string Quote(const std::string& value) {
+        std::string quoted;
+        quoted.reserve(value.size());
+        for(const auto ch : value) {
+            switch(ch) {
+                case '\"':
+                    quoted += "%22";
+                    break;
+                case '\r':
+                    quoted += "%0D";
+                    break;
+                case '\n':
+                    quoted += "%0A";
+                    break;
+                default:
+                    quoted += ch;
+            }
+        }
+        return quoted;
+    }
+
+    const MultipartFormData form_;
+    std::string boundary_;
+    std::deque<std::string> preambles_;
+    std::string closing_;
+    uint64_t size_ = 0;
+    bool have_provider_ = false;
+    bool eof_ = false;
+    size_t current_part_ = 0;
+    bool sent_preamble_ = false;
+    bool part_done_ = false;
+    unique_ptr<ifstream> file_;
+    array<char, 1024 * 8> buffer_;
+};
+
+
+} // impl
+
+unique_ptr<RequestBody> RequestBody::CreateMultipartBody(
+    MultipartFormData form) {
+
+    return make_unique<impl::RequestBodyMultipartImpl>(move(form));
+}
+
+} // restc_cpp
+
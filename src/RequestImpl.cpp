@@ -15,6 +15,7 @@
 #include "restc-cpp/error.h"
 #include "restc-cpp/url_encode.h"
 #include "restc-cpp/RequestBody.h"
+#include "restc-cpp/ResponseCache.h"
 #include "ReplyImpl.h"
 
 using namespace std;
@@ -146,8 +147,7 @@ public:
 
 
 private:
-    void ValidateReply(const Reply& reply) {
-        const auto& response = reply.GetHttpResponse();
+    void ValidateReply(const Reply::HttpResponse& response) {
         if (response.status_code > 299) switch(response.status_code) {
             case 401:
                 throw HttpAuthenticationException(response);
@@ -211,9 +211,22 @@ private:
         headers_t headers = properties_->headers;
         assert(writer_);
 
-        // Let the writers set their individual headers.
+        // Let the body and the writers set their individual headers.
+        if (body_) {
+            body_->SetHeaders(headers);
+        }
         writer_->SetHeaders(headers);
 
+        for(const auto& it : conditional_headers_) {
+            headers[it.first] = it.second;
+        }
+
+        if (expect_continue_) {
+            static const string expect{"Expect"};
+            static const string continue_100{"100-continue"};
+            headers[expect] = continue_100;
+        }
+
         if (headers.find(host) == headers.end()) {
             request_buffer << host << ": " << parsed_url_.GetHost().to_string() << crlf;
         }
@@ -307,74 +320,223 @@ private:
                 }
             }
 
+            // Pooled connections may carry the option from another request
+            SetTcpNodelay(*connection);
             return connection;
         }
 
         throw FailedToConnectException("Failed to connect");
     }
 
+    void SetTcpNodelay(Connection& connection) {
+        boost::system::error_code ec;
+        connection.GetSocket().GetSocket().set_option(
+            boost::asio::ip::tcp::no_delay(properties_->tcpNodelay), ec);
+        if (ec) {
+            RESTC_CPP_LOG_WARN << "Failed to set TCP_NODELAY: "
+                << ec.message();
+        }
+    }
+
+    void SetTcpCork(bool cork) {
+#ifdef TCP_CORK
+        if (!properties_->tcpCork) {
+            return;
+        }
+
+        using tcp_cork_t = boost::asio::detail::socket_option::boolean<
+            IPPROTO_TCP, TCP_CORK>;
+        boost::system::error_code ec;
+        connection_->GetSocket().GetSocket().set_option(tcp_cork_t(cork), ec);
+        if (ec) {
+            RESTC_CPP_LOG_WARN << "Failed to set TCP_CORK: "
+                << ec.message();
+        }
+#else
+        (void)cork;
+#endif
+    }
+
+    // Uncorks the socket if sending the request fails
+    class TcpCorkGuard {
+    public:
+        TcpCorkGuard(RequestImpl& request, bool cork)
+        : request_{cork ? &request : nullptr} {
+            if (request_) {
+                request_->SetTcpCork(true);
+            }
+        }
+
+        ~TcpCorkGuard() {
+            if (request_) {
+                request_->SetTcpCork(false);
+            }
+        }
+
+        // The request is sent. GetReply() uncorks the socket.
+        void Release() noexcept {
+            request_ = nullptr;
+        }
+
+        TcpCorkGuard(const TcpCorkGuard&) = delete;
+        TcpCorkGuard& operator = (const TcpCorkGuard&) = delete;
+
+    private:
+        RequestImpl *request_;
+    };
+
     void SendRequestPayload(Context& ctx,
-                      write_buffers_t write_buffer) {
+                            boost::asio::const_buffers_1 headers) {
 
         static const auto timer_name = "SendRequestPayload"s;
-        bool have_sent_headers = false;
+        write_buffers_t write_buffer;
+
+        // Pull the first part of the body so that it can be sent
+        // together with the headers in one write operation.
+        // If we expect "100 Continue", we send only the headers now,
+        // and start pulling the body in the loop below.
+        bool more_data = expect_continue_;
+        if (!expect_continue_ && body_
+            && (body_->GetType() != RequestBody::Type::CHUNKED_LAZY_PUSH)) {
+            more_data = body_->GetData(write_buffer);
+        }
 
-        while(boost::asio::buffer_size(write_buffer))
         {
             auto timer = IoTimer::Create(timer_name,
                 properties_->sendTimeoutMs, connection_);
 
             try {
+                writer_->WriteDirect(headers, write_buffer);
+            } catch(const exception& ex) {
+                RESTC_CPP_LOG_WARN << "Write failed with exception type: "
+                    << typeid(ex).name()
+                    << ", message: " << ex.what();
+                throw;
+            }
+        }
 
-                if (!have_sent_headers) {
+        bytes_sent_ += boost::asio::buffer_size(headers)
+            + boost::asio::buffer_size(write_buffer);
 
-                    auto b = write_buffer[0];
+        if (!body_) {
+            return; // No more data to send
+        }
 
-                    writer_->WriteDirect(
-                        {boost::asio::buffer_cast<const char *>(b),
-                        boost::asio::buffer_size(b)});
+        if (expect_continue_ && !WaitForContinue(ctx)) {
+            return; // The server rejected the request
+        }
 
-                    have_sent_headers = true;
+        if (body_->GetType() == RequestBody::Type::CHUNKED_LAZY_PUSH) {
+            body_->PushData(*writer_);
+            return;
+        }
 
-                    if (write_buffer.size() > 1) {
-                        write_buffer.erase(write_buffer.begin());
-                        writer_->Write(write_buffer);
-                    }
+        while(more_data) {
+            write_buffer.clear();
+            if (!body_->GetData(write_buffer)) {
+                return;
+            }
 
-                } else {
-                    writer_->Write(write_buffer);
-                }
+            if (!boost::asio::buffer_size(write_buffer)) {
+                continue;
+            }
 
-                bytes_sent_ += boost::asio::buffer_size(write_buffer);
+            auto timer = IoTimer::Create(timer_name,
+                properties_->sendTimeoutMs, connection_);
 
+            try {
+                writer_->Write(write_buffer);
+                bytes_sent_ += boost::asio::buffer_size(write_buffer);
             } catch(const exception& ex) {
                 RESTC_CPP_LOG_WARN << "Write failed with exception type: "
                     << typeid(ex).name()
                     << ", message: " << ex.what();
                 throw;
             }
+        }
+    }
 
-            write_buffer.clear();
+    /* Wait for the servers answer to "Expect: 100-continue"
+     *
+     * Returns true if we shall send the body.
+     */
+    bool WaitForContinue(Context& ctx) {
+        if (properties_->expectContinueTimeoutMs <= 0) {
+            return true;
+        }
+
+        // The TLS layer sends records of its own, like session tickets,
+        // so a readable socket does not mean that the server answered.
+        // Send the body at once. A late "100 Continue" is skipped by
+        // the reply.
+        if (parsed_url_.GetProtocol() == Url::Protocol::HTTPS) {
+            RESTC_CPP_LOG_TRACE << "Not waiting for 100-continue over TLS on "
+                << *connection_ << ". Sending the body.";
+            return true;
+        }
+
+        if (!WaitForServerData(ctx, properties_->expectContinueTimeoutMs)) {
+            RESTC_CPP_LOG_TRACE << "No answer to Expect: 100-continue from "
+                << *connection_ << ". Sending the body.";
+            return true;
+        }
+
+        DataReader::ReadConfig cfg;
+        cfg.msReadTimeout = properties_->recvTimeout;
+        auto reply = ReplyImpl::Create(connection_, ctx, owner_, properties_,
+                                       request_type_);
+        if (reply->ReceiveContinue(
+            DataReader::CreateIoReader(connection_, ctx, cfg))) {
+            return true;
+        }
+
+        RESTC_CPP_LOG_DEBUG << "The server answered "
+            << reply->GetResponseCode()
+            << " before the body was sent. Skipping the body on "
+            << *connection_;
+
+        // The server cannot tell our next request from the body it expects
+        reply->CloseConnectionWhenDone();
+        early_reply_ = move(reply);
+        return false;
+    }
 
-            if (body_) {
-                switch(body_->GetType()) {
-                    case RequestBody::Type::FIXED_SIZE:
-                    case RequestBody::Type::CHUNKED_LAZY_PULL:
-                        if (!body_->GetData(write_buffer)) {
-                            return;
-                        }
-                        break;
-                    case RequestBody::Type::CHUNKED_LAZY_PUSH:
-                        body_->PushData(*writer_);
+    /* Wait until the server sends something, or until we time out.
+     *
+     * Returns false on time-out. The connection remains open.
+     */
+    bool WaitForServerData(Context& ctx, int timeoutMs) {
+        static const auto timer_name = "WaitForServerData"s;
+
+        std::weak_ptr<Connection> weak_connection = connection_;
+        auto timer = IoTimer::Create(timer_name, timeoutMs,
+            owner_.GetIoService(), [weak_connection]() {
+                if (auto connection = weak_connection.lock()) {
+                    boost::system::error_code ec;
+                    connection->GetSocket().GetSocket().cancel(ec);
                 }
-            } else {
-                return; // No more data to send
-            }
+            });
+
+        boost::system::error_code ec;
+        connection_->GetSocket().GetSocket().async_read_some(
+            boost::asio::null_buffers(), ctx.GetYield()[ec]);
+        timer->Cancel();
+
+        if (timer->IsExpiered()) {
+            return false;
         }
+
+        if (ec) {
+            throw boost::system::system_error(ec);
+        }
+
+        return true;
     }
 
     DataWriter& SendRequest(Context& ctx) override {
         bytes_sent_ = 0;
+        early_reply_.reset();
+        expect_continue_ = body_ && properties_->expectContinue;
 
         connection_ = Connect(ctx);
         DataWriter::WriteConfig cfg;
@@ -401,16 +563,19 @@ private:
 
         // TODO: Add compression
 
-        write_buffers_t write_buffer;
         ToBuffer headers(BuildOutgoingRequest());
-        write_buffer.push_back(headers);
-        header_size_ = boost::asio::buffer_size(write_buffer);
+        header_size_ = boost::asio::buffer_size(
+            static_cast<boost::asio::const_buffers_1>(headers));
 
         RESTC_CPP_LOG_TRACE << "Request: " << (const boost::string_ref)headers
             << ' ' << *connection_;
 
-        PrepareBody();
-        SendRequestPayload(ctx, write_buffer);
+        {
+            TcpCorkGuard cork{*this, !expect_continue_};
+            PrepareBody();
+            SendRequestPayload(ctx, headers);
+            cork.Release();
+        }
 
         RESTC_CPP_LOG_DEBUG << "Sent " << Verb(request_type_) << " request to '" << url_ << "' "
             << *connection_;
@@ -421,28 +586,79 @@ private:
 
     unique_ptr<Reply> GetReply(Context& ctx) override {
 
-        // We will not send more data regarding the current request
-        writer_->Finish();
-        writer_.reset();
+        unique_ptr<ReplyImpl> reply;
 
-        DataReader::ReadConfig cfg;
-        cfg.msReadTimeout = properties_->recvTimeout;
-        auto reply = ReplyImpl::Create(connection_, ctx, owner_, properties_,
-                                       request_type_);
-        reply->StartReceiveFromServer(
-            DataReader::CreateIoReader(connection_, ctx, cfg));
+        if (early_reply_) {
+            // The server answered before we sent the body
+            writer_.reset();
+            reply = move(early_reply_);
+        } else {
+            // We will not send more data regarding the current request
+            writer_->Finish();
+            writer_.reset();
+
+            SetTcpCork(false);
+
+            DataReader::ReadConfig cfg;
+            cfg.msReadTimeout = properties_->recvTimeout;
+            reply = ReplyImpl::Create(connection_, ctx, owner_, properties_,
+                                      request_type_);
+            reply->StartReceiveFromServer(
+                DataReader::CreateIoReader(connection_, ctx, cfg));
+        }
 
         const auto http_code = reply->GetResponseCode();
-        if (http_code == 301 || http_code == 302) {
+        if (IsRedirect(http_code)) {
             auto redirect_location = reply->GetHeader("Location");
             if (!redirect_location) {
                 throw ProtocolException(
                     "No Location header in redirect reply");
             }
+
+            if (((http_code == 301) || (http_code == 308))
+                && UseRedirectCache()) {
+                owner_.GetResponseCache()->AddPermanentRedirect(
+                    GetCacheKey(), *redirect_location, reply->GetAllHeaders(),
+                    http_code);
+            }
+
+            // Release the reply before we throw, so that it can drain
+            // the body and leave the connection in the pool.
+            reply.reset();
             throw RedirectException(http_code, *redirect_location);
         }
 
-        ValidateReply(*reply);
+        if (cached_ && (http_code == 304)) {
+            // Our cached copy is still valid
+            auto entry = ResponseCache::Revalidate(*cached_,
+                                                   reply->GetAllHeaders());
+            reply.reset();
+            RESTC_CPP_LOG_TRACE << "Revalidated cached reply for " << cache_key_;
+            response_cache_->Put(cache_key_, entry);
+            return ReplyImpl::CreateFromCache(ctx, owner_, properties_,
+                                              request_type_, move(entry));
+        }
+
+        if (http_code > 299) {
+            // Release the reply before we throw, so that it can drain
+            // the body and leave the connection in the pool.
+            const auto response = reply->GetHttpResponse();
+            reply.reset();
+            ValidateReply(response);
+        }
+
+        if (properties_->cachePermanentRedirects && IsUnsafeMethod()) {
+            // RFC 9111, 4.4: The resource may have changed
+            owner_.GetResponseCache()->RemovePermanentRedirect(GetCacheKey());
+        }
+
+        if (!cache_key_.empty()) {
+            if ((request_type_ != Type::GET) || body_
+                || !reply->StoreInCache(*response_cache_, cache_key_)) {
+                // RFC 9111, 4.4: Unsafe methods invalidate the stored reply
+                response_cache_->Remove(cache_key_);
+            }
+        }
 
         /* Return the reply. At this time the reply headers and body
             * is returned. However, the body may or may not be
@@ -454,23 +670,134 @@ private:
 
 
 
+    /* 307 and 308 require that the method and body is unchanged.
+     * We also keep them for 301 and 302.
+     */
+    static bool IsRedirect(const int httpCode) noexcept {
+        return (httpCode == 301) || (httpCode == 302)
+            || (httpCode == 307) || (httpCode == 308);
+    }
+
+    /* Only redirects of GET and HEAD requests are cached and used.
+     * The redirect of an unsafe method may not apply to other methods.
+     */
+    bool UseRedirectCache() const noexcept {
+        return properties_->cachePermanentRedirects
+            && ((request_type_ == Type::GET) || (request_type_ == Type::HEAD));
+    }
+
+    bool IsUnsafeMethod() const noexcept {
+        return (request_type_ == Type::POST) || (request_type_ == Type::PUT)
+            || (request_type_ == Type::DELETE) || (request_type_ == Type::PATCH);
+    }
+
     unique_ptr<Reply> DoExecute(Context& ctx) {
+        if (UseRedirectCache()) {
+            if (const auto redirect = owner_.GetResponseCache()
+                ->GetPermanentRedirect(GetCacheKey())) {
+                RESTC_CPP_LOG_TRACE << "Using cached redirect for " << url_;
+                throw RedirectException(redirect->status_code,
+                                        redirect->location);
+            }
+        }
+
+        if (auto reply = GetCachedReply(ctx)) {
+            return reply;
+        }
         SendRequest(ctx);
         return GetReply(ctx);
     }
 
+    /* Look up the current url in the response cache.
+     *
+     * Returns the cached reply if it is fresh. If it is stale,
+     * the validators are added to the request headers.
+     */
+    unique_ptr<Reply> GetCachedReply(Context& ctx) {
+        cache_key_.clear();
+        cached_.reset();
+        conditional_headers_.clear();
+
+        if (!properties_->cacheResponses
+            || (request_type_ == Type::HEAD)
+            || (request_type_ == Type::OPTIONS)
+            || !ResponseCache::IsRequestCacheable(properties_->headers)) {
+            return {};
+        }
+
+        response_cache_ = owner_.GetResponseCache();
+        cache_key_ = GetCacheKey();
+
+        if ((request_type_ != Type::GET) || body_) {
+            return {};
+        }
+
+        cached_ = response_cache_->Get(cache_key_);
+        if (!cached_) {
+            return {};
+        }
+
+        if (cached_->IsFresh()
+            && !ResponseCache::MustRevalidate(properties_->headers)) {
+            RESTC_CPP_LOG_DEBUG << "Using cached reply for " << cache_key_;
+            return ReplyImpl::CreateFromCache(ctx, owner_, properties_,
+                                              request_type_, cached_);
+        }
+
+        static const string etag{"ETag"};
+        static const string last_modified{"Last-Modified"};
+
+        auto it = cached_->headers.find(etag);
+        if (it != cached_->headers.end()) {
+            conditional_headers_["If-None-Match"] = it->second;
+        }
+
+        it = cached_->headers.find(last_modified);
+        if (it != cached_->headers.end()) {
+            conditional_headers_["If-Modified-Since"] = it->second;
+        }
+
+        if (conditional_headers_.empty()) {
+            cached_.reset();
+        } else {
+            RESTC_CPP_LOG_TRACE << "Revalidating cached reply for " << cache_key_;
+        }
+
+        return {};
+    }
+
+    // The url, with the arguments we add to it
+    std::string GetCacheKey() const {
+        std::string key = url_;
+        if (add_url_args_) {
+            bool first_arg = key.find('?') == string::npos;
+            for(const auto& arg : properties_->args) {
+                key += first_arg ? '?' : '&';
+                first_arg = false;
+                key += url_encode(arg.name) + '=' + url_encode(arg.value);
+            }
+        }
+        return key;
+    }
+
     std::string url_;
     Url parsed_url_;
     const Type request_type_;
     std::unique_ptr<RequestBody> body_;
     Connection::ptr_t connection_;
     std::unique_ptr<DataWriter> writer_;
+    std::unique_ptr<ReplyImpl> early_reply_;
     Properties::ptr_t properties_;
     RestClient &owner_;
     size_t header_size_ = 0;
     std::uint64_t bytes_sent_ = 0;
     bool dirty_ = false;
     bool add_url_args_ = true;
+    bool expect_continue_ = false;
+    ResponseCache::ptr_t response_cache_;
+    std::string cache_key_;
+    ResponseCache::entry_t cached_;
+    headers_t conditional_headers_;
 };
 
 
@@ -0,0 +1,859 @@
+
+#include <array>
+#include <list>
+#include <map>
+#include <mutex>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include "restc-cpp/restc-cpp.h"
+#include "restc-cpp/logging.h"
+#include "restc-cpp/helper.h"
+#include "restc-cpp/error.h"
+#include "restc-cpp/ResponseCache.h"
+
+using namespace std;
+
+namespace restc_cpp {
+
+namespace {
+
+const string cache_control{"Cache-Control"};
+const string content_length{"Content-Length"};
+const string etag{"ETag"};
+const string last_modified{"Last-Modified"};
+
+using directives_t = std::map<std::string, std::string>;
+
+// Get the directives from all the Cache-Control headers
+directives_t GetDirectives(const headers_t& headers) {
+    directives_t directives;
+
+    const auto range = headers.equal_range(cache_control);
+    for(auto it = range.first; it != range.second; ++it) {
+        std::vector<std::string> parts;
+        boost::split(parts, it->second, boost::is_any_of(","));
+        for(auto& part : parts) {
+            boost::trim(part);
+            if (part.empty()) {
+                continue;
+            }
+
+            std::string value;
+            const auto eq = part.find('=');
+            if (eq != std::string::npos) {
+                value = part.substr(eq + 1);
+                part.resize(eq);
+                boost::trim(part);
+                boost::trim(value);
+                boost::trim_if(value, boost::is_any_of("\""));
+            }
+            boost::to_lower(part);
+            directives[part] = value;
+        }
+    }
+
+    return directives;
+}
+
+boost::optional<int64_t> GetSeconds(const directives_t& directives,
+                                    const string& name) {
+    const auto it = directives.find(name);
+    if (it != directives.end()) {
+        try {
+            return max<int64_t>(0, stoll(it->second));
+        } catch(const std::exception&) {
+            ; // Invalid. Treat as missing
+        }
+    }
+    return {};
+}
+
+boost::optional<string> GetHeader(const headers_t& headers, const string& name) {
+    const auto it = headers.find(name);
+    if (it != headers.end()) {
+        return it->second;
+    }
+    return {};
+}
+
+/* When the reply, with these headers and received at now, becomes stale
+ *
+ * Based on RFC 9111, 4.2.1 - 4.2.3. We are a private cache,
+ * so s-maxage is ignored.
+ */
+ResponseCache::time_point_t GetExpires(
+    const headers_t& headers,
+    const directives_t& directives,
+    ResponseCache::time_point_t now) {
+
+    using namespace std::chrono;
+    using duration_t = std::chrono::system_clock::duration;
+
+    if (directives.count("no-cache")) {
+        return now;
+    }
+
+    const auto date_header = GetHeader(headers, "Date");
+    auto date = date_header
+        ? ResponseCache::ParseHttpDate(*date_header) : boost::none;
+    if (!date) {
+        date = now;
+    }
+
+    duration_t lifetime{};
+    if (const auto max_age = GetSeconds(directives, "max-age")) {
+        lifetime = seconds(*max_age);
+    } else if (const auto expires_header = GetHeader(headers, "Expires")) {
+        // An invalid date, like "0", means that it has already expired
+        if (const auto expires = ResponseCache::ParseHttpDate(*expires_header)) {
+            lifetime = max(duration_t{}, *expires - *date);
+        }
+    } else if (const auto lm_header = GetHeader(headers, last_modified)) {
+        // Heuristic freshness: 10% of the time since it was modified
+        if (const auto lm = ResponseCache::ParseHttpDate(*lm_header)) {
+            if (*lm < *date) {
+                lifetime = min<duration_t>((*date - *lm) / 10, hours(24));
+            }
+        }
+    }
+
+    duration_t age = max(duration_t{}, now - *date);
+    if (const auto age_header = GetHeader(headers, "Age")) {
+        try {
+            age = max<duration_t>(age, seconds(stoll(*age_header)));
+        } catch(const std::exception&) {
+            ;
+        }
+    }
+
+    if (lifetime <= age) {
+        return now;
+    }
+
+    return now + (lifetime - age);
+}
+
+bool IsStoredHeader(const string& name) {
+    // Hop by hop headers, and headers describing the encoded body
+    static const std::array<string, 6> ignore = {{
+        "Connection", "Keep-Alive", "Transfer-Encoding", "Content-Encoding",
+        "Content-Length", "Trailer"}};
+
+    for(const auto& h : ignore) {
+        if (ciEqLibC()(h, name)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void SetBody(ResponseCache::Entry& entry, std::string&& body) {
+    auto storage = make_shared<std::string>(move(body));
+    entry.body = *storage;
+    entry.headers[content_length] = to_string(storage->size());
+    entry.storage = move(storage);
+}
+
+class CacheEntryReader : public DataReader {
+public:
+    CacheEntryReader(ResponseCache::entry_t entry)
+    : entry_{move(entry)}
+    {}
+
+    bool IsEof() const override {
+        return offset_ >= entry_->body.size();
+    }
+
+    boost::asio::const_buffers_1 ReadSome() override {
+        const auto data = entry_->body.substr(offset_);
+        offset_ = entry_->body.size();
+        return {data.data(), data.size()};
+    }
+
+    bool CanReadInto() const noexcept override {
+        return true;
+    }
+
+    size_t ReadInto(boost::asio::mutable_buffers_1 buffer) override {
+        const auto data = entry_->body.substr(offset_);
+        const auto bytes = boost::asio::buffer_copy(
+            buffer, boost::asio::const_buffers_1{data.data(), data.size()});
+        offset_ += bytes;
+        return bytes;
+    }
+
+private:
+    const ResponseCache::entry_t entry_;
+    size_t offset_ = 0;
+};
+
+} // anonymous namespace
+
+bool ResponseCache::Entry::HasValidator() const {
+    return headers.find(etag) != headers.end()
+        || headers.find(last_modified) != headers.end();
+}
+
+size_t ResponseCache::Entry::GetSize() const noexcept {
+    size_t size = body.size() + response.reason_phrase.size();
+    for(const auto& h : headers) {
+        size += h.first.size() + h.second.size();
+    }
+    return size;
+}
+
+class ResponseCacheImpl : public ResponseCache
+    , public std::enable_shared_from_this<ResponseCacheImpl> {
+public:
+    class StoringReader : public DataReader {
+    public:
+        StoringReader(DataReader::ptr_t&& source,
+                      std::shared_ptr<ResponseCacheImpl> cache,
+                      const std::string& key,
+                      std::shared_ptr<Entry> entry)
+        : source_{move(source)}, cache_{move(cache)}, key_{key}
+        , entry_{move(entry)}
+        {
+            StoreIfDone();
+        }
+
+        bool IsEof() const override {
+            return source_->IsEof();
+        }
+
+        void SetContext(Context& ctx) override {
+            source_->SetContext(ctx);
+        }
+
+        void SetAddHeaderFn(add_header_fn_t fn) override {
+            source_->SetAddHeaderFn(move(fn));
+        }
+
+        boost::asio::const_buffers_1 ReadSome() override {
+            const auto data = source_->ReadSome();
+            if (entry_) {
+                const auto size = boost::asio::buffer_size(data);
+                if ((body_.size() + size) > cache_->max_entry_size_) {
+                    RESTC_CPP_LOG_TRACE << "ResponseCache: The body of "
+                        << key_ << " is too large to be cached";
+                    entry_.reset();
+                    body_ = {};
+                } else {
+                    body_.append(boost::asio::buffer_cast<const char *>(data),
+                                 size);
+                }
+            }
+            StoreIfDone();
+            return data;
+        }
+
+    private:
+        void StoreIfDone() {
+            if (entry_ && source_->IsEof()) {
+                SetBody(*entry_, move(body_));
+                cache_->Put(key_, move(entry_));
+                entry_.reset();
+            }
+        }
+
+        DataReader::ptr_t source_;
+        const std::shared_ptr<ResponseCacheImpl> cache_;
+        const std::string key_;
+        std::shared_ptr<Entry> entry_;
+        std::string body_;
+    };
+
+    ResponseCacheImpl(const Request::Properties& properties)
+    : max_bytes_{properties.responseCacheMaxBytes}
+    , max_entry_size_{properties.responseCacheMaxEntrySize}
+    , directory_{properties.responseCacheDirectory}
+    , max_disk_bytes_{properties.responseCacheMaxDiskBytes}
+    , max_redirects_{properties.maxCachedRedirects}
+    {
+        if (!directory_.empty()) {
+            boost::filesystem::create_directories(directory_);
+            ScanDirectory();
+        }
+    }
+
+    entry_t Get(const std::string& key) override {
+        lock_guard<mutex> lock(mutex_);
+
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            // Move it to the front of the LRU list
+            lru_.splice(lru_.begin(), lru_, it->second);
+            return it->second->second;
+        }
+
+        if (!directory_.empty()) {
+            if (auto entry = Load(key)) {
+                AddToMemory(key, entry);
+                return entry;
+            }
+        }
+
+        return {};
+    }
+
+    void Put(const std::string& key, entry_t entry) override {
+        assert(entry);
+        uint64_t save_id = 0;
+
+        {
+            lock_guard<mutex> lock(mutex_);
+
+            RemoveFromMemory(key);
+            AddToMemory(key, entry);
+
+            if (!directory_.empty()) {
+                save_id = ++last_save_id_;
+                pending_saves_[key] = save_id;
+            }
+        }
+
+        // Don't block the other requests while we write the file
+        if (save_id) {
+            Save(key, *entry, save_id);
+        }
+    }
+
+    void Remove(const std::string& key) override {
+        lock_guard<mutex> lock(mutex_);
+
+        RemoveFromMemory(key);
+
+        if (!directory_.empty()) {
+            // A Save() in progress must not bring it back
+            pending_saves_.erase(key);
+            RemoveFile(GetPath(key));
+        }
+    }
+
+    size_t GetBytesInMemory() const override {
+        lock_guard<mutex> lock(mutex_);
+        return bytes_;
+    }
+
+    size_t GetMaxEntrySize() const noexcept override {
+        return max_entry_size_;
+    }
+
+    boost::optional<Redirect>
+    GetPermanentRedirect(const std::string& url) override {
+        lock_guard<mutex> lock(mutex_);
+
+        auto it = redirects_.find(url);
+        if (it == redirects_.end()) {
+            return {};
+        }
+
+        if (it->second.expires <= chrono::system_clock::now()) {
+            redirects_.erase(it);
+            return {};
+        }
+
+        return it->second.redirect;
+    }
+
+    void AddPermanentRedirect(const std::string& url,
+                              const std::string& location,
+                              const headers_t& headers,
+                              const int statusCode) override {
+
+        // Permanent redirects can be cached without explicit
+        // freshness information (RFC 9111, 4.2.2)
+        const auto now = chrono::system_clock::now();
+        const auto directives = GetDirectives(headers);
+        if (!max_redirects_ || directives.count("no-store")
+            || directives.count("no-cache")) {
+            return;
+        }
+
+        auto expires = time_point_t::max();
+        if (directives.count("max-age") || headers.count("Expires")) {
+            expires = GetExpires(headers, directives, now);
+            if (expires <= now) {
+                return;
+            }
+        }
+
+        lock_guard<mutex> lock(mutex_);
+
+        if ((redirects_.size() >= max_redirects_) && !redirects_.count(url)) {
+            for(auto it = redirects_.begin(); it != redirects_.end();) {
+                if (it->second.expires <= now) {
+                    it = redirects_.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+
+            if (redirects_.size() >= max_redirects_) {
+                redirects_.erase(redirects_.begin());
+            }
+        }
+
+        RESTC_CPP_LOG_TRACE << "ResponseCache: Remembering redirect "
+            << url << " --> " << location << " (" << statusCode << ")";
+        redirects_[url] = {{statusCode, location}, expires};
+    }
+
+    void RemovePermanentRedirect(const std::string& url) override {
+        lock_guard<mutex> lock(mutex_);
+        redirects_.erase(url);
+    }
+
+    DataReader::ptr_t CreateStoringReader(
+        DataReader::ptr_t&& source,
+        const std::string& key,
+        std::shared_ptr<Entry> entry) override {
+
+        return make_unique<StoringReader>(move(source), shared_from_this(),
+                                          key, move(entry));
+    }
+
+private:
+    using lru_t = std::list<std::pair<std::string, entry_t>>;
+
+    using disk_lru_t = std::list<std::pair<std::string, uint64_t>>;
+
+    struct CachedRedirect {
+        Redirect redirect;
+        time_point_t expires;
+    };
+
+    void AddToMemory(const std::string& key, const entry_t& entry) {
+        const auto size = entry->GetSize();
+        if (size > max_bytes_) {
+            return;
+        }
+
+        while(!lru_.empty() && ((bytes_ + size) > max_bytes_)) {
+            RESTC_CPP_LOG_TRACE << "ResponseCache: Evicting " << lru_.back().first;
+            bytes_ -= lru_.back().second->GetSize();
+            index_.erase(lru_.back().first);
+            lru_.pop_back();
+        }
+
+        lru_.emplace_front(key, entry);
+        index_[key] = lru_.begin();
+        bytes_ += size;
+    }
+
+    void RemoveFromMemory(const std::string& key) {
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            bytes_ -= it->second->second->GetSize();
+            lru_.erase(it->second);
+            index_.erase(it);
+        }
+    }
+
+    // Find the files from earlier runs. The oldest are deleted first.
+    void ScanDirectory() {
+        std::multimap<std::time_t, std::pair<std::string, uint64_t>> files;
+        boost::system::error_code ec;
+        for(boost::filesystem::directory_iterator it{directory_, ec}, end;
+            !ec && (it != end); it.increment(ec)) {
+
+            const auto& path = it->path();
+            boost::system::error_code file_ec;
+            if ((path.extension() != ".cache")
+                || !boost::filesystem::is_regular_file(path, file_ec)) {
+                continue;
+            }
+
+            const auto size = boost::filesystem::file_size(path, file_ec);
+            if (file_ec) {
+                continue;
+            }
+            const auto time = boost::filesystem::last_write_time(path, file_ec);
+            if (!file_ec) {
+                files.emplace(time, make_pair(path.string(), size));
+            }
+        }
+
+        for(auto& file : files) {
+            AddFile(file.second.first, file.second.second);
+        }
+        EvictFiles();
+    }
+
+    // Add or move the file to the front of the disk LRU list
+    void AddFile(const std::string& path, const uint64_t size) {
+        auto it = disk_index_.find(path);
+        if (it != disk_index_.end()) {
+            disk_bytes_ -= it->second->second;
+            disk_lru_.erase(it->second);
+        }
+
+        disk_lru_.emplace_front(path, size);
+        disk_index_[path] = disk_lru_.begin();
+        disk_bytes_ += size;
+    }
+
+    void RemoveFile(const boost::filesystem::path& path) {
+        auto it = disk_index_.find(path.string());
+        if (it != disk_index_.end()) {
+            disk_bytes_ -= it->second->second;
+            disk_lru_.erase(it->second);
+            disk_index_.erase(it);
+        }
+
+        boost::system::error_code ec;
+        boost::filesystem::remove(path, ec);
+    }
+
+    void EvictFiles() {
+        while(!disk_lru_.empty() && (disk_bytes_ > max_disk_bytes_)) {
+            const boost::filesystem::path path = disk_lru_.back().first;
+            RESTC_CPP_LOG_TRACE << "ResponseCache: Deleting " << path;
+            RemoveFile(path);
+        }
+    }
+
+    boost::filesystem::path GetPath(const std::string& key) const {
+        std::ostringstream name;
+        name << std::hex << std::hash<std::string>()(key) << ".cache";
+        return directory_ / name.str();
+    }
+
+    /* The file format is:
+     *
+     *  restc-cpp-cache 1
+     *  key
+     *  expires (seconds since epoch)
+     *  status-code reason-phrase
+     *  name: value
+     *  ...
+     *  (empty line)
+     *  body
+     */
+    /* Write the file without holding the mutex.
+     *
+     * Each save uses its own temporary file. It only replaces the
+     * cache file if no later Put() or Remove() was made for the key.
+     */
+    void Save(const std::string& key, const Entry& entry, const uint64_t saveId) {
+        const auto path = GetPath(key);
+        auto tmp_path = path;
+        tmp_path += "." + to_string(saveId) + ".tmp";
+
+        try {
+            {
+                std::ofstream file;
+                file.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+                file.open(tmp_path.string(), ios::out | ios::binary | ios::trunc);
+                file << file_magic_ << '\n'
+                    << key << '\n'
+                    << chrono::duration_cast<chrono::seconds>(
+                        entry.expires.time_since_epoch()).count() << '\n'
+                    << entry.response.status_code << ' '
+                    << entry.response.reason_phrase << '\n';
+                for(const auto& h : entry.headers) {
+                    file << h.first << ": " << h.second << '\n';
+                }
+                file << '\n';
+                file.write(entry.body.data(), entry.body.size());
+            }
+
+            lock_guard<mutex> lock(mutex_);
+            const auto it = pending_saves_.find(key);
+            if ((it == pending_saves_.end()) || (it->second != saveId)) {
+                RESTC_CPP_LOG_TRACE << "ResponseCache: Discarding outdated "
+                    << "save of " << key;
+                boost::system::error_code ec;
+                boost::filesystem::remove(tmp_path, ec);
+                return;
+            }
+            pending_saves_.erase(it);
+            boost::filesystem::rename(tmp_path, path);
+            boost::system::error_code ec;
+            const auto size = boost::filesystem::file_size(path, ec);
+            if (!ec) {
+                AddFile(path.string(), size);
+                EvictFiles();
+            }
+        } catch(const std::exception& ex) {
+            RESTC_CPP_LOG_WARN << "ResponseCache: Failed to save "
+                << path << ": " << ex.what();
+            boost::system::error_code ec;
+            boost::filesystem::remove(tmp_path, ec);
+
+            lock_guard<mutex> lock(mutex_);
+            const auto it = pending_saves_.find(key);
+            if ((it != pending_saves_.end()) && (it->second == saveId)) {
+                pending_saves_.erase(it);
+            }
+        }
+    }
+
+    struct MappedFile {
+        MappedFile(const boost::filesystem::path& path)
+        : mapping{path.string().c_str(), boost::interprocess::read_only}
+        , region{mapping, boost::interprocess::read_only}
+        {}
+
+        boost::interprocess::file_mapping mapping;
+        boost::interprocess::mapped_region region;
+    };
+
+    entry_t Load(const std::string& key) {
+        const auto path = GetPath(key);
+        boost::system::error_code ec;
+        uint64_t file_size = 0;
+        if (!boost::filesystem::is_regular_file(path, ec)
+            || !(file_size = boost::filesystem::file_size(path, ec))) {
+            return {};
+        }
+
+        try {
+            auto file = make_shared<MappedFile>(path);
+            boost::string_ref data{
+                static_cast<const char *>(file->region.get_address()),
+                file->region.get_size()};
+
+            auto next_line = [&data]() -> boost::string_ref {
+                const auto eol = data.find('\n');
+                if (eol == boost::string_ref::npos) {
+                    throw ParseException("Truncated cache file");
+                }
+                const auto line = data.substr(0, eol);
+                data.remove_prefix(eol + 1);
+                return line;
+            };
+
+            if ((next_line() != file_magic_) || (next_line() != key)) {
+                return {};
+            }
+
+            auto entry = make_shared<Entry>();
+            entry->expires = time_point_t{} + chrono::seconds(
+                stoll(next_line().to_string()));
+
+            const auto status = next_line().to_string();
+            const auto space = status.find(' ');
+            entry->response.status_code = stoi(status.substr(0, space));
+            if (space != std::string::npos) {
+                entry->response.reason_phrase = status.substr(space + 1);
+            }
+
+            for(auto line = next_line(); !line.empty(); line = next_line()) {
+                const auto colon = line.find(": ");
+                if (colon == boost::string_ref::npos) {
+                    throw ParseException("Invalid header in cache file");
+                }
+                entry->headers.insert({line.substr(0, colon).to_string(),
+                                       line.substr(colon + 2).to_string()});
+            }
+
+            entry->body = data;
+            entry->storage = move(file);
+            AddFile(path.string(), file_size);
+
+            RESTC_CPP_LOG_TRACE << "ResponseCache: Loaded " << key
+                << " from " << path;
+            return entry;
+        } catch(const std::exception& ex) {
+            RESTC_CPP_LOG_WARN << "ResponseCache: Failed to load "
+                << path << ": " << ex.what();
+        }
+
+        RemoveFile(path);
+        return {};
+    }
+
+    static constexpr const char *file_magic_ = "restc-cpp-cache 1";
+    const size_t max_bytes_;
+    const size_t max_entry_size_;
+    const boost::filesystem::path directory_;
+    const uint64_t max_disk_bytes_;
+    const size_t max_redirects_;
+    size_t bytes_ = 0;
+    lru_t lru_;
+    std::unordered_map<std::string, lru_t::iterator> index_;
+    // The files in directory_, most recently used first
+    uint64_t disk_bytes_ = 0;
+    disk_lru_t disk_lru_;
+    std::unordered_map<std::string, disk_lru_t::iterator> disk_index_;
+    std::unordered_map<std::string, CachedRedirect> redirects_;
+    // The latest Put() for the keys that are being saved to files
+    std::unordered_map<std::string, uint64_t> pending_saves_;
+    uint64_t last_save_id_ = 0;
+    mutable std::mutex mutex_;
+};
+
+constexpr const char *ResponseCacheImpl::file_magic_;
+
+std::shared_ptr<ResponseCache::Entry>
+ResponseCache::CreateEntry(const Reply::HttpResponse& response,
+                           const headers_t& headers,
+                           time_point_t now) {
+
+    if (response.status_code != 200) {
+        return {};
+    }
+
+    const auto directives = GetDirectives(headers);
+    if (directives.count("no-store")) {
+        return {};
+    }
+
+    // We store the decoded body, so Accept-Encoding is the only
+    // request header the reply may vary on.
+    const auto vary = headers.equal_range("Vary");
+    for(auto it = vary.first; it != vary.second; ++it) {
+        std::vector<std::string> names;
+        boost::split(names, it->second, boost::is_any_of(", "),
+                     boost::token_compress_on);
+        for(const auto& name : names) {
+            if (!name.empty() && !ciEqLibC()(name, "Accept-Encoding")) {
+                return {};
+            }
+        }
+    }
+
+    auto entry = make_shared<Entry>();
+    entry->response = response;
+    for(const auto& h : headers) {
+        if (IsStoredHeader(h.first)) {
+            entry->headers.insert(h);
+        }
+    }
+    entry->expires = GetExpires(headers, directives, now);
+
+    if (!entry->IsFresh(now) && !entry->HasValidator()) {
+        return {};
+    }
+
+    return entry;
+}
+
+ResponseCache::entry_t
+ResponseCache::Revalidate(const Entry& entry, const headers_t& headers,
+                          time_point_t now) {
+
+    auto updated = make_shared<Entry>(entry);
+
+    // Update the stored headers with the ones in the 304 reply
+    // (RFC 9111, 3.2)
+    for(const auto& h : headers) {
+        if (IsStoredHeader(h.first)) {
+            updated->headers.erase(h.first);
+        }
+    }
+    for(const auto& h : headers) {
+        if (IsStoredHeader(h.first)) {
+            updated->headers.insert(h);
+        }
+    }
+
+    updated->expires = GetExpires(updated->headers,
+                                  GetDirectives(updated->headers), now);
+    return updated;
+}
+
+bool ResponseCache::IsRequestCacheable(const headers_t& headers) {
+    // Replies to authorized requests may be specific to the user
+    if (headers.find("Authorization") != headers.end()) {
+        return false;
+    }
+
+    return GetDirectives(headers).count("no-store") == 0;
+}
+
+bool ResponseCache::MustRevalidate(const headers_t& headers) {
+    const auto directives = GetDirectives(headers);
+    if (directives.count("no-cache")) {
+        return true;
+    }
+    const auto max_age = GetSeconds(directives, "max-age");
+    return max_age && (*max_age == 0);
+}
+
+DataReader::ptr_t ResponseCache::CreateReader(entry_t entry) {
+    return make_unique<CacheEntryReader>(move(entry));
+}
+
+boost::optional<ResponseCache::time_point_t>
+ResponseCache::ParseHttpDate(const std::string& date) {
+    // Accepts the IMF-fixdate, RFC 850 and asctime formats:
+    //  Sun, 06 Nov 1994 08:49:37 GMT
+    //  Sunday, 06-Nov-94 08:49:37 GMT
+    //  Sun Nov  6 08:49:37 1994
+    static const std::array<const char *, 12> months = {{
+        "jan", "feb", "mar", "apr", "may", "jun",
+        "jul", "aug", "sep", "oct", "nov", "dec"}};
+
+    std::vector<std::string> tokens;
+    boost::split(tokens, date, boost::is_any_of(" ,-:"),
+                 boost::token_compress_on);
+    tokens.erase(std::remove(tokens.begin(), tokens.end(), ""), tokens.end());
+    if (tokens.size() < 7) {
+        return {};
+    }
+
+    auto get_month = [](const std::string& name) -> int {
+        for(size_t i = 0; i < months.size(); ++i) {
+            if (ciEqLibC()(name, months[i])) {
+                return static_cast<int>(i) + 1;
+            }
+        }
+        return 0;
+    };
+
+    int year = 0, month = 0, day = 0, hour = 0, minute = 0, second = 0;
+    try {
+        if ((month = get_month(tokens[1])) != 0) {
+            // asctime
+            day = stoi(tokens[2]);
+            hour = stoi(tokens[3]);
+            minute = stoi(tokens[4]);
+            second = stoi(tokens[5]);
+            year = stoi(tokens[6]);
+        } else {
+            day = stoi(tokens[1]);
+            month = get_month(tokens[2]);
+            year = stoi(tokens[3]);
+            hour = stoi(tokens[4]);
+            minute = stoi(tokens[5]);
+            second = stoi(tokens[6]);
+            if (tokens[3].size() == 2) {
+                // RFC 850 two digit year (RFC 9110, 5.6.7)
+                year += (year < 70) ? 2000 : 1900;
+            }
+        }
+    } catch(const std::exception&) {
+        return {};
+    }
+
+    if (!month || (day < 1) || (day > 31) || (hour > 23) || (minute > 59)
+        || (second > 60) || (year < 1970)) {
+        return {};
+    }
+
+    // Days since the epoch (Howard Hinnant's days_from_civil)
+    const int y = year - (month <= 2);
+    const int era = y / 400;
+    const int yoe = y - era * 400;
+    const int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    const int64_t days = static_cast<int64_t>(era) * 146097 + doe - 719468;
+
+    return time_point_t{} + std::chrono::seconds(
+        days * 86400 + hour * 3600 + minute * 60 + second);
+}
+
+ResponseCache::ptr_t ResponseCache::Create(const Request::Properties& properties) {
+    return make_shared<ResponseCacheImpl>(properties);
+}
+
+} // restc_cpp
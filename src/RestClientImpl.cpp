@@ -7,6 +7,8 @@
 #include "restc-cpp/restc-cpp.h"
 #include "restc-cpp/logging.h"
 #include "restc-cpp/ConnectionPool.h"
+#include "restc-cpp/IoBufferPool.h"
+#include "restc-cpp/ResponseCache.h"
 #include "restc-cpp/RequestBody.h"
 
 #ifdef RESTC_CPP_WITH_TLS
@@ -166,6 +168,8 @@ public:
         }
 
         pool_ = ConnectionPool::Create(*this);
+        io_buffer_pool_ = IoBufferPool::Create(*default_connection_properties_);
+        response_cache_ = ResponseCache::Create(*default_connection_properties_);
 
         if (useMainThread) {
             return;
@@ -284,6 +288,16 @@ public:
         return pool_;
     }
 
+    std::shared_ptr<IoBufferPool> GetIoBufferPool() override {
+        assert(io_buffer_pool_);
+        return io_buffer_pool_;
+    }
+
+    std::shared_ptr<ResponseCache> GetResponseCache() override {
+        assert(response_cache_);
+        return response_cache_;
+    }
+
     boost::asio::io_service& GetIoService() override { return *io_service_; }
 
 #ifdef RESTC_CPP_WITH_TLS
@@ -311,6 +325,8 @@ private:
     Request::Properties::ptr_t default_connection_properties_ = make_shared<Request::Properties>();
     boost::asio::io_service *io_service_ = nullptr;
     ConnectionPool::ptr_t pool_;
+    IoBufferPool::ptr_t io_buffer_pool_;
+    ResponseCache::ptr_t response_cache_;
     unique_ptr<boost::asio::io_service::work> work_;
     size_t current_tasks_ = 0;
     bool closed_ = false;
@@ -0,0 +1,213 @@
+
+#include <mutex>
+
+#include "restc-cpp/restc-cpp.h"
+#include "restc-cpp/logging.h"
+#include "restc-cpp/error.h"
+#include "restc-cpp/RequestBody.h"
+#include "restc-cpp/SegmentedDownload.h"
+
+using namespace std;
+
+namespace restc_cpp {
+
+namespace {
+
+class SegmentedDownloadImpl
+    : public std::enable_shared_from_this<SegmentedDownloadImpl> {
+public:
+    SegmentedDownloadImpl(RestClient& client, string url,
+                          boost::filesystem::path path,
+                          SegmentedDownload::Config config)
+    : client_{client}, url_{move(url)}, path_{move(path)}
+    , config_{move(config)}
+    {
+    }
+
+    future<uint64_t> Start() {
+        auto rval = promise_.get_future();
+        auto self = shared_from_this();
+        client_.Process([self](Context& ctx) {
+            try {
+                self->Prepare(ctx);
+            } catch(...) {
+                self->Fail(current_exception());
+            }
+        });
+        return rval;
+    }
+
+private:
+    void Prepare(Context& ctx) {
+        static const string content_length_name{"Content-Length"};
+        static const string accept_ranges_name{"Accept-Ranges"};
+        static const string bytes_name{"bytes"};
+
+        uint64_t size = 0;
+        bool accept_ranges = false;
+        {
+            auto reply = Request::Create(url_, Request::Type::HEAD, client_,
+                                         {}, {}, config_.headers)->Execute(ctx);
+            if (const auto cl = reply->GetHeader(content_length_name)) {
+                size = stoull(*cl);
+            }
+            const auto ar = reply->GetHeader(accept_ranges_name);
+            accept_ranges = ar && ciEqLibC()(*ar, bytes_name);
+        }
+
+        const auto min_size = max<uint64_t>(config_.minSegmentSize, 1);
+        const auto num_segments = static_cast<size_t>(min<uint64_t>(
+            max<size_t>(config_.maxSegments, 1), size / min_size));
+
+        if (!accept_ranges || (num_segments < 2)) {
+            RESTC_CPP_LOG_DEBUG << "SegmentedDownload: Fetching " << url_
+                << " with a single request.";
+
+            auto reply = Request::Create(url_, Request::Type::GET, client_,
+                                         {}, {}, config_.headers)->Execute(ctx);
+            Done(reply->SaveToFile(path_));
+            return;
+        }
+
+        // Create the file in its full size, so that the segments
+        // can be written in any order.
+        {
+            ofstream file{path_.string(), ios::binary | ios::trunc};
+            if (!file) {
+                throw IoException(string{"Failed to create file: "}
+                    + path_.string());
+            }
+        }
+        boost::filesystem::resize_file(path_, size);
+
+        size_ = size;
+        pending_segments_ = num_segments;
+
+        RESTC_CPP_LOG_DEBUG << "SegmentedDownload: Fetching " << size
+            << " bytes from " << url_ << " in " << num_segments
+            << " segments.";
+
+        const auto segment_size = size / num_segments;
+        auto self = shared_from_this();
+        for(size_t i = 0; i < num_segments; ++i) {
+            const uint64_t first = i * segment_size;
+            const uint64_t last = (i + 1 == num_segments)
+                ? size - 1 : first + segment_size - 1;
+
+            client_.Process([self, first, last](Context& segment_ctx) {
+                self->FetchSegment(segment_ctx, first, last);
+            });
+        }
+    }
+
+    void FetchSegment(Context& ctx, const uint64_t first, const uint64_t last) {
+        auto delay = config_.retryDelayMs;
+        for(int attempt = 0;; ++attempt) {
+            if (IsDone()) {
+                return;
+            }
+
+            try {
+                FetchSegmentOnce(ctx, first, last);
+                SegmentDone();
+                return;
+            } catch(const std::exception& ex) {
+                if (attempt >= config_.maxRetries) {
+                    Fail(current_exception());
+                    return;
+                }
+
+                RESTC_CPP_LOG_WARN << "SegmentedDownload: Segment "
+                    << first << '-' << last << " of " << url_
+                    << " failed: " << ex.what() << ". Retrying.";
+            }
+
+            // Don't yield while we are in the exception handler
+            ctx.Sleep(chrono::milliseconds(delay));
+            delay *= 2;
+        }
+    }
+
+    void FetchSegmentOnce(Context& ctx, const uint64_t first,
+                          const uint64_t last) {
+        auto headers = config_.headers;
+        headers["Range"] = "bytes="s + to_string(first) + '-' + to_string(last);
+
+        auto reply = Request::Create(url_, Request::Type::GET, client_,
+                                     {}, {}, headers)->Execute(ctx);
+
+        // 200 means that the server ignored the range
+        if (reply->GetResponseCode() != 206) {
+            throw ProtocolException("SegmentedDownload: Expected 206 Partial Content, got "
+                + to_string(reply->GetResponseCode()));
+        }
+
+        const auto bytes = reply->WriteToFileAt(path_, first);
+        if (bytes != (last - first + 1)) {
+            throw ProtocolException("SegmentedDownload: Got "
+                + to_string(bytes) + " bytes for segment "
+                + to_string(first) + '-' + to_string(last));
+        }
+    }
+
+    bool IsDone() const {
+        lock_guard<mutex> lock(mutex_);
+        return done_;
+    }
+
+    void SegmentDone() {
+        bool all_done = false;
+        {
+            lock_guard<mutex> lock(mutex_);
+            all_done = (--pending_segments_ == 0);
+        }
+
+        if (all_done) {
+            Done(size_);
+        }
+    }
+
+    void Done(uint64_t bytes) {
+        lock_guard<mutex> lock(mutex_);
+        if (!done_) {
+            done_ = true;
+            RESTC_CPP_LOG_DEBUG << "SegmentedDownload: Done with " << url_;
+            promise_.set_value(bytes);
+        }
+    }
+
+    void Fail(exception_ptr ex) {
+        lock_guard<mutex> lock(mutex_);
+        if (!done_) {
+            done_ = true;
+            promise_.set_exception(ex);
+        }
+    }
+
+    RestClient& client_;
+    const string url_;
+    const boost::filesystem::path path_;
+    const SegmentedDownload::Config config_;
+    promise<uint64_t> promise_;
+    uint64_t size_ = 0;
+    size_t pending_segments_ = 0;
+    bool done_ = false;
+    mutable mutex mutex_;
+};
+
+} // anonymous namespace
+
+future<uint64_t>
+SegmentedDownload::Download(RestClient& client, string url,
+                            boost::filesystem::path path, Config config) {
+    return make_shared<SegmentedDownloadImpl>(client, move(url), move(path),
+                                              move(config))->Start();
+}
+
+future<uint64_t>
+SegmentedDownload::Download(RestClient& client, string url,
+                            boost::filesystem::path path) {
+    return Download(client, move(url), move(path), Config{});
+}
+
+} // restc_cpp
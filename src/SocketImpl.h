@@ -6,6 +6,11 @@
 
 #include <boost/utility/string_ref.hpp>
 
+#ifdef __linux__
+#   include <fcntl.h>
+#   include <unistd.h>
+#endif
+
 #include "restc-cpp/restc-cpp.h"
 #include "restc-cpp/Socket.h"
 #include "restc-cpp/logging.h"
@@ -35,6 +40,12 @@ public:
         });
     }
 
+    void AsyncWaitForData(boost::asio::yield_context& yield) override {
+        return WrapException<void>([&] {
+            socket_.async_read_some(boost::asio::null_buffers(), yield);
+        });
+    }
+
     std::size_t AsyncRead(boost::asio::mutable_buffers_1 buffers,
                         boost::asio::yield_context& yield) override {
         return WrapException<std::size_t>([&] {
@@ -42,6 +53,60 @@ public:
         });
     }
 
+#ifdef __linux__
+    ~SocketImpl() {
+        ClosePipe();
+    }
+
+    bool CanSplice() const noexcept override {
+        return true;
+    }
+
+    /* Use splice(2) to move the data from the socket to a pipe,
+     * and from the pipe to the file. The data never leaves the kernel.
+     */
+    std::size_t AsyncSpliceTo(int fd, std::size_t maxBytes,
+                              boost::asio::yield_context& yield) override {
+        return WrapException<std::size_t>([&] {
+            if (pipe_[0] < 0) {
+                OpenPipe();
+            }
+
+            ssize_t moved = 0;
+            while(true) {
+                moved = splice(socket_.native_handle(), nullptr,
+                               pipe_[1], nullptr, maxBytes,
+                               SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+                if (moved >= 0) {
+                    break;
+                }
+                if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+                    socket_.async_read_some(boost::asio::null_buffers(), yield);
+                } else if (errno != EINTR) {
+                    ThrowErrno(errno, "splice from socket");
+                }
+            }
+
+            for(auto left = moved; left > 0;) {
+                const auto written = splice(pipe_[0], nullptr, fd, nullptr,
+                                            left, SPLICE_F_MOVE);
+                if (written < 0) {
+                    const auto err = errno;
+                    if (err == EINTR) {
+                        continue;
+                    }
+                    // Don't leave stale data in the pipe
+                    ClosePipe();
+                    ThrowErrno(err, "splice to file");
+                }
+                left -= written;
+            }
+
+            return static_cast<std::size_t>(moved);
+        });
+    }
+#endif
+
     void AsyncWrite(const boost::asio::const_buffers_1& buffers,
                     boost::asio::yield_context& yield) override {
         boost::asio::async_write(socket_, buffers, yield);
@@ -99,6 +164,36 @@ protected:
     }
 
 private:
+#ifdef __linux__
+    void OpenPipe() {
+        if (pipe2(pipe_, O_NONBLOCK | O_CLOEXEC) != 0) {
+            ThrowErrno(errno, "pipe2");
+        }
+
+        // A larger pipe allows us to move more data in each splice
+        fcntl(pipe_[1], F_SETPIPE_SZ, 1024 * 1024);
+
+        // We use non-blocking io on the socket itself when splicing
+        socket_.native_non_blocking(true);
+    }
+
+    void ClosePipe() noexcept {
+        for(auto& p : pipe_) {
+            if (p >= 0) {
+                ::close(p);
+                p = -1;
+            }
+        }
+    }
+
+    [[noreturn]] static void ThrowErrno(int err, const char *what) {
+        throw boost::system::system_error(err,
+            boost::system::system_category(), what);
+    }
+
+    int pipe_[2] = {-1, -1};
+#endif
+
     boost::asio::ip::tcp::socket socket_;
 };
 
@@ -45,6 +45,11 @@ public:
         });
     }
 
+    void AsyncWaitForData(boost::asio::yield_context& /*yield*/) override {
+        // The TLS layer may already have buffered the data we want,
+        // so the readiness of the socket tells us nothing.
+    }
+
     std::size_t AsyncRead(boost::asio::mutable_buffers_1 buffers,
                           boost::asio::yield_context& yield) override {
         return WrapException<std::size_t>([&] {
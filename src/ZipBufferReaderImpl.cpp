@@ -0,0 +1,186 @@
+#include <libdeflate.h>
+
+#include "restc-cpp/restc-cpp.h"
+#include "restc-cpp/DataReader.h"
+#include "restc-cpp/logging.h"
+
+using namespace std;
+
+namespace restc_cpp {
+
+namespace {
+
+/*! Returns the compressed body we have read to the streaming reader */
+class BufferedBodyReader : public DataReader {
+public:
+    BufferedBodyReader(vector<char>&& body)
+    : body_{move(body)} {}
+
+    bool IsEof() const override {
+        return done_;
+    }
+
+    boost::asio::const_buffers_1 ReadSome() override {
+        if (done_) {
+            return {nullptr, 0};
+        }
+
+        done_ = true;
+        return {body_.data(), body_.size()};
+    }
+
+private:
+    const vector<char> body_;
+    bool done_ = false;
+};
+
+} // anonymous namespace
+
+/*! Decompress a small gzip or deflate body with libdeflate
+ *
+ * libdeflate can't decompress a stream, but it is much faster than
+ * zlib when it gets the whole body at once. We use it when we know
+ * from Content-Length that the compressed body is small.
+ *
+ * If the decompressed body is larger than RESTC_CPP_SANE_DATA_LIMIT,
+ * we hand the compressed body to the streaming zlib reader instead.
+ */
+class ZipBufferReaderImpl : public DataReader {
+public:
+    enum class Format { DEFLATE, GZIP };
+
+    ZipBufferReaderImpl(std::unique_ptr<DataReader>&& source,
+                        const size_t contentLength,
+                        const Format format)
+    : source_{move(source)}, content_length_{contentLength}
+    , format_{format}, decompressor_{libdeflate_alloc_decompressor()}
+    {
+        if (!decompressor_) {
+            throw DecompressException("Failed to initialize decompression");
+        }
+    }
+
+    ~ZipBufferReaderImpl() {
+        libdeflate_free_decompressor(decompressor_);
+    }
+
+    bool IsEof() const override {
+        return streaming_ ? streaming_->IsEof() : done_;
+    }
+
+    void SetContext(Context& ctx) override {
+        source_->SetContext(ctx);
+    }
+
+    void SetAddHeaderFn(add_header_fn_t fn) override {
+        source_->SetAddHeaderFn(move(fn));
+    }
+
+    boost::asio::const_buffers_1 ReadSome() override {
+        if (streaming_) {
+            return streaming_->ReadSome();
+        }
+
+        if (done_) {
+            return {nullptr, 0};
+        }
+
+        vector<char> input;
+        input.reserve(content_length_);
+        while(!source_->IsEof()) {
+            const auto buffers = source_->ReadSome();
+            const auto data = boost::asio::buffer_cast<const char *>(buffers);
+            input.insert(input.end(), data,
+                         data + boost::asio::buffer_size(buffers));
+        }
+
+        if (!Decompress(input)) {
+            RESTC_CPP_LOG_TRACE << "ZipBufferReaderImpl: The body is too "
+                << "large to decompress in one buffer. Using zlib.";
+            output_ = {};
+            auto body = make_unique<BufferedBodyReader>(move(input));
+            streaming_ = (format_ == Format::GZIP)
+                ? DataReader::CreateGzipReader(move(body))
+                : DataReader::CreateZipReader(move(body));
+            return streaming_->ReadSome();
+        }
+        done_ = true;
+
+        RESTC_CPP_LOG_TRACE << "ZipBufferReaderImpl: Decompressed "
+            << input.size() << " bytes to " << output_.size() << " bytes.";
+
+        return {output_.data(), output_.size()};
+    }
+
+private:
+    /* Decompress input into output_
+     *
+     * Returns false if the output would exceed RESTC_CPP_SANE_DATA_LIMIT.
+     */
+    bool Decompress(const vector<char>& input) {
+        size_t out_size = max<size_t>(input.size() * 4, 1024);
+
+        // The gzip trailer has the size of the uncompressed data (mod 2^32)
+        if ((format_ == Format::GZIP) && (input.size() >= 18)) {
+            const auto *isize = reinterpret_cast<const uint8_t *>(
+                input.data() + input.size() - 4);
+            out_size = isize[0] | (isize[1] << 8) | (isize[2] << 16)
+                | (static_cast<size_t>(isize[3]) << 24);
+        }
+
+        while(true) {
+            if (out_size > RESTC_CPP_SANE_DATA_LIMIT) {
+                return false;
+            }
+
+            output_.resize(out_size);
+            size_t actual_size = 0;
+            const auto result = (format_ == Format::GZIP)
+                ? libdeflate_gzip_decompress(decompressor_,
+                    input.data(), input.size(),
+                    output_.data(), output_.size(), &actual_size)
+                : libdeflate_zlib_decompress(decompressor_,
+                    input.data(), input.size(),
+                    output_.data(), output_.size(), &actual_size);
+
+            switch(result) {
+                case LIBDEFLATE_SUCCESS:
+                    output_.resize(actual_size);
+                    return true;
+                case LIBDEFLATE_INSUFFICIENT_SPACE:
+                    out_size = max<size_t>(out_size * 2, 1024);
+                    break;
+                default:
+                    throw DecompressException(
+                        string("Decompression failed with libdeflate error ")
+                        + to_string(result));
+            }
+        }
+    }
+
+    unique_ptr<DataReader> source_;
+    const size_t content_length_;
+    const Format format_;
+    libdeflate_decompressor *decompressor_ = nullptr;
+    vector<char> output_;
+    DataReader::ptr_t streaming_;
+    bool done_ = false;
+};
+
+
+std::unique_ptr<DataReader>
+DataReader::CreateZipBufferReader(std::unique_ptr<DataReader>&& source,
+                                  size_t contentLength) {
+    return make_unique<ZipBufferReaderImpl>(move(source), contentLength,
+                                            ZipBufferReaderImpl::Format::DEFLATE);
+}
+
+std::unique_ptr<DataReader>
+DataReader::CreateGzipBufferReader(std::unique_ptr<DataReader>&& source,
+                                   size_t contentLength) {
+    return make_unique<ZipBufferReaderImpl>(move(source), contentLength,
+                                            ZipBufferReaderImpl::Format::GZIP);
+}
+
+} // namepsace
+
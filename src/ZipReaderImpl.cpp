@@ -1,8 +1,17 @@
-#include <zlib.h>
-
 #include "restc-cpp/restc-cpp.h"
 #include "restc-cpp/DataReader.h"
 
+// zlib-ng has the same API as zlib, with a zng_ prefix
+#ifdef RESTC_CPP_WITH_ZLIB_NG
+#   include <zlib-ng.h>
+#   define RESTC_CPP_ZLIB_FN(name) zng_ ## name
+    using z_stream_t = zng_stream;
+#else
+#   include <zlib.h>
+#   define RESTC_CPP_ZLIB_FN(name) name
+    using z_stream_t = z_stream;
+#endif
+
 using namespace std;
 
 namespace restc_cpp {
@@ -17,19 +26,27 @@ public:
     {
         const auto wsize = (format == Format::GZIP) ? (MAX_WBITS | 16) : MAX_WBITS;
 
-        if (inflateInit2(&strm_, wsize) != Z_OK) {
+        if (RESTC_CPP_ZLIB_FN(inflateInit2)(&strm_, wsize) != Z_OK) {
             throw DecompressException("Failed to initialize decompression");
         }
     }
 
     ~ZipReaderImpl() {
-        inflateEnd(&strm_);
+        RESTC_CPP_ZLIB_FN(inflateEnd)(&strm_);
     }
 
     bool IsEof() const override {
         return done_;
     }
 
+    void SetContext(Context& ctx) override {
+        source_->SetContext(ctx);
+    }
+
+    void SetAddHeaderFn(add_header_fn_t fn) override {
+        source_->SetAddHeaderFn(move(fn));
+    }
+
     bool HaveMoreBufferedInput() const noexcept {
         return strm_.avail_in > 0;
     }
@@ -73,8 +90,8 @@ private:
                     boost::string_ref& dst) {
 
         if (!HaveMoreBufferedInput()) {
-            strm_.next_in = const_cast<Bytef *>(
-                reinterpret_cast<const Bytef *>(src.data()));
+            strm_.next_in = reinterpret_cast<decltype(strm_.next_in)>(
+                const_cast<char *>(src.data()));
             strm_.avail_in
                 = static_cast<decltype(strm_.avail_in)>(src.size());
         }
@@ -83,12 +100,12 @@ private:
 
         strm_.avail_out
             = static_cast<decltype(strm_.avail_out)>(dst.size());
-        strm_.next_out = const_cast<Bytef *>(
-            reinterpret_cast<const Bytef *>(dst.data()));
+        strm_.next_out = reinterpret_cast<decltype(strm_.next_out)>(
+            const_cast<char *>(dst.data()));
 
         assert(strm_.avail_out > 0);
 
-        const auto result = inflate(&strm_, Z_SYNC_FLUSH);
+        const auto result = RESTC_CPP_ZLIB_FN(inflate)(&strm_, Z_SYNC_FLUSH);
         switch (result) {
             case Z_OK:
                 break;
@@ -122,8 +139,8 @@ private:
     }
 
     unique_ptr<DataReader> source_;
-    array<char, 1024*8> out_buffer_;
-    z_stream strm_ = {};
+    array<char, RESTC_CPP_IO_BUFFER_SIZE> out_buffer_;
+    z_stream_t strm_ = {};
     bool done_ = false;
 };
 
@@ -0,0 +1,103 @@
+#include <zstd.h>
+
+#include "restc-cpp/restc-cpp.h"
+#include "restc-cpp/DataReader.h"
+
+using namespace std;
+
+namespace restc_cpp {
+
+/*! Decompress a "zstd" encoded body
+ *
+ * The body may contain several zstd frames. We are done when the
+ * last frame is complete and the source has no more data.
+ */
+class ZstdReaderImpl : public DataReader {
+public:
+    ZstdReaderImpl(std::unique_ptr<DataReader>&& source)
+    : source_{move(source)}
+    , stream_{ZSTD_createDStream()}
+    {
+        if (!stream_ || ZSTD_isError(ZSTD_initDStream(stream_))) {
+            ZSTD_freeDStream(stream_);
+            throw DecompressException("Failed to initialize zstd decompression");
+        }
+    }
+
+    ~ZstdReaderImpl() {
+        ZSTD_freeDStream(stream_);
+    }
+
+    bool IsEof() const override {
+        return done_;
+    }
+
+    void SetContext(Context& ctx) override {
+        source_->SetContext(ctx);
+    }
+
+    void SetAddHeaderFn(add_header_fn_t fn) override {
+        source_->SetAddHeaderFn(move(fn));
+    }
+
+    boost::asio::const_buffers_1 ReadSome() override {
+        ZSTD_outBuffer out = {out_buffer_.data(), out_buffer_.size(), 0};
+
+        while(!done_ && (out.pos < out.size)) {
+            if ((in_.pos == in_.size) && !output_pending_) {
+                if (frame_complete_ && source_->IsEof()) {
+                    done_ = true;
+                    break;
+                }
+
+                if (out.pos > 0) {
+                    break; // Return what we have before we do IO
+                }
+
+                const auto buffers = source_->ReadSome();
+                in_.src = boost::asio::buffer_cast<const char *>(buffers);
+                in_.size = boost::asio::buffer_size(buffers);
+                in_.pos = 0;
+
+                if (in_.size == 0) {
+                    if (frame_complete_ && source_->IsEof()) {
+                        done_ = true;
+                        break;
+                    }
+                    throw DecompressException("Decompression failed - premature end of stream.");
+                }
+            }
+
+            const auto result = ZSTD_decompressStream(stream_, &out, &in_);
+            if (ZSTD_isError(result)) {
+                throw DecompressException(string("Decompression failed: ")
+                    + ZSTD_getErrorName(result));
+            }
+
+            frame_complete_ = (result == 0);
+
+            // If the output buffer is full, zstd may hold more data
+            output_pending_ = (out.pos == out.size);
+        }
+
+        return {out_buffer_.data(), out.pos};
+    }
+
+private:
+    unique_ptr<DataReader> source_;
+    ZSTD_DStream *stream_ = nullptr;
+    ZSTD_inBuffer in_ = {};
+    array<char, RESTC_CPP_IO_BUFFER_SIZE> out_buffer_;
+    bool frame_complete_ = false;
+    bool output_pending_ = false;
+    bool done_ = false;
+};
+
+
+std::unique_ptr<DataReader>
+DataReader::CreateZstdReader(std::unique_ptr<DataReader>&& source) {
+    return make_unique<ZstdReaderImpl>(move(source));
+}
+
+} // namepsace
+
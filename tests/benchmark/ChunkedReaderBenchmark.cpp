@@ -0,0 +1,225 @@
+/* Measure how fast we decode chunked bodies.
+ *
+ * Build with RESTC_CPP_WITH_BENCHMARKS.
+ *
+ * Compares the chunked reader, read one chunk at the time and
+ * several chunks at the time, with the reader we had before it
+ * parsed the chunk-size lines from the buffer.
+ */
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+
+#include "restc-cpp/restc-cpp.h"
+#include "restc-cpp/logging.h"
+#include "restc-cpp/DataReader.h"
+#include "restc-cpp/DataReaderStream.h"
+
+#ifdef RESTC_CPP_LOG_WITH_BOOST_LOG
+#   include <boost/log/core.hpp>
+#   include <boost/log/expressions.hpp>
+#endif
+
+using namespace std;
+using namespace restc_cpp;
+
+namespace {
+
+// Returns the chunked body in buffers of the size we read from the network
+class MemoryReader : public DataReader {
+public:
+    MemoryReader(const string& data)
+    : data_{data} {}
+
+    bool IsEof() const override {
+        return pos_ == data_.size();
+    }
+
+    boost::asio::const_buffers_1 ReadSome() override {
+        const auto bytes = min<size_t>(RESTC_CPP_IO_BUFFER_SIZE,
+                                       data_.size() - pos_);
+        boost::asio::const_buffers_1 rval{data_.data() + pos_, bytes};
+        pos_ += bytes;
+        return rval;
+    }
+
+private:
+    const string& data_;
+    size_t pos_ = 0;
+};
+
+/* The chunked reader as it was before it read the chunk-size
+ * lines with DataReaderStream::GetLine(). It parses them one char
+ * at the time, and traces as much as the current reader.
+ */
+class OldChunkedReader : public DataReader {
+public:
+    OldChunkedReader(unique_ptr<DataReaderStream>&& source)
+    : stream_{move(source)}
+    {
+    }
+
+    bool IsEof() const override {
+        return stream_->IsEof();
+    }
+
+    boost::asio::const_buffers_1 ReadSome() override {
+        EatPadding();
+
+        if (stream_->IsEof()) {
+            return {nullptr, 0};
+        }
+
+        if (chunk_len_ == 0) {
+            RESTC_CPP_LOG_TRACE << "OldChunkedReader::ReadSome(): Need new chunk.";
+            chunk_len_ = GetNextChunkLen();
+            RESTC_CPP_LOG_TRACE << "OldChunkedReader::ReadSome(): "
+                << "Next chunk is " << chunk_len_ << " bytes ("
+                << hex << chunk_len_ << " hex)";
+            if (chunk_len_ == 0) {
+                stream_->ReadHeaderLines([](string&&, string&&) {});
+                stream_->SetEof();
+                return {nullptr, 0};
+            }
+        }
+
+        auto rval = stream_->GetData(chunk_len_);
+        chunk_len_ -= boost::asio::buffer_size(rval);
+        if (chunk_len_ == 0) {
+            eat_chunk_padding_ = true;
+        }
+
+        RESTC_CPP_LOG_TRACE << "OldChunkedReader::ReadSome() # "
+            << boost::asio::buffer_size(rval) << " bytes";
+        return rval;
+    }
+
+private:
+    void EatPadding() {
+        if (eat_chunk_padding_) {
+            eat_chunk_padding_ = false;
+
+            if (stream_->Getc() != '\r') {
+                throw ParseException("Chunk: Missing padding CR!");
+            }
+
+            if (stream_->Getc() != '\n') {
+                throw ParseException("Chunk: Missing padding LF!");
+            }
+        }
+    }
+
+    size_t GetNextChunkLen() {
+        size_t chunk_len = 0;
+        char ch = stream_->Getc();
+
+        if (!isxdigit(ch)) {
+            throw ParseException("Missing chunk-length in new chunk.");
+        }
+
+        for(; isxdigit(ch); ch = stream_->Getc()) {
+            chunk_len *= 16;
+            if (ch >= 'a') {
+                chunk_len += 10 + (ch - 'a');
+            } else if (ch >= 'A') {
+                chunk_len += 10 + (ch - 'A');
+            } else {
+                chunk_len += ch - '0';
+            }
+        }
+
+        for(; ch != '\r'; ch = stream_->Getc())
+            ;
+
+        if ((ch = stream_->Getc()) != '\n') {
+            throw ParseException("Missing LF in first chunk line");
+        }
+
+        return chunk_len;
+    }
+
+    size_t chunk_len_ = 0;
+    bool eat_chunk_padding_ = false;
+    unique_ptr<DataReaderStream> stream_;
+};
+
+string MakeChunkedBody(size_t bodySize, size_t chunkSize) {
+    ostringstream body;
+    for(size_t written = 0; written < bodySize;) {
+        const auto len = min(chunkSize, bodySize - written);
+        body << hex << len << "\r\n" << string(len, 'x') << "\r\n";
+        written += len;
+    }
+    body << "0\r\n\r\n";
+    return body.str();
+}
+
+template <typename FactoryT, typename ReadT>
+void Run(const char *name, size_t bodySize, const string& chunked,
+         const FactoryT& factory, const ReadT& read) {
+    static const int iterations = 20;
+
+    const auto start = chrono::steady_clock::now();
+    for(int i = 0; i < iterations; ++i) {
+        auto reader = factory(make_unique<DataReaderStream>(
+            make_unique<MemoryReader>(chunked)));
+        size_t bytes = 0;
+        while(!reader->IsEof()) {
+            bytes += read(*reader);
+        }
+        if (bytes != bodySize) {
+            throw runtime_error("Unexpected size of the decoded body");
+        }
+    }
+    const auto duration = chrono::duration_cast<chrono::microseconds>(
+        chrono::steady_clock::now() - start).count();
+
+    const auto mb = (bodySize * iterations) / (1024.0 * 1024.0);
+    cout << "  " << name << ": "
+        << (duration / iterations / 1000.0) << " ms per body, "
+        << (mb / (duration / 1000000.0)) << " MB/s" << endl;
+}
+
+size_t ReadOne(DataReader& reader) {
+    return boost::asio::buffer_size(reader.ReadSome());
+}
+
+size_t ReadMany(DataReader& reader) {
+    write_buffers_t buffers;
+    reader.ReadSomeBuffers(buffers);
+    return boost::asio::buffer_size(buffers);
+}
+
+} // anonymous namespace
+
+int main() {
+    static const size_t body_size = 1024 * 1024 * 8;
+
+#ifdef RESTC_CPP_LOG_WITH_BOOST_LOG
+    // The readers trace every chunk
+    boost::log::core::get()->set_filter(
+        boost::log::trivial::severity >= boost::log::trivial::warning);
+#endif
+
+    for(const size_t chunk_size : {16, 1024 * 64}) {
+        const auto chunked = MakeChunkedBody(body_size, chunk_size);
+
+        cout << body_size << " bytes in chunks of " << chunk_size
+            << " bytes, " << chunked.size() << " bytes encoded:" << endl;
+
+        const auto old_reader = [](unique_ptr<DataReaderStream>&& source) {
+            return DataReader::ptr_t{make_unique<OldChunkedReader>(move(source))};
+        };
+        const auto new_reader = [](unique_ptr<DataReaderStream>&& source) {
+            return DataReader::CreateChunkedReader([](string&&, string&&) {},
+                                                   move(source));
+        };
+
+        Run("old reader, ReadSome()", body_size, chunked, old_reader, ReadOne);
+        Run("new reader, ReadSome()", body_size, chunked, new_reader, ReadOne);
+        Run("new reader, ReadSomeBuffers()", body_size, chunked, new_reader, ReadMany);
+    }
+
+    return 0;
+}
@@ -0,0 +1,296 @@
+/* Measure how fast we deserialize JSON objects to wide C++ structs.
+ *
+ * Build with RESTC_CPP_WITH_BENCHMARKS.
+ */
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include <boost/fusion/adapted.hpp>
+
+#include "restc-cpp/restc-cpp.h"
+#include "restc-cpp/SerializeJson.h"
+#include "restc-cpp/IteratorFromJsonSerializer.h"
+
+using namespace std;
+using namespace restc_cpp;
+
+#define WIDE_FIELDS(X) \
+    X(int, id) X(std::string, name) X(double, balance) X(bool, active) \
+    X(int, f04) X(std::string, f05) X(double, f06) X(bool, f07) \
+    X(int, f08) X(std::string, f09) X(double, f10) X(bool, f11) \
+    X(int, f12) X(std::string, f13) X(double, f14) X(bool, f15) \
+    X(int, f16) X(std::string, f17) X(double, f18) X(bool, f19) \
+    X(int, f20) X(std::string, f21) X(double, f22) X(bool, f23) \
+    X(int, f24) X(std::string, f25) X(double, f26) X(bool, f27) \
+    X(int, f28) X(std::string, f29) X(double, f30) X(bool, f31) \
+    X(int, f32) X(std::string, f33) X(double, f34) X(bool, f35) \
+    X(int, f36) X(std::string, f37) X(double, f38) X(bool, last_field)
+
+#define DECLARE_FIELD(type, name) type name = {};
+#define ADAPT_FIELD(type, name) (type, name)
+
+struct Wide {
+    WIDE_FIELDS(DECLARE_FIELD)
+};
+
+BOOST_FUSION_ADAPT_STRUCT(
+    Wide,
+    WIDE_FIELDS(ADAPT_FIELD)
+)
+
+namespace {
+
+void WriteValue(ostream& out, int, size_t i) { out << i; }
+void WriteValue(ostream& out, const string&, size_t i) { out << "\"value " << i << '"'; }
+void WriteValue(ostream& out, double, size_t i) { out << (i / 7.0); }
+void WriteValue(ostream& out, bool, size_t i) { out << ((i % 2) ? "true" : "false"); }
+
+// All the members get another name in the json
+const string mapped_prefix = "json_";
+
+JsonFieldMapping MakeMapping() {
+    JsonFieldMapping mapping;
+#define MAP_FIELD(type, name) \
+    mapping.entries.emplace_back(#name, mapped_prefix + #name);
+    WIDE_FIELDS(MAP_FIELD)
+#undef MAP_FIELD
+    return mapping;
+}
+
+string MakeJson(size_t numObjects, bool mapped) {
+    static const Wide types;
+    const auto prefix = mapped ? mapped_prefix : string{};
+
+    ostringstream json;
+    json << '[';
+    for(size_t i = 0; i < numObjects; ++i) {
+        if (i) {
+            json << ',';
+        }
+        // The fields in reverse order, so a linear search is at its worst
+        std::vector<std::string> fields;
+#define WRITE_FIELD(type, name) { \
+            ostringstream field; \
+            field << '"' << prefix << #name "\":"; \
+            WriteValue(field, types.name, i); \
+            fields.push_back(field.str()); \
+        }
+        WIDE_FIELDS(WRITE_FIELD)
+#undef WRITE_FIELD
+
+        json << '{';
+        for(auto it = fields.rbegin(); it != fields.rend(); ++it) {
+            if (it != fields.rbegin()) {
+                json << ',';
+            }
+            json << *it;
+        }
+        json << '}';
+    }
+    json << ']';
+    return json.str();
+}
+
+// Hands out the body in pieces, like data arriving from the network.
+// With a bandwidth, each read waits as long as the data would take to
+// arrive at that rate.
+class BufferReply : public BasicReply {
+public:
+    BufferReply(const string& body, double bandwidthMBps = 0,
+                size_t chunkSize = 1024 * 16)
+    : body_{body}, bandwidth_{bandwidthMBps * 1024 * 1024}
+    , chunk_size_{chunkSize}
+    {}
+
+    boost::uuids::uuid GetConnectionId() const override { return {}; }
+    int GetResponseCode() const override { return 200; }
+    const HttpResponse& GetHttpResponse() const override { return response_; }
+    string GetBodyAsString(size_t) override { throw logic_error("Not implemented"); }
+
+    size_t ReadInto(boost::asio::mutable_buffers_1 buffer) override {
+        const auto data = Read(boost::asio::buffer_size(buffer));
+        return boost::asio::buffer_copy(buffer, data);
+    }
+
+    boost::asio::const_buffers_1 GetSomeData() override {
+        return Read(chunk_size_);
+    }
+
+    bool MoreDataToRead() override { return pos_ < body_.size(); }
+    boost::optional<string> GetHeader(const string&) override { return {}; }
+    deque<string> GetHeaders(const string&) override { return {}; }
+
+private:
+    boost::asio::const_buffers_1 Read(size_t maxBytes) {
+        const auto len = min({chunk_size_, maxBytes, body_.size() - pos_});
+        const auto data = body_.data() + pos_;
+        pos_ += len;
+        if (bandwidth_ > 0) {
+            this_thread::sleep_for(chrono::microseconds(
+                static_cast<int64_t>(len / bandwidth_ * 1000000)));
+        }
+        return {data, len};
+    }
+
+    const string& body_;
+    const double bandwidth_;
+    const size_t chunk_size_;
+    size_t pos_ = 0;
+    HttpResponse response_;
+};
+
+// A context without an event loop. Sleep() blocks the thread.
+class ThreadContext : public Context {
+public:
+    boost::asio::yield_context& GetYield() override { throw logic_error("Not implemented"); }
+    RestClient& GetClient() override { throw logic_error("Not implemented"); }
+    unique_ptr<Reply> Get(string) override { throw logic_error("Not implemented"); }
+    unique_ptr<Reply> Post(string, string) override { throw logic_error("Not implemented"); }
+    unique_ptr<Reply> Put(string, string) override { throw logic_error("Not implemented"); }
+    unique_ptr<Reply> Delete(string) override { throw logic_error("Not implemented"); }
+    unique_ptr<Reply> Options(string) override { throw logic_error("Not implemented"); }
+    unique_ptr<Reply> Head(string) override { throw logic_error("Not implemented"); }
+    unique_ptr<Reply> Patch(string) override { throw logic_error("Not implemented"); }
+    unique_ptr<Reply> Request(restc_cpp::Request&) override { throw logic_error("Not implemented"); }
+
+    void Sleep(const boost::posix_time::microseconds& ms) override {
+        this_thread::sleep_for(chrono::microseconds(ms.total_microseconds()));
+    }
+};
+
+enum class Parser {
+    RAPIDJSON, RAPIDJSON_MAPPED, RAPIDJSON_REPLY, RAPIDJSON_PIPELINED, RAPIDJSON_PARALLEL, SIMDJSON,
+    ITERATOR, BATCHED, BATCHED_PREFETCH
+};
+
+void Run(bool reuse, Parser parser = Parser::RAPIDJSON, double bandwidthMBps = 0) {
+    static const int iterations = 10;
+
+    cout << "Deserializing structs with "
+        << boost::fusion::result_of::size<Wide>::value << " members"
+        << (reuse ? ", re-using the existing values" : "")
+        << (parser == Parser::RAPIDJSON_MAPPED ? ", with all the names mapped" : "")
+        << (parser == Parser::RAPIDJSON_REPLY ? ", streaming from a reply" : "")
+        << (parser == Parser::RAPIDJSON_PIPELINED ? ", pipelined from a reply" : "")
+        << (parser == Parser::RAPIDJSON_PARALLEL ? ", in parallel" : "")
+        << (parser == Parser::SIMDJSON ? ", with simdjson" : "")
+        << (parser == Parser::ITERATOR ? ", one at the time from a reply" : "")
+        << (parser == Parser::BATCHED ? ", in batches from a reply" : "")
+        << (parser == Parser::BATCHED_PREFETCH ? ", in batches parsed ahead from a reply" : "");
+    if (bandwidthMBps) {
+        cout << ", at " << bandwidthMBps << " MB/s";
+    }
+    cout << endl;
+
+    for(const size_t objects : {100, 2000, 20000}) {
+        const auto json = MakeJson(objects, parser == Parser::RAPIDJSON_MAPPED);
+        const auto mapping = MakeMapping();
+
+        serialize_properties_t properties;
+        properties.SetMaxMemoryConsumption(0xffffffffL);
+        properties.reuse_existing_values = reuse;
+        if (parser == Parser::RAPIDJSON_MAPPED) {
+            properties.name_mapping = &mapping;
+            use_json_key_cache(properties);
+        }
+        if (parser == Parser::RAPIDJSON_PARALLEL) {
+            properties.parallel_threads = max(thread::hardware_concurrency(), 1U);
+        }
+
+        std::vector<Wide> data;
+        size_t count = 0;
+        int last_id = -1;
+        const auto start = chrono::steady_clock::now();
+        for(int i = 0; i < iterations; ++i) {
+            if (!reuse) {
+                data.clear();
+            }
+            if (parser == Parser::SIMDJSON) {
+#ifdef RESTC_CPP_WITH_SIMDJSON
+                // Parse from a complete buffer, like for a reply with a Content-Length
+                auto buffer = json;
+                RapidJsonDeserializer<decltype(data)> handler(data, properties);
+                SimdJsonParser::Get().Parse(buffer, handler);
+#endif
+            } else if (parser == Parser::RAPIDJSON_PARALLEL) {
+                auto buffer = json;
+                SerializeFromJsonInParallel(data, buffer, properties);
+            } else if (parser == Parser::RAPIDJSON_REPLY) {
+                BufferReply reply(json, bandwidthMBps);
+                SerializeFromJson(data, reply, properties);
+            } else if (parser == Parser::RAPIDJSON_PIPELINED) {
+                ThreadContext ctx;
+                BufferReply reply(json, bandwidthMBps);
+                SerializeFromJsonPipelined(data, reply, ctx, properties);
+            } else if (parser == Parser::ITERATOR) {
+                // The objects are only looked at, not kept
+                BufferReply reply(json, bandwidthMBps);
+                IteratorFromJsonSerializer<Wide> wides(reply, &properties);
+                count = 0;
+                for(const auto& wide : wides) {
+                    last_id = wide.id;
+                    ++count;
+                }
+            } else if ((parser == Parser::BATCHED) || (parser == Parser::BATCHED_PREFETCH)) {
+                ThreadContext ctx;
+                BufferReply reply(json, bandwidthMBps);
+                auto wides = (parser == Parser::BATCHED)
+                    ? make_unique<BatchedIteratorFromJsonSerializer<Wide>>(reply, 256, &properties)
+                    : make_unique<BatchedIteratorFromJsonSerializer<Wide>>(reply, ctx, 256, &properties);
+                count = 0;
+                for(auto batch = wides->NextBatch(); !batch.empty(); batch = wides->NextBatch()) {
+                    for(const auto& wide : batch) {
+                        last_id = wide.id;
+                        ++count;
+                    }
+                }
+            } else {
+                istringstream stream(json);
+                SerializeFromJson(data, stream, properties);
+            }
+            if (!data.empty()) {
+                count = data.size();
+                last_id = data.back().id;
+            }
+            if ((count != objects) || (last_id != static_cast<int>(objects - 1))) {
+                throw runtime_error("Unexpected result");
+            }
+        }
+        const auto duration = chrono::duration_cast<chrono::microseconds>(
+            chrono::steady_clock::now() - start).count();
+
+        const auto mb = (json.size() * iterations) / (1024.0 * 1024.0);
+        cout << "  " << objects << " objects, " << json.size() << " bytes: "
+            << (duration / iterations / 1000.0) << " ms, "
+            << (mb / (duration / 1000000.0)) << " MB/s, "
+            << ((objects * iterations) / (duration / 1000000.0)) << " objects/s"
+            << endl;
+    }
+}
+
+} // anonymous namespace
+
+int main() {
+    Run(false);
+    Run(true);
+    Run(false, Parser::RAPIDJSON_MAPPED);
+    Run(false, Parser::RAPIDJSON_REPLY);
+    Run(false, Parser::RAPIDJSON_PIPELINED);
+
+    // With the network about as fast as the parser
+    Run(false, Parser::RAPIDJSON_REPLY, 80);
+    Run(false, Parser::RAPIDJSON_PIPELINED, 80);
+    Run(false, Parser::RAPIDJSON_PARALLEL);
+    Run(false, Parser::ITERATOR);
+    Run(false, Parser::BATCHED);
+    Run(false, Parser::ITERATOR, 80);
+    Run(false, Parser::BATCHED, 80);
+    Run(false, Parser::BATCHED_PREFETCH, 80);
+#ifdef RESTC_CPP_WITH_SIMDJSON
+    Run(false, Parser::SIMDJSON);
+#endif
+    return 0;
+}
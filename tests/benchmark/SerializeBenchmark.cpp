@@ -0,0 +1,98 @@
+/* Measure how fast we serialize C++ structs to JSON.
+ *
+ * Build with RESTC_CPP_WITH_BENCHMARKS.
+ */
+
+#include <chrono>
+#include <iostream>
+
+#include <boost/fusion/adapted.hpp>
+
+#include "restc-cpp/restc-cpp.h"
+#include "restc-cpp/SerializeJson.h"
+
+#include "rapidjson/stringbuffer.h"
+
+using namespace std;
+using namespace restc_cpp;
+
+#define WIDE_FIELDS(X) \
+    X(int, id) X(std::string, name) X(double, balance) X(bool, active) \
+    X(int, f04) X(std::string, f05) X(double, f06) X(bool, f07) \
+    X(int, f08) X(std::string, f09) X(double, f10) X(bool, f11) \
+    X(int, f12) X(std::string, f13) X(double, f14) X(bool, f15) \
+    X(int, f16) X(std::string, f17) X(double, f18) X(bool, last_field)
+
+#define DECLARE_FIELD(type, name) type name = {};
+#define ADAPT_FIELD(type, name) (type, name)
+
+struct Wide {
+    WIDE_FIELDS(DECLARE_FIELD)
+};
+
+BOOST_FUSION_ADAPT_STRUCT(
+    Wide,
+    WIDE_FIELDS(ADAPT_FIELD)
+)
+
+namespace {
+
+void SetValue(int& v, size_t i) { v = static_cast<int>(i); }
+void SetValue(string& v, size_t i) { v = "value " + to_string(i); }
+void SetValue(double& v, size_t i) { v = i / 7.0; }
+void SetValue(bool& v, size_t i) { v = (i % 2) != 0; }
+
+void Run(bool mapped) {
+    static const int iterations = 10;
+
+    JsonFieldMapping mapping;
+    mapping.entries.emplace_back("f05", "field_05");
+    mapping.entries.emplace_back("f13", "field_13");
+    mapping.entries.emplace_back("last_field", "the_last_field");
+    const excluded_names_t excluded{"f07", "f15"};
+
+    cout << "Serializing structs with "
+        << boost::fusion::result_of::size<Wide>::value << " members"
+        << (mapped ? ", with name mapping and excluded names" : "")
+        << endl;
+
+    for(const size_t objects : {100, 2000, 20000}) {
+        vector<Wide> data(objects);
+        for(size_t i = 0; i < objects; ++i) {
+#define SET_FIELD(type, name) SetValue(data[i].name, i + 1);
+            WIDE_FIELDS(SET_FIELD)
+#undef SET_FIELD
+        }
+
+        size_t bytes = 0;
+        const auto start = chrono::steady_clock::now();
+        for(int i = 0; i < iterations; ++i) {
+            rapidjson::StringBuffer buffer;
+            rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+            RapidJsonSerializer<decltype(data), decltype(writer)> serializer(data, writer);
+            if (mapped) {
+                serializer.SetNameMapping(&mapping);
+                serializer.ExcludeNames(const_cast<excluded_names_t *>(&excluded));
+            }
+            serializer.Serialize();
+            bytes = buffer.GetSize();
+        }
+        const auto duration = chrono::duration_cast<chrono::microseconds>(
+            chrono::steady_clock::now() - start).count();
+
+        const auto mb = (bytes * iterations) / (1024.0 * 1024.0);
+        cout << "  " << objects << " objects, " << bytes << " bytes: "
+            << (duration / iterations / 1000.0) << " ms, "
+            << (mb / (duration / 1000000.0)) << " MB/s, "
+            << ((objects * iterations) / (duration / 1000000.0)) << " objects/s"
+            << endl;
+    }
+}
+
+} // anonymous namespace
+
+int main() {
+    Run(false);
+    Run(true);
+    return 0;
+}
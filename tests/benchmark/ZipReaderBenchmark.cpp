@@ -0,0 +1,149 @@
+/* Measure how fast we decompress gzip encoded JSON.
+ *
+ * Build with RESTC_CPP_WITH_BENCHMARKS, and once for each
+ * backend (zlib, RESTC_CPP_WITH_ZLIB_NG, RESTC_CPP_WITH_LIBDEFLATE)
+ * to compare them.
+ */
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+
+#include "restc-cpp/restc-cpp.h"
+#include "restc-cpp/DataReader.h"
+
+#ifdef RESTC_CPP_WITH_ZLIB_NG
+#   include <zlib-ng.h>
+#   define RESTC_CPP_ZLIB_FN(name) zng_ ## name
+    using z_stream_t = zng_stream;
+#else
+#   include <zlib.h>
+#   define RESTC_CPP_ZLIB_FN(name) name
+    using z_stream_t = z_stream;
+#endif
+
+using namespace std;
+using namespace restc_cpp;
+
+namespace {
+
+// Returns the compressed body in buffers of the size we read from the network
+class MemoryReader : public DataReader {
+public:
+    MemoryReader(const string& data)
+    : data_{data} {}
+
+    bool IsEof() const override {
+        return pos_ == data_.size();
+    }
+
+    boost::asio::const_buffers_1 ReadSome() override {
+        const auto bytes = min<size_t>(RESTC_CPP_IO_BUFFER_SIZE,
+                                       data_.size() - pos_);
+        boost::asio::const_buffers_1 rval{data_.data() + pos_, bytes};
+        pos_ += bytes;
+        return rval;
+    }
+
+private:
+    const string& data_;
+    size_t pos_ = 0;
+};
+
+string MakeJson(size_t numObjects) {
+    ostringstream json;
+    json << '[';
+    for(size_t i = 0; i < numObjects; ++i) {
+        if (i) {
+            json << ',';
+        }
+        json << "{\"id\":" << i
+            << ",\"name\":\"User number " << i << "\""
+            << ",\"email\":\"user" << i << "@example.com\""
+            << ",\"active\":" << ((i % 3) ? "true" : "false")
+            << ",\"balance\":" << (i * 7919 % 100000) / 100.0
+            << ",\"tags\":[\"tag" << (i % 17) << "\",\"tag" << (i % 5) << "\"]"
+            << ",\"address\":{\"street\":\"" << (i % 997) << " Main Street\""
+            << ",\"zip\":\"" << (10000 + i % 89999) << "\"}}";
+    }
+    json << ']';
+    return json.str();
+}
+
+string Gzip(const string& data) {
+    z_stream_t strm = {};
+    if (RESTC_CPP_ZLIB_FN(deflateInit2)(&strm, 6, Z_DEFLATED, MAX_WBITS | 16,
+                                        8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        throw runtime_error("deflateInit2 failed");
+    }
+
+    string out(RESTC_CPP_ZLIB_FN(deflateBound)(&strm, data.size()), 0);
+    strm.next_in = reinterpret_cast<decltype(strm.next_in)>(
+        const_cast<char *>(data.data()));
+    strm.avail_in = static_cast<decltype(strm.avail_in)>(data.size());
+    strm.next_out = reinterpret_cast<decltype(strm.next_out)>(&out[0]);
+    strm.avail_out = static_cast<decltype(strm.avail_out)>(out.size());
+
+    if (RESTC_CPP_ZLIB_FN(deflate)(&strm, Z_FINISH) != Z_STREAM_END) {
+        throw runtime_error("deflate failed");
+    }
+    out.resize(out.size() - strm.avail_out);
+    RESTC_CPP_ZLIB_FN(deflateEnd)(&strm);
+    return out;
+}
+
+template <typename FactoryT>
+void Run(const char *name, const string& json, const string& compressed,
+         const FactoryT& factory) {
+    static const int iterations = 20;
+
+    const auto start = chrono::steady_clock::now();
+    for(int i = 0; i < iterations; ++i) {
+        auto reader = factory(make_unique<MemoryReader>(compressed));
+        size_t bytes = 0;
+        while(!reader->IsEof()) {
+            bytes += boost::asio::buffer_size(reader->ReadSome());
+        }
+        if (bytes != json.size()) {
+            throw runtime_error("Unexpected size of decompressed data");
+        }
+    }
+    const auto duration = chrono::duration_cast<chrono::microseconds>(
+        chrono::steady_clock::now() - start).count();
+
+    const auto mb = (json.size() * iterations) / (1024.0 * 1024.0);
+    cout << "  " << name << ": "
+        << (duration / iterations / 1000.0) << " ms per body, "
+        << (mb / (duration / 1000000.0)) << " MB/s" << endl;
+}
+
+} // anonymous namespace
+
+int main() {
+#ifdef RESTC_CPP_WITH_ZLIB_NG
+    cout << "Streaming backend: zlib-ng" << endl;
+#else
+    cout << "Streaming backend: zlib" << endl;
+#endif
+
+    for(const size_t objects : {100, 2000, 50000}) {
+        const auto json = MakeJson(objects);
+        const auto compressed = Gzip(json);
+
+        cout << json.size() << " bytes of JSON, " << compressed.size()
+            << " bytes compressed:" << endl;
+
+        Run("streaming", json, compressed, [](DataReader::ptr_t&& source) {
+            return DataReader::CreateGzipReader(move(source));
+        });
+
+#ifdef RESTC_CPP_WITH_LIBDEFLATE
+        const auto size = compressed.size();
+        Run("libdeflate", json, compressed, [size](DataReader::ptr_t&& source) {
+            return DataReader::CreateGzipBufferReader(move(source), size);
+        });
+#endif
+    }
+
+    return 0;
+}
@@ -5,6 +5,8 @@
 #include "restc-cpp/logging.h"
 #include "restc-cpp/RequestBuilder.h"
 
+#include <chrono>
+
 #include <boost/log/core.hpp>
 #include <boost/log/trivial.hpp>
 #include <boost/log/expressions.hpp>
@@ -94,6 +96,45 @@ STARTCASE(TestCRUD) {
 
 } ENDCASE
 
+STARTCASE(TestPostWithExpectContinue) {
+    Request::Properties properties;
+    properties.expectContinue = true;
+    // Long enough that the test is slow if the server never answers "100 Continue"
+    properties.expectContinueTimeoutMs = 10000;
+
+    auto rest_client = RestClient::Create(properties);
+    rest_client->ProcessWithPromise([&](Context& ctx) {
+
+    Post post;
+    post.username = "expecting";
+    post.motto = "Continue!";
+
+    const auto start = chrono::steady_clock::now();
+    auto reply = RequestBuilder(ctx)
+        .Post(GetDockerUrl(http_url))
+        .Data(post)
+        .Execute();
+    const auto elapsed = chrono::duration_cast<chrono::milliseconds>(
+        chrono::steady_clock::now() - start).count();
+
+    // The body was sent after the interim response, and the server saw it
+    CHECK_EQUAL(201, reply->GetResponseCode());
+    EXPECT(elapsed < 5000);
+
+    Post svr_post;
+    SerializeFromJson(svr_post, *reply);
+    CHECK_EQUAL(post.username, svr_post.username);
+    CHECK_EQUAL(post.motto, svr_post.motto);
+    EXPECT(svr_post.id > 0);
+
+    RequestBuilder(ctx)
+        .Delete(GetDockerUrl(http_url) + "/" + to_string(svr_post.id))
+        .Execute();
+
+    }).get();
+
+} ENDCASE
+
 STARTCASE(TestOptions) {
 
     auto rest_client = RestClient::Create();
@@ -3,6 +3,7 @@
 #include "restc-cpp/restc-cpp.h"
 #include "restc-cpp/logging.h"
 #include "restc-cpp/ConnectionPool.h"
+#include "restc-cpp/error.h"
 
 #include <boost/log/core.hpp>
 #include <boost/log/trivial.hpp>
@@ -20,6 +21,7 @@
 const string http_url = "http://localhost:3001/normal/posts";
 const string http_url_many = "http://localhost:3001/normal/manyposts";
 const string http_connection_close_url = "http://localhost:3001/close/posts";
+const string http_not_found_url = "http://localhost:3001/normal/posts/1000000";
 
 using namespace std;
 using namespace restc_cpp;
@@ -52,6 +54,78 @@ STARTCASE(TestConnectionRecycling) {
     }).get();
 } ENDCASE
 
+// An unread, small body is drained so the connection can be reused
+STARTCASE(TestConnectionRecyclingWithUnreadBody) {
+
+    auto rest_client = RestClient::Create();
+    rest_client->ProcessWithPromise([&](Context& ctx) {
+
+        boost::uuids::uuid first_conn_id;
+        {
+            auto repl_one = ctx.Get(GetDockerUrl(http_url));
+            first_conn_id = repl_one->GetConnectionId();
+            CHECK_EQUAL(200, repl_one->GetResponseCode());
+            // Don't read the body
+        }
+
+        // The body is drained by another co-routine. Let it return the
+        // connection to the pool.
+        auto pool = rest_client->GetConnectionPool();
+        for(int i = 0; (i < 100) && !pool->GetIdleConnections().get(); ++i) {
+            ctx.Sleep(std::chrono::milliseconds(10));
+        }
+
+        auto repl_two = ctx.Get(GetDockerUrl(http_url));
+        auto second_conn_id = repl_two->GetConnectionId();
+        CHECK_EQUAL(200, repl_two->GetResponseCode());
+        // Discard all data
+        while(repl_two->MoreDataToRead()) {
+            repl_two->GetSomeData();
+        }
+
+        CHECK_EQUAL(first_conn_id, second_conn_id);
+
+    }).get();
+} ENDCASE
+
+// The body of an error reply is drained so the connection can be reused
+STARTCASE(TestConnectionRecyclingAfterNotFound) {
+
+    auto rest_client = RestClient::Create();
+    rest_client->ProcessWithPromise([&](Context& ctx) {
+
+        auto repl_one = ctx.Get(GetDockerUrl(http_url));
+        auto first_conn_id = repl_one->GetConnectionId();
+        CHECK_EQUAL(200, repl_one->GetResponseCode());
+        // Discard all data
+        while(repl_one->MoreDataToRead()) {
+            repl_one->GetSomeData();
+        }
+        repl_one.reset();
+
+        EXPECT_THROWS_AS(ctx.Get(GetDockerUrl(http_not_found_url)),
+                         HttpNotFoundException);
+
+        // The body is drained by another co-routine. Let it return the
+        // connection to the pool.
+        auto pool = rest_client->GetConnectionPool();
+        for(int i = 0; (i < 100) && !pool->GetIdleConnections().get(); ++i) {
+            ctx.Sleep(std::chrono::milliseconds(10));
+        }
+
+        auto repl_two = ctx.Get(GetDockerUrl(http_url));
+        auto second_conn_id = repl_two->GetConnectionId();
+        CHECK_EQUAL(200, repl_two->GetResponseCode());
+        // Discard all data
+        while(repl_two->MoreDataToRead()) {
+            repl_two->GetSomeData();
+        }
+
+        CHECK_EQUAL(first_conn_id, second_conn_id);
+
+    }).get();
+} ENDCASE
+
 // Test that we honor 'Connection: close' server header
 STARTCASE(TestConnectionClose) {
     auto rest_client = RestClient::Create();
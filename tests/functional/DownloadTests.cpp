@@ -0,0 +1,80 @@
+#include <iostream>
+
+// Include before boost::log headers
+#include "restc-cpp/logging.h"
+
+#include <boost/log/core.hpp>
+#include <boost/log/trivial.hpp>
+#include <boost/log/expressions.hpp>
+#include <boost/filesystem.hpp>
+
+#include "restc-cpp/restc-cpp.h"
+#include "restc-cpp/RequestBuilder.h"
+#include "restc-cpp/SegmentedDownload.h"
+
+#include "restc-cpp/test_helper.h"
+#include "lest/lest.hpp"
+
+using namespace std;
+using namespace restc_cpp;
+
+
+static const string address = GetDockerUrl("http://localhost:3001/download/large.bin");
+
+string ReadFile(const boost::filesystem::path& path) {
+    ifstream file(path.string(), ios::binary);
+    return {istreambuf_iterator<char>(file), {}};
+}
+
+const lest::test specification[] = {
+
+STARTCASE(TestSaveToFile)
+{
+    const auto path = boost::filesystem::unique_path();
+    auto rest_client = RestClient::Create();
+
+    string body;
+    rest_client->ProcessWithPromise([&](Context& ctx) {
+        body = RequestBuilder(ctx).Get(address).Execute()->GetBodyAsString();
+
+        auto reply = RequestBuilder(ctx).Get(address).Execute();
+        CHECK_EQUAL(body.size(), reply->SaveToFile(path));
+    }).get();
+
+    CHECK_EQUAL(true, body == ReadFile(path));
+    boost::filesystem::remove(path);
+} ENDCASE
+
+STARTCASE(TestSegmentedDownload)
+{
+    const auto path = boost::filesystem::unique_path();
+    auto rest_client = RestClient::Create();
+
+    string body;
+    rest_client->ProcessWithPromise([&](Context& ctx) {
+        body = RequestBuilder(ctx).Get(address).Execute()->GetBodyAsString();
+    }).get();
+
+    SegmentedDownload::Config config;
+    config.maxSegments = 4;
+    config.minSegmentSize = 1024 * 1024;
+    const auto bytes = SegmentedDownload::Download(*rest_client, address,
+                                                   path, config).get();
+
+    CHECK_EQUAL(body.size(), bytes);
+    CHECK_EQUAL(true, body == ReadFile(path));
+    boost::filesystem::remove(path);
+} ENDCASE
+
+}; //lest
+
+
+int main( int argc, char * argv[] )
+{
+    namespace logging = boost::log;
+    logging::core::get()->set_filter
+    (
+        logging::trivial::severity >= logging::trivial::info
+    );
+    return lest::run( specification, argc, argv );
+}
@@ -4,6 +4,8 @@
 #include "restc-cpp/restc-cpp.h"
 #include "restc-cpp/logging.h"
 #include "restc-cpp/ConnectionPool.h"
+#include "restc-cpp/RequestBuilder.h"
+#include "restc-cpp/ResponseCache.h"
 
 #include <boost/log/core.hpp>
 #include <boost/log/trivial.hpp>
@@ -22,10 +24,25 @@
 const string http_redirect_url = "http://localhost:3001/redirect/posts";
 const string http_reredirect_url = "http://localhost:3001/reredirect/posts";
 const string http_redirect_loop_url = "http://localhost:3001/loop/posts";
+const string http_moved_url = "http://localhost:3001/moved/posts";
+const string http_temporary_url = "http://localhost:3001/temporary/posts";
 
 using namespace std;
 using namespace restc_cpp;
 
+struct Post {
+    int id = 0;
+    string username;
+    string motto;
+};
+
+BOOST_FUSION_ADAPT_STRUCT(
+    Post,
+    (int, id)
+    (string, username)
+    (string, motto)
+)
+
 const lest::test specification[] = {
 
 TEST(TestNoRedirects)
@@ -72,6 +89,63 @@ TEST(TestDoubleRedirect)
     }).get();
 },
 
+TEST(TestPermanentRedirectIsCached)
+{
+    Request::Properties properties;
+    properties.cachePermanentRedirects = true;
+
+    auto rest_client = RestClient::Create(properties);
+    rest_client->ProcessWithPromise([&](Context& ctx) {
+
+        const auto url = GetDockerUrl(http_redirect_url);
+        auto cache = ctx.GetClient().GetResponseCache();
+        EXPECT(!cache->GetPermanentRedirect(url));
+
+        auto repl = ctx.Get(url);
+        CHECK_EQUAL(200, repl->GetResponseCode());
+        repl->GetBodyAsString();
+        EXPECT(cache->GetPermanentRedirect(url).is_initialized());
+
+        // Goes straight to the new location
+        repl = ctx.Get(url);
+        CHECK_EQUAL(200, repl->GetResponseCode());
+        repl->GetBodyAsString();
+
+    }).get();
+},
+
+TEST(TestPost308KeepsMethodAndBody)
+{
+    Request::Properties properties;
+    properties.cachePermanentRedirects = true;
+
+    auto rest_client = RestClient::Create(properties);
+    rest_client->ProcessWithPromise([&](Context& ctx) {
+
+        Post post;
+        post.username = "moved";
+        post.motto = "Same method, same body";
+
+        for(const auto& url : {http_moved_url, http_moved_url, http_temporary_url}) {
+            auto reply = RequestBuilder(ctx)
+                .Post(GetDockerUrl(url))
+                .Data(post)
+                .Execute();
+
+            Post svr_post;
+            SerializeFromJson(svr_post, *reply);
+            CHECK_EQUAL(post.username, svr_post.username);
+            CHECK_EQUAL(post.motto, svr_post.motto);
+            EXPECT(svr_post.id > 0);
+        }
+
+        // Redirects of POST requests are not cached
+        EXPECT(!ctx.GetClient().GetResponseCache()->GetPermanentRedirect(
+            GetDockerUrl(http_moved_url)));
+
+    }).get();
+},
+
 TEST(TestRedirectLoop)
 {
     auto rest_client = RestClient::Create();
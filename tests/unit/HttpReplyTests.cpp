@@ -6,6 +6,14 @@
 #include <boost/log/trivial.hpp>
 #include <boost/log/expressions.hpp>
 
+#ifdef __linux__
+#   include <unistd.h>
+#endif
+
+#ifdef RESTC_CPP_WITH_LIBDEFLATE
+#   include <libdeflate.h>
+#endif
+
 #include "../src/ReplyImpl.h"
 
 #include "restc-cpp/test_helper.h"
@@ -33,7 +41,7 @@ public:
     }
 
     boost::asio::const_buffers_1 ReadSome() override {
-        if (IsEof()) {
+        if (next_buffer_ == test_buffers_.end()) {
             return {nullptr, 0};
         }
 
@@ -47,11 +55,153 @@ public:
     test_buffers_t::iterator next_buffer_;
 };
 
+/*! Mock reader that can also read directly into the callers buffer */
+class MockDirectReader : public MockReader {
+public:
+    MockDirectReader(test_buffers_t& buffers)
+    : MockReader(buffers) {}
+
+    bool CanReadInto() const noexcept override {
+        return true;
+    }
+
+    size_t ReadInto(boost::asio::mutable_buffers_1 buffer) override {
+        if (IsEof()) {
+            return 0;
+        }
+
+        const auto bytes = boost::asio::buffer_copy(buffer,
+            boost::asio::buffer(*next_buffer_));
+        ++next_buffer_;
+        return bytes;
+    }
+};
+
+#ifdef __linux__
+/*! Mock reader that splices the data to the file
+ *
+ * Like a socket, it is not at EOF when the data ends.
+ */
+class MockSpliceReader : public MockReader {
+public:
+    MockSpliceReader(test_buffers_t& buffers)
+    : MockReader(buffers) {}
+
+    bool IsEof() const override {
+        return false;
+    }
+
+    bool CanSpliceTo() const noexcept override {
+        return true;
+    }
+
+    size_t SpliceTo(int fd, size_t maxBytes) override {
+        if (next_buffer_ == test_buffers_.end()) {
+            return 0;
+        }
+
+        const auto bytes = std::min(maxBytes, next_buffer_->size());
+        if (::write(fd, next_buffer_->data(), bytes)
+            != static_cast<ssize_t>(bytes)) {
+            throw IoException("MockSpliceReader: write failed");
+        }
+        ++next_buffer_;
+        return bytes;
+    }
+};
+#endif
+
+/*! Socket that stays open until it is closed. It does no IO. */
+class MockSocket : public Socket {
+public:
+    MockSocket(boost::asio::io_service& ioService, bool& closed)
+    : socket_{ioService}, closed_{closed} {}
+
+    boost::asio::ip::tcp::socket& GetSocket() override {
+        return socket_;
+    }
+
+    const boost::asio::ip::tcp::socket& GetSocket() const override {
+        return socket_;
+    }
+
+    std::size_t AsyncReadSome(boost::asio::mutable_buffers_1 /*buffers*/,
+                              boost::asio::yield_context& /*yield*/) override {
+        throw NotSupportedException("MockSocket");
+    }
+
+    void AsyncWaitForData(boost::asio::yield_context& /*yield*/) override {}
+
+    std::size_t AsyncRead(boost::asio::mutable_buffers_1 /*buffers*/,
+                          boost::asio::yield_context& /*yield*/) override {
+        throw NotSupportedException("MockSocket");
+    }
+
+    void AsyncWrite(const boost::asio::const_buffers_1& /*buffers*/,
+                    boost::asio::yield_context& /*yield*/) override {
+        throw NotSupportedException("MockSocket");
+    }
+
+    void AsyncWrite(const write_buffers_t& /*buffers*/,
+                    boost::asio::yield_context& /*yield*/) override {
+        throw NotSupportedException("MockSocket");
+    }
+
+    void AsyncConnect(const boost::asio::ip::tcp::endpoint& /*ep*/,
+                      const std::string& /*host*/,
+                      boost::asio::yield_context& /*yield*/) override {
+        throw NotSupportedException("MockSocket");
+    }
+
+    void AsyncShutdown(boost::asio::yield_context& /*yield*/) override {}
+
+    void Close(Reason /*reason*/) override {
+        closed_ = true;
+    }
+
+    bool IsOpen() const noexcept override {
+        return !closed_;
+    }
+
+protected:
+    std::ostream& Print(std::ostream& o) const override {
+        return o << "{MockSocket}";
+    }
+
+private:
+    boost::asio::ip::tcp::socket socket_;
+    bool& closed_;
+};
+
+class MockConnection : public Connection {
+public:
+    MockConnection(boost::asio::io_service& ioService, bool& closed)
+    : socket_{ioService, closed} {}
+
+    boost::uuids::uuid GetId() const override {
+        return id_;
+    }
+
+    Socket& GetSocket() override {
+        return socket_;
+    }
+
+    const Socket& GetSocket() const override {
+        return socket_;
+    }
+
+private:
+    MockSocket socket_;
+    const boost::uuids::uuid id_ = boost::uuids::random_generator()();
+};
+
 class TestReply : public ReplyImpl
 {
 public:
-    TestReply(Context& ctx, RestClient& owner, test_buffers_t& buffers)
-    : ReplyImpl(nullptr, ctx, owner, Request::Type::GET), buffers_{buffers}
+    TestReply(Context& ctx, RestClient& owner, test_buffers_t& buffers,
+              Connection::ptr_t connection = nullptr)
+    : ReplyImpl(move(connection), ctx, owner, Request::Type::GET)
+    , buffers_{buffers}
     {
     }
 
@@ -59,10 +209,60 @@ public:
         StartReceiveFromServer(make_unique<MockReader>(buffers_));
     }
 
+    void SimulateServerReplyDirect() {
+        StartReceiveFromServer(make_unique<MockDirectReader>(buffers_));
+    }
+
+#ifdef __linux__
+    void SimulateServerReplySplice() {
+        StartReceiveFromServer(make_unique<MockSpliceReader>(buffers_));
+    }
+#endif
+
+    bool SimulateServerContinue() {
+        return ReceiveContinue(make_unique<MockReader>(buffers_));
+    }
+
 private:
     test_buffers_t& buffers_;
 };
 
+// Only provides GetSomeData(), and hands out the body in small pieces
+class PiecesReply : public BasicReply {
+public:
+    PiecesReply(std::string body, size_t pieceSize)
+    : body_{std::move(body)}, piece_size_{pieceSize}
+    {}
+
+    boost::uuids::uuid GetConnectionId() const override { return {}; }
+    int GetResponseCode() const override { return 200; }
+    const HttpResponse& GetHttpResponse() const override { return response_; }
+
+    std::string GetBodyAsString(size_t) override {
+        throw std::logic_error("Not implemented");
+    }
+
+    boost::asio::const_buffers_1 GetSomeData() override {
+        const auto len = std::min(piece_size_, body_.size() - pos_);
+        const auto data = body_.data() + pos_;
+        pos_ += len;
+        return {data, len};
+    }
+
+    bool MoreDataToRead() override { return pos_ < body_.size(); }
+
+    boost::optional<std::string> GetHeader(const std::string&) override {
+        return {};
+    }
+
+    std::deque<std::string> GetHeaders(const std::string&) override { return {}; }
+
+private:
+    const std::string body_;
+    const size_t piece_size_;
+    size_t pos_ = 0;
+    HttpResponse response_;
+};
 
 } // unittests
 } // restc_cpp
@@ -170,6 +370,31 @@ STARTCASE(TestSimpleVerySegmentedHeader)
      }).get();
 } ENDCASE
 
+STARTCASE(TestFoldedHeader)
+{
+    ::restc_cpp::unittests::test_buffers_t buffer;
+
+    buffer.push_back("HTTP/1.1 200 OK\r\n"
+        "Server:   Cowboy  \r\n"
+        "X-Folded: first\r\n"
+        " \tsecond\r\n"
+        "Content-Length: 0\r\n"
+        "\r\n");
+
+     auto rest_client = RestClient::Create();
+     rest_client->ProcessWithPromise([&](Context& ctx) {
+
+         ::restc_cpp::unittests::TestReply reply(ctx, *rest_client, buffer);
+
+         reply.SimulateServerReply();
+
+         CHECK_EQUAL("Cowboy", *reply.GetHeader("Server"));
+         CHECK_EQUAL("first second", *reply.GetHeader("X-Folded"));
+         CHECK_EQUAL("0", *reply.GetHeader("Content-Length"));
+
+     }).get();
+} ENDCASE
+
 STARTCASE(TestSimpleBody)
 {
     ::restc_cpp::unittests::test_buffers_t buffer;
@@ -199,6 +424,310 @@ STARTCASE(TestSimpleBody)
      }).get();
 } ENDCASE
 
+STARTCASE(TestBodyIntoString)
+{
+    ::restc_cpp::unittests::test_buffers_t buffer;
+
+    buffer.push_back("HTTP/1.1 200 OK\r\n"
+        "Content-Length: 10\r\n"
+        "\r\n"
+        "12345");
+    buffer.push_back("67890");
+
+     auto rest_client = RestClient::Create();
+     rest_client->ProcessWithPromise([&](Context& ctx) {
+
+         ::restc_cpp::unittests::TestReply reply(ctx, *rest_client, buffer);
+
+         reply.SimulateServerReply();
+         std::string body = "Some previous, longer, content";
+         reply.GetBodyInto(body);
+
+         CHECK_EQUAL("1234567890", body);
+
+     }).get();
+} ENDCASE
+
+STARTCASE(TestBodyIntoVectorDirect)
+{
+    ::restc_cpp::unittests::test_buffers_t buffer;
+
+    buffer.push_back("HTTP/1.1 200 OK\r\n"
+        "Content-Length: 10\r\n"
+        "\r\n"
+        "12345");
+    buffer.push_back("67890");
+
+     auto rest_client = RestClient::Create();
+     rest_client->ProcessWithPromise([&](Context& ctx) {
+
+         ::restc_cpp::unittests::TestReply reply(ctx, *rest_client, buffer);
+
+         reply.SimulateServerReplyDirect();
+         std::vector<char> body(100, 'x');
+         reply.GetBodyInto(body);
+
+         CHECK_EQUAL("1234567890", std::string(body.begin(), body.end()));
+
+     }).get();
+} ENDCASE
+
+STARTCASE(TestReadIntoSmallBufferChunked)
+{
+    ::restc_cpp::unittests::test_buffers_t buffer;
+
+    buffer.push_back("HTTP/1.1 200 OK\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "\r\n");
+    buffer.push_back("4\r\nWiki\r\n");
+    buffer.push_back("5\r\npedia\r\n");
+    buffer.push_back("0\r\n\r\n");
+
+     auto rest_client = RestClient::Create();
+     rest_client->ProcessWithPromise([&](Context& ctx) {
+
+         ::restc_cpp::unittests::TestReply reply(ctx, *rest_client, buffer);
+
+         reply.SimulateServerReply();
+
+         std::string body;
+         char data[3] = {};
+         while(reply.MoreDataToRead()) {
+             const auto bytes = reply.ReadInto({data, sizeof(data)});
+             body.append(data, bytes);
+         }
+
+         CHECK_EQUAL("Wikipedia", body);
+
+     }).get();
+} ENDCASE
+
+STARTCASE(TestSaveToFile)
+{
+    ::restc_cpp::unittests::test_buffers_t buffer;
+
+    buffer.push_back("HTTP/1.1 200 OK\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "\r\n");
+    buffer.push_back("4\r\nWiki\r\n");
+    buffer.push_back("5\r\npedia\r\n");
+    buffer.push_back("0\r\n\r\n");
+
+    const auto path = boost::filesystem::temp_directory_path()
+        / boost::filesystem::unique_path();
+
+     auto rest_client = RestClient::Create();
+     rest_client->ProcessWithPromise([&](Context& ctx) {
+
+         ::restc_cpp::unittests::TestReply reply(ctx, *rest_client, buffer);
+
+         reply.SimulateServerReply();
+         CHECK_EQUAL(9, static_cast<int>(reply.SaveToFile(path)));
+
+     }).get();
+
+    std::ifstream file(path.string(), std::ios::binary);
+    std::string content{std::istreambuf_iterator<char>(file), {}};
+    CHECK_EQUAL("Wikipedia", content);
+    boost::filesystem::remove(path);
+} ENDCASE
+
+#ifdef __linux__
+// The server closes the connection before Content-Length is reached
+STARTCASE(TestSaveTruncatedBodyToFile)
+{
+    ::restc_cpp::unittests::test_buffers_t buffer;
+
+    buffer.push_back("HTTP/1.1 200 OK\r\n"
+        "Content-Length: 10\r\n"
+        "\r\n");
+    buffer.push_back("Wiki");
+
+    const auto path = boost::filesystem::temp_directory_path()
+        / boost::filesystem::unique_path();
+
+     auto rest_client = RestClient::Create();
+     rest_client->ProcessWithPromise([&](Context& ctx) {
+
+         ::restc_cpp::unittests::TestReply reply(ctx, *rest_client, buffer);
+
+         reply.SimulateServerReplySplice();
+         EXPECT_THROWS_AS(reply.SaveToFile(path), ProtocolException);
+
+     }).get();
+
+    boost::filesystem::remove(path);
+} ENDCASE
+#endif // __linux__
+
+#ifdef RESTC_CPP_WITH_LIBDEFLATE
+// Too large to decompress in one buffer with libdeflate
+STARTCASE(TestLargeGzipBody)
+{
+    ::restc_cpp::unittests::test_buffers_t buffer;
+
+    const std::string data(RESTC_CPP_SANE_DATA_LIMIT + 1024, 'x');
+    auto compressor = libdeflate_alloc_compressor(9);
+    std::string compressed(libdeflate_gzip_compress_bound(
+        compressor, data.size()), 0);
+    compressed.resize(libdeflate_gzip_compress(compressor,
+        data.data(), data.size(), &compressed[0], compressed.size()));
+    libdeflate_free_compressor(compressor);
+
+    buffer.push_back("HTTP/1.1 200 OK\r\n"
+        "Content-Encoding: gzip\r\n"
+        "Content-Length: " + std::to_string(compressed.size()) + "\r\n"
+        "\r\n");
+    buffer.push_back(compressed);
+
+     auto rest_client = RestClient::Create();
+     rest_client->ProcessWithPromise([&](Context& ctx) {
+
+         ::restc_cpp::unittests::TestReply reply(ctx, *rest_client, buffer);
+
+         reply.SimulateServerReply();
+
+         size_t bytes = 0;
+         while(reply.MoreDataToRead()) {
+             bytes += boost::asio::buffer_size(reply.GetSomeData());
+         }
+
+         CHECK_EQUAL(data.size(), bytes);
+
+     }).get();
+} ENDCASE
+#endif // RESTC_CPP_WITH_LIBDEFLATE
+
+#ifdef RESTC_CPP_WITH_BROTLI
+STARTCASE(TestBrotliBody)
+{
+    ::restc_cpp::unittests::test_buffers_t buffer;
+
+    static const char compressed[] = "\x1b\x30\x00\x00\x04\x9a\x71\xa4\x9f\x47"
+        "\x90\x78\x1b\xee\xd6\x8a\x6c\xb2\x0a\x35\xb2\xc2\x3e\x32\x6b\xa6\x7f"
+        "\x7d\x77\x90\x25\x10";
+
+    buffer.push_back("HTTP/1.1 200 OK\r\n"
+        "Content-Encoding: br\r\n"
+        "Content-Length: 32\r\n"
+        "\r\n");
+    buffer.push_back(std::string(compressed, sizeof(compressed) - 1));
+
+     auto rest_client = RestClient::Create();
+     rest_client->ProcessWithPromise([&](Context& ctx) {
+
+         ::restc_cpp::unittests::TestReply reply(ctx, *rest_client, buffer);
+
+         reply.SimulateServerReply();
+         CHECK_EQUAL("Hello, compressed world! Hello, compressed world!",
+                     reply.GetBodyAsString());
+
+     }).get();
+} ENDCASE
+#endif // RESTC_CPP_WITH_BROTLI
+
+#ifdef RESTC_CPP_WITH_ZSTD
+STARTCASE(TestZstdBody)
+{
+    ::restc_cpp::unittests::test_buffers_t buffer;
+
+    static const char compressed[] = "\x28\xb5\x2f\xfd\x20\x31\xfd\x00\x00\xc8"
+        "\x48\x65\x6c\x6c\x6f\x2c\x20\x63\x6f\x6d\x70\x72\x65\x73\x73\x65\x64"
+        "\x20\x77\x6f\x72\x6c\x64\x21\x20\x01\x00\x31\x38\xc7";
+
+    buffer.push_back("HTTP/1.1 200 OK\r\n"
+        "Content-Encoding: zstd\r\n"
+        "Content-Length: 40\r\n"
+        "\r\n");
+    buffer.push_back(std::string(compressed, sizeof(compressed) - 1));
+
+     auto rest_client = RestClient::Create();
+     rest_client->ProcessWithPromise([&](Context& ctx) {
+
+         ::restc_cpp::unittests::TestReply reply(ctx, *rest_client, buffer);
+
+         reply.SimulateServerReply();
+         CHECK_EQUAL("Hello, compressed world! Hello, compressed world!",
+                     reply.GetBodyAsString());
+
+     }).get();
+} ENDCASE
+#endif // RESTC_CPP_WITH_ZSTD
+
+STARTCASE(TestSkipContinue)
+{
+    ::restc_cpp::unittests::test_buffers_t buffer;
+
+    buffer.push_back("HTTP/1.1 100 Continue\r\n"
+        "\r\n"
+        "HTTP/1.1 200 OK\r\n"
+        "Server: Cowboy\r\n"
+        "Content-Length: 10\r\n"
+        "\r\n"
+        "1234567890");
+
+     auto rest_client = RestClient::Create();
+     rest_client->ProcessWithPromise([&](Context& ctx) {
+
+         ::restc_cpp::unittests::TestReply reply(ctx, *rest_client, buffer);
+
+         reply.SimulateServerReply();
+         auto body = reply.GetBodyAsString();
+
+         CHECK_EQUAL(200, reply.GetResponseCode());
+         CHECK_EQUAL("Cowboy", *reply.GetHeader("Server"));
+         CHECK_EQUAL(10, (int)body.size());
+
+     }).get();
+} ENDCASE
+
+STARTCASE(TestRejectedBeforeContinue)
+{
+    ::restc_cpp::unittests::test_buffers_t buffer;
+
+    buffer.push_back("HTTP/1.1 413 Payload Too Large\r\n"
+        "Content-Length: 4\r\n"
+        "\r\n"
+        "Nope");
+
+     auto rest_client = RestClient::Create();
+     rest_client->ProcessWithPromise([&](Context& ctx) {
+
+         ::restc_cpp::unittests::TestReply reply(ctx, *rest_client, buffer);
+
+         CHECK_EQUAL(false, reply.SimulateServerContinue());
+         auto body = reply.GetBodyAsString();
+
+         CHECK_EQUAL(413, reply.GetResponseCode());
+         CHECK_EQUAL("Nope", body);
+
+     }).get();
+} ENDCASE
+
+// A 304 reply has no body, even if it has the Content-Length of the resource
+STARTCASE(TestNotModifiedWithContentLength)
+{
+    ::restc_cpp::unittests::test_buffers_t buffer;
+
+    buffer.push_back("HTTP/1.1 304 Not Modified\r\n"
+        "ETag: \"1\"\r\n"
+        "Content-Length: 10\r\n"
+        "\r\n");
+
+     auto rest_client = RestClient::Create();
+     rest_client->ProcessWithPromise([&](Context& ctx) {
+
+         ::restc_cpp::unittests::TestReply reply(ctx, *rest_client, buffer);
+
+         reply.SimulateServerReply();
+
+         CHECK_EQUAL(304, reply.GetResponseCode());
+         EXPECT(!reply.MoreDataToRead());
+         CHECK_EQUAL("", reply.GetBodyAsString());
+
+     }).get();
+} ENDCASE
+
 STARTCASE(TestSimpleBody2)
 {
     ::restc_cpp::unittests::test_buffers_t buffer;
@@ -389,6 +918,36 @@ STARTCASE(TestChunkedBody4)
 
 
 
+STARTCASE(TestManySmallChunks)
+{
+    ::restc_cpp::unittests::test_buffers_t buffer;
+
+    std::string chunks;
+    for(int i = 0; i < 100; ++i) {
+        chunks += "10\r\n0123456789abcdef\r\n";
+    }
+    chunks += "0\r\n\r\n";
+
+    buffer.push_back("HTTP/1.1 200 OK\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "\r\n");
+    buffer.push_back(chunks.substr(0, 1000));
+    buffer.push_back(chunks.substr(1000));
+
+     auto rest_client = RestClient::Create();
+     rest_client->ProcessWithPromise([&](Context& ctx) {
+
+         ::restc_cpp::unittests::TestReply reply(ctx, *rest_client, buffer);
+
+         reply.SimulateServerReply();
+         auto body = reply.GetBodyAsString();
+
+         CHECK_EQUAL(16 * 100, (int)body.size());
+         CHECK_EQUAL("0123456789abcdef", body.substr(16 * 99));
+
+     }).get();
+} ENDCASE
+
 STARTCASE(TestChunkedTrailer)
 {
     ::restc_cpp::unittests::test_buffers_t buffer;
@@ -470,6 +1029,122 @@ STARTCASE(TestChunkedParameterAndTrailer)
 
      }).get();
 } ENDCASE
+// A size-line that ends with a bare LF is rejected by both the code that
+// collects buffered chunks and the code that reads the next chunk.
+STARTCASE(TestChunkedBodyWithBareLf)
+{
+    ::restc_cpp::unittests::test_buffers_t buffer;
+
+    buffer.push_back("HTTP/1.1 200 OK\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "\r\n"
+        "4\r\nWiki\r\n5\npedia\r\n0\r\n\r\n");
+
+     auto rest_client = RestClient::Create();
+     rest_client->ProcessWithPromise([&](Context& ctx) {
+
+         ::restc_cpp::unittests::TestReply reply(ctx, *rest_client, buffer);
+
+         reply.SimulateServerReply();
+         EXPECT_THROWS_AS(reply.GetBodyAsString(), ParseException);
+
+     }).get();
+} ENDCASE
+
+// The reader of an unread body outlives the reply while it is drained
+STARTCASE(TestDrainChunkedTrailer)
+{
+    ::restc_cpp::unittests::test_buffers_t buffer;
+
+    buffer.push_back("HTTP/1.1 200 OK\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "\r\n");
+    buffer.push_back("4\r\nWiki\r\n");
+    buffer.push_back("5\r\npedia\r\n");
+    buffer.push_back("0\r\n");
+    buffer.push_back("Server: Indian\r\n");
+    buffer.push_back("Connection: close\r\n");
+    buffer.push_back("\r\n");
+
+     bool closed = false;
+     auto rest_client = RestClient::Create();
+     rest_client->ProcessWithPromise([&](Context& ctx) {
+
+         std::weak_ptr<Connection> weak_connection;
+         {
+             auto connection = make_shared<::restc_cpp::unittests::MockConnection>(
+                 rest_client->GetIoService(), closed);
+             weak_connection = connection;
+
+             ::restc_cpp::unittests::TestReply reply(ctx, *rest_client, buffer,
+                                                     move(connection));
+             reply.SimulateServerReply();
+             CHECK_EQUAL("chunked", *reply.GetHeader("Transfer-Encoding"));
+             // Don't read the body
+         }
+
+         // The body is drained by another co-routine
+         for(int i = 0; (i < 100) && !weak_connection.expired(); ++i) {
+             ctx.Sleep(std::chrono::milliseconds(10));
+         }
+
+         EXPECT(weak_connection.expired());
+
+     }).get();
+
+     // The connection is closed only if the drain failed
+     EXPECT(!closed);
+} ENDCASE
+
+// The BasicReply methods are built on GetSomeData()
+STARTCASE(ReplyDefaultsUseGetSomeData) {
+    const std::string body = "0123456789abcdefghij";
+
+    {
+        ::restc_cpp::unittests::PiecesReply reply(body, 7);
+        std::string data;
+        char buffer[3] = {};
+        while(const auto bytes = reply.ReadInto({buffer, sizeof(buffer)})) {
+            data.append(buffer, bytes);
+        }
+        CHECK_EQUAL(body, data);
+    }
+
+    {
+        // What ReadInto() did not return is not lost
+        ::restc_cpp::unittests::PiecesReply reply(body, 7);
+        char buffer[3] = {};
+        CHECK_EQUAL(3u, reply.ReadInto({buffer, sizeof(buffer)}));
+        std::vector<char> rest;
+        reply.GetBodyInto(rest);
+        CHECK_EQUAL(body.substr(3), std::string(rest.begin(), rest.end()));
+    }
+
+    {
+        ::restc_cpp::unittests::PiecesReply reply(body, 7);
+        std::string data = "old data";
+        EXPECT_THROWS_AS(reply.GetBodyInto(data, 10), ConstraintException);
+    }
+
+    const auto path = boost::filesystem::temp_directory_path()
+        / boost::filesystem::unique_path();
+    {
+        ::restc_cpp::unittests::PiecesReply reply(body, 7);
+        CHECK_EQUAL(body.size(), reply.SaveToFile(path));
+    }
+    {
+        ::restc_cpp::unittests::PiecesReply reply("XY", 7);
+        CHECK_EQUAL(2u, reply.WriteToFileAt(path, 5));
+    }
+    {
+        std::ifstream file(path.string(), std::ios::binary);
+        const std::string data{std::istreambuf_iterator<char>(file),
+                               std::istreambuf_iterator<char>()};
+        CHECK_EQUAL("01234XY789abcdefghij"s, data);
+    }
+    boost::filesystem::remove(path);
+} ENDCASE
+
 }; //lest
 
 int main( int argc, char * argv[] )
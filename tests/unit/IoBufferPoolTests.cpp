@@ -0,0 +1,86 @@
+
+// Include before boost::log headers
+#include "restc-cpp/logging.h"
+
+#include "restc-cpp/restc-cpp.h"
+#include "restc-cpp/IoBufferPool.h"
+
+#include "restc-cpp/test_helper.h"
+#include "lest/lest.hpp"
+
+using namespace std;
+using namespace restc_cpp;
+
+const lest::test specification[] = {
+
+STARTCASE(TestSizesAreRoundedAndCapped)
+{
+    Request::Properties properties;
+    properties.ioBufferMaxSize = RESTC_CPP_IO_BUFFER_SIZE * 4;
+    auto pool = IoBufferPool::Create(properties);
+
+    CHECK_EQUAL(RESTC_CPP_IO_BUFFER_SIZE, pool->Get(1)->size());
+    CHECK_EQUAL(RESTC_CPP_IO_BUFFER_SIZE * 2,
+                pool->Get(RESTC_CPP_IO_BUFFER_SIZE + 1)->size());
+    CHECK_EQUAL(RESTC_CPP_IO_BUFFER_SIZE * 4,
+                pool->Get(RESTC_CPP_IO_BUFFER_SIZE * 100)->size());
+} ENDCASE
+
+STARTCASE(TestBuffersAreReused)
+{
+    Request::Properties properties;
+    auto pool = IoBufferPool::Create(properties);
+
+    const char *data = nullptr;
+    {
+        auto buffer = pool->Get(RESTC_CPP_IO_BUFFER_SIZE);
+        data = buffer->data();
+        CHECK_EQUAL(0, pool->GetIdleBytes());
+    }
+
+    CHECK_EQUAL(RESTC_CPP_IO_BUFFER_SIZE, pool->GetIdleBytes());
+    auto buffer = pool->Get(RESTC_CPP_IO_BUFFER_SIZE);
+    CHECK_EQUAL(data, buffer->data());
+    CHECK_EQUAL(0, pool->GetIdleBytes());
+} ENDCASE
+
+STARTCASE(TestIdleBytesAreCapped)
+{
+    Request::Properties properties;
+    properties.ioBufferPoolMaxIdleBytes = RESTC_CPP_IO_BUFFER_SIZE;
+    auto pool = IoBufferPool::Create(properties);
+
+    {
+        auto a = pool->Get(RESTC_CPP_IO_BUFFER_SIZE);
+        auto b = pool->Get(RESTC_CPP_IO_BUFFER_SIZE);
+    }
+
+    CHECK_EQUAL(RESTC_CPP_IO_BUFFER_SIZE, pool->GetIdleBytes());
+} ENDCASE
+
+STARTCASE(TestBufferOutlivesPool)
+{
+    Request::Properties properties;
+    auto pool = IoBufferPool::Create(properties);
+    auto buffer = pool->Get(1);
+    pool.reset();
+
+    // The buffer is still ours to use
+    CHECK_EQUAL(RESTC_CPP_IO_BUFFER_SIZE, buffer->size());
+    fill(buffer->begin(), buffer->end(), 'x');
+    CHECK_EQUAL(string(RESTC_CPP_IO_BUFFER_SIZE, 'x'),
+                string(buffer->begin(), buffer->end()));
+
+    // Releasing it must not touch the pool
+    buffer.reset();
+    CHECK_EQUAL(true, buffer == nullptr);
+} ENDCASE
+
+
+}; // lest
+
+
+int main( int argc, char * argv[] )
+{
+    return lest::run( specification, argc, argv );
+}
@@ -7,8 +7,13 @@
 #include <boost/log/expressions.hpp>
 #include <boost/fusion/adapted.hpp>
 
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
 #include "restc-cpp/restc-cpp.h"
 #include "restc-cpp/SerializeJson.h"
+#include "restc-cpp/IteratorFromJsonSerializer.h"
 #include "rapidjson/writer.h"
 #include "rapidjson/stringbuffer.h"
 
@@ -20,6 +25,32 @@ using namespace std;
 using namespace restc_cpp;
 using namespace rapidjson;
 
+namespace {
+
+// Heap allocations made while counting_allocations is set
+std::atomic<bool> counting_allocations{false};
+std::atomic<std::size_t> allocations{0};
+
+} // anonymous namespace
+
+void *operator new(std::size_t size) {
+    if (counting_allocations) {
+        ++allocations;
+    }
+    if (void *ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
 struct Person {
 
     Person(int id_, std::string name_, double balance_)
@@ -91,6 +122,170 @@ BOOST_FUSION_ADAPT_STRUCT(
     (std::deque<Person>, even_more_members)
 )
 
+struct Wide {
+    int a0 = 0; int a1 = 0; int a2 = 0; int a3 = 0; int a4 = 0;
+    std::string s0; std::string s1; std::string s2; std::string s3;
+    double d0 = 0; double d1 = 0; bool b0 = false; bool b1 = false;
+    Person p0; Person p1;
+    std::vector<int> v0;
+};
+
+BOOST_FUSION_ADAPT_STRUCT(
+    Wide,
+    (int, a0) (int, a1) (int, a2) (int, a3) (int, a4)
+    (std::string, s0) (std::string, s1) (std::string, s2) (std::string, s3)
+    (double, d0) (double, d1) (bool, b0) (bool, b1)
+    (Person, p0) (Person, p1)
+    (std::vector<int>, v0)
+)
+
+// Hands out the body in small pieces, like data arriving from the network
+class ChunkedReply : public BasicReply {
+public:
+    ChunkedReply(std::string body, size_t chunkSize)
+    : body_{std::move(body)}, chunk_size_{chunkSize}
+    {}
+
+    boost::uuids::uuid GetConnectionId() const override { return {}; }
+    int GetResponseCode() const override { return 200; }
+    const HttpResponse& GetHttpResponse() const override { return response_; }
+
+    std::string GetBodyAsString(size_t) override {
+        const auto pos = pos_;
+        pos_ = body_.size();
+        return body_.substr(pos);
+    }
+
+    boost::asio::const_buffers_1 GetSomeData() override {
+        const auto len = std::min(chunk_size_, body_.size() - pos_);
+        const auto data = body_.data() + pos_;
+        pos_ += len;
+        return {data, len};
+    }
+
+    bool MoreDataToRead() override { return pos_ < body_.size(); }
+
+    using BasicReply::GetBodyInto;
+
+    void GetBodyInto(std::string& buffer, size_t maxSize
+        = RESTC_CPP_SANE_DATA_LIMIT) override {
+        read_whole_ = true;
+        BasicReply::GetBodyInto(buffer, maxSize);
+    }
+
+    boost::optional<std::string> GetHeader(const std::string& name) override {
+        const auto it = headers_.find(name);
+        if (it != headers_.end()) {
+            return it->second;
+        }
+        return {};
+    }
+
+    std::deque<std::string> GetHeaders(const std::string&) override { return {}; }
+
+    void SetHeader(const std::string& name, const std::string& value) {
+        headers_[name] = value;
+    }
+
+    // Tells if the body was read with GetBodyInto(), as the simdjson parser does
+    bool WasReadWhole() const noexcept { return read_whole_; }
+
+private:
+    const std::string body_;
+    std::map<std::string, std::string> headers_;
+    const size_t chunk_size_;
+    size_t pos_ = 0;
+    bool read_whole_ = false;
+    HttpResponse response_;
+};
+
+// Collects what is written, and how many writes there were
+class StringDataWriter : public DataWriter {
+public:
+    void Write(boost::asio::const_buffers_1 buffers) override {
+        data_.append(boost::asio::buffer_cast<const char *>(buffers),
+                     boost::asio::buffer_size(buffers));
+        ++writes_;
+    }
+
+    void WriteDirect(boost::asio::const_buffers_1 buffers) override {
+        Write(buffers);
+    }
+
+    void WriteDirect(boost::asio::const_buffers_1, const write_buffers_t&) override {
+        throw std::logic_error("Not implemented");
+    }
+
+    void Write(const write_buffers_t&) override {
+        throw std::logic_error("Not implemented");
+    }
+
+    void Finish() override {}
+    void SetHeaders(Request::headers_t&) override {}
+
+    const std::string& GetData() const noexcept { return data_; }
+    int GetWrites() const noexcept { return writes_; }
+
+private:
+    std::string data_;
+    int writes_ = 0;
+};
+
+// A context without an event loop. Sleep() blocks the thread.
+class ThreadContext : public Context {
+public:
+    boost::asio::yield_context& GetYield() override { throw std::logic_error("Not implemented"); }
+    RestClient& GetClient() override { throw std::logic_error("Not implemented"); }
+    std::unique_ptr<Reply> Get(std::string) override { throw std::logic_error("Not implemented"); }
+    std::unique_ptr<Reply> Post(std::string, std::string) override { throw std::logic_error("Not implemented"); }
+    std::unique_ptr<Reply> Put(std::string, std::string) override { throw std::logic_error("Not implemented"); }
+    std::unique_ptr<Reply> Delete(std::string) override { throw std::logic_error("Not implemented"); }
+    std::unique_ptr<Reply> Options(std::string) override { throw std::logic_error("Not implemented"); }
+    std::unique_ptr<Reply> Head(std::string) override { throw std::logic_error("Not implemented"); }
+    std::unique_ptr<Reply> Patch(std::string) override { throw std::logic_error("Not implemented"); }
+    std::unique_ptr<Reply> Request(restc_cpp::Request&) override { throw std::logic_error("Not implemented"); }
+
+    void Sleep(const boost::posix_time::microseconds& ms) override {
+        std::this_thread::sleep_for(std::chrono::microseconds(ms.total_microseconds()));
+    }
+};
+
+#ifdef RESTC_CPP_HAVE_PMR
+using pmr_attributes_t = std::pmr::map<std::pmr::string, std::pmr::string>;
+
+struct PmrGroup {
+    std::pmr::string name;
+    std::pmr::vector<Person> members;
+    std::pmr::vector<std::pmr::string> tags;
+    pmr_attributes_t attributes;
+};
+
+BOOST_FUSION_ADAPT_STRUCT(
+    PmrGroup,
+    (std::pmr::string, name)
+    (std::pmr::vector<Person>, members)
+    (std::pmr::vector<std::pmr::string>, tags)
+    (pmr_attributes_t, attributes)
+)
+
+// Sets the default memory resource, and restores it when it goes out of scope
+class DefaultResourceGuard {
+public:
+    DefaultResourceGuard(std::pmr::memory_resource *resource)
+    : prev_{std::pmr::set_default_resource(resource)} {}
+
+    ~DefaultResourceGuard() {
+        std::pmr::set_default_resource(prev_);
+    }
+
+    DefaultResourceGuard(const DefaultResourceGuard&) = delete;
+    DefaultResourceGuard& operator = (const DefaultResourceGuard&) = delete;
+
+private:
+    std::pmr::memory_resource *const prev_;
+};
+#endif
+
 const lest::test specification[] = {
 
 STARTCASE(SerializeSimpleObject) {
@@ -176,6 +371,66 @@ STARTCASE(SerializeNestedVector)
 
 } ENDCASE
 
+STARTCASE(SerializeWithMappedAndExcludedNames) {
+    const Group group = Group(string("Group name"), 99, Person( 100, string("John Doe"), 123.45 ));
+
+    JsonFieldMapping mapping;
+    mapping.entries.emplace_back("name", "the \"name\"");
+    mapping.entries.emplace_back("id", "\xc3\xa6id");
+    const excluded_names_t excluded{"balance", "gid"};
+    const auto expected = R"({"the \"name\"":"Group name","leader":{")" "\xc3\xa6"
+        R"(id":100,"the \"name\"":"John Doe"}})"s;
+
+    {
+        StringBuffer s;
+        Writer<StringBuffer> writer(s);
+        RapidJsonSerializer<decltype(group), decltype(writer)>
+            serializer(group, writer);
+        serializer.SetNameMapping(&mapping);
+        serializer.ExcludeNames(const_cast<excluded_names_t *>(&excluded));
+        serializer.Serialize();
+        CHECK_EQUAL(expected, s.GetString());
+    }
+
+    serialize_properties_t properties;
+    properties.name_mapping = &mapping;
+    properties.excluded_names = &excluded;
+    {
+        std::ostringstream out;
+        SerializeToJson(group, out, properties);
+        CHECK_EQUAL(expected, out.str());
+    }
+
+    // The keys are re-used for each object
+    {
+        StringDataWriter writer;
+        {
+            RapidJsonInserter<Group> inserter(writer, true, properties);
+            inserter.Add(group);
+            inserter.Add(group);
+        }
+        CHECK_EQUAL("[" + expected + "," + expected + "]", writer.GetData());
+    }
+
+    // Handlers that can't write raw json get the names
+    class NoRawValueWriter : public Writer<StringBuffer> {
+    public:
+        using Writer<StringBuffer>::Writer;
+        void RawValue() = delete;
+    };
+
+    {
+        StringBuffer s;
+        NoRawValueWriter writer(s);
+        RapidJsonSerializer<decltype(group), decltype(writer)>
+            serializer(group, writer);
+        serializer.SetNameMapping(&mapping);
+        serializer.ExcludeNames(const_cast<excluded_names_t *>(&excluded));
+        serializer.Serialize();
+        CHECK_EQUAL(expected, s.GetString());
+    }
+} ENDCASE
+
 STARTCASE(DeserializeSimpleObject) {
     Person person;
     std::string json = R"({ "id" : 100, "name" : "John Longdue Doe", "balance" : 123.45 })";
@@ -402,6 +657,694 @@ STARTCASE(MissingPropertyNameNotAllowed) {
 } ENDCASE
 
 
+STARTCASE(FieldIndexFindsAllMembers) {
+    const auto& index = detail::FieldIndex<Wide>::Get();
+    CHECK_EQUAL(16, static_cast<int>(detail::FieldIndex<Wide>::size));
+    CHECK_EQUAL(0, index.Find("a0"s));
+    CHECK_EQUAL(4, index.Find("a4"s));
+    CHECK_EQUAL(8, index.Find("s3"s));
+    CHECK_EQUAL(15, index.Find("v0"s));
+    CHECK_EQUAL(-1, index.Find("a"s));
+    CHECK_EQUAL(-1, index.Find("a00"s));
+    CHECK_EQUAL(-1, index.Find(""s));
+} ENDCASE
+
+STARTCASE(DeserializeWideObjectWithNameMapping) {
+    Wide wide;
+    std::string json =
+        R"({"v0":[1,2],"p1":{"id":2,"name":"p1","balance":2.5},"b1":true,)"
+        R"("d1":1.5,"S_ZERO":"zero","s3":"three","a4":4,"a0":10,"unknown":1,)"
+        R"("p0":{"id":1,"name":"p0","balance":1.5},"s1":"one","a2":2})";
+
+    JsonFieldMapping mapping;
+    mapping.entries.emplace_back("s0", "S_ZERO");
+
+    serialize_properties_t sprop;
+    sprop.name_mapping = &mapping;
+    RapidJsonDeserializer<Wide> handler(wide, sprop);
+    Reader reader;
+    StringStream ss(json.c_str());
+    reader.Parse(ss, handler);
+
+    CHECK_EQUAL(10, wide.a0);
+    CHECK_EQUAL(2, wide.a2);
+    CHECK_EQUAL(4, wide.a4);
+    CHECK_EQUAL("zero"s, wide.s0);
+    CHECK_EQUAL("one"s, wide.s1);
+    CHECK_EQUAL("three"s, wide.s3);
+    CHECK_EQUAL(1.5, wide.d1);
+    CHECK_EQUAL(true, wide.b1);
+    CHECK_EQUAL(1, wide.p0.id);
+    CHECK_EQUAL("p1"s, wide.p1.name);
+    CHECK_EQUAL(2, static_cast<int>(wide.v0.size()));
+
+    // The mapped member is only found by its json name. The member
+    // lookup tables are kept in the cache for the next document.
+    use_json_key_cache(sprop);
+    Wide second;
+    RapidJsonDeserializer<Wide> second_handler(second, sprop);
+    StringStream second_ss(R"({"S_ZERO":"mapped","a0":1,"s0":"native"})");
+    reader.Parse(second_ss, second_handler);
+    CHECK_EQUAL(1, second.a0);
+    CHECK_EQUAL("mapped"s, second.s0);
+} ENDCASE
+
+STARTCASE(JsonArenaReusesMemoryForSiblings) {
+    detail::JsonArena arena{256};
+
+    const void *first = nullptr;
+    {
+        auto parent = arena.Create<Person>(1, "parent", 1.0);
+        auto child = arena.Create<Person>(2, "child", 2.0);
+        first = child.get();
+        CHECK_EQUAL(true, static_cast<const void *>(parent.get()) != first);
+    }
+
+    auto parent = arena.Create<Person>(1, "parent", 1.0);
+    for(int i = 0; i < 1000; ++i) {
+        auto child = arena.Create<Person>(i, "child", 0.0);
+        CHECK_EQUAL(first, static_cast<const void *>(child.get()));
+
+        // Larger than a block
+        const auto mark = arena.GetMark();
+        CHECK_EQUAL(true, arena.Allocate(300, 8) != nullptr);
+        arena.Rewind(mark);
+    }
+    CHECK_EQUAL(true, arena.GetCapacity() <= 1024);
+} ENDCASE
+
+STARTCASE(DeserializeReusingExistingValues) {
+    std::vector<Person> persons;
+    serialize_properties_t sprop;
+
+    auto parse = [&](const std::string& json) {
+        RapidJsonDeserializer<decltype(persons)> handler(persons, sprop);
+        Reader reader;
+        StringStream ss(json.c_str());
+        reader.Parse(ss, handler);
+    };
+
+    const std::string first =
+        R"([{"id":1,"name":"A name that is too long for small strings","balance":1.5},)"
+        R"({"id":2,"name":"two","balance":2.5},{"id":3,"name":"three"}])";
+    const std::string second =
+        R"([{"id":4,"name":"Another name that is long enough"},)"
+        R"({"id":5,"name":"five","balance":5.5}])";
+
+    // By default, we append
+    parse(first);
+    parse(second);
+    CHECK_EQUAL(5, static_cast<int>(persons.size()));
+
+    sprop.reuse_existing_values = true;
+    parse(first);
+    CHECK_EQUAL(3, static_cast<int>(persons.size()));
+    const auto *items = persons.data();
+    const auto *name = persons[0].name.data();
+
+    parse(second);
+    CHECK_EQUAL(2, static_cast<int>(persons.size()));
+    CHECK_EQUAL(true, items == persons.data());
+    CHECK_EQUAL(true, name == persons[0].name.data());
+    CHECK_EQUAL(4, persons[0].id);
+    CHECK_EQUAL("Another name that is long enough"s, persons[0].name);
+    CHECK_EQUAL(0.0, persons[0].balance); // Not in the json
+    CHECK_EQUAL(5, persons[1].id);
+    CHECK_EQUAL("five"s, persons[1].name);
+    CHECK_EQUAL(5.5, persons[1].balance);
+
+    std::list<std::vector<int>> nested = {{1, 2, 3}, {4}, {5}};
+    const auto *inner = nested.front().data();
+    RapidJsonDeserializer<decltype(nested)> handler(nested, sprop);
+    Reader reader;
+    std::string json = R"([[7,8],[9,10]])";
+    StringStream ss(json.c_str());
+    reader.Parse(ss, handler);
+    CHECK_EQUAL(2, static_cast<int>(nested.size()));
+    CHECK_EQUAL(true, inner == nested.front().data());
+    CHECK_EQUAL(2, static_cast<int>(nested.front().size()));
+    CHECK_EQUAL(8, nested.front().back());
+    CHECK_EQUAL(10, nested.back().back());
+} ENDCASE
+
+// A poll with a re-used context and re-used values does not allocate
+STARTCASE(DeserializeReplyReusingContext) {
+    const std::string json =
+        R"([{"id":1,"name":"A name that is too long for small strings","balance":1.5},)"
+        R"({"id":2,"name":"two","balance":2.5}])";
+
+    std::vector<Person> persons;
+    serialize_properties_t sprop;
+    sprop.reuse_existing_values = true;
+#ifdef RESTC_CPP_WITH_SIMDJSON
+    sprop.simdjson_max_body_size = 0;
+#endif
+    JsonDeserializerContext context;
+
+    {
+        ChunkedReply reply(json, 7);
+        SerializeFromJson(persons, reply, sprop, context);
+    }
+
+    ChunkedReply reply(json, 7);
+    boost::log::core::get()->set_logging_enabled(false);
+    allocations = 0;
+    counting_allocations = true;
+    SerializeFromJson(persons, reply, sprop, context);
+    counting_allocations = false;
+    boost::log::core::get()->set_logging_enabled(true);
+
+    CHECK_EQUAL(0, static_cast<int>(allocations));
+    CHECK_EQUAL(2, static_cast<int>(persons.size()));
+    CHECK_EQUAL("A name that is too long for small strings"s, persons[0].name);
+    CHECK_EQUAL(2.5, persons[1].balance);
+} ENDCASE
+
+STARTCASE(DeserializeFromReplyInSmallBlocks) {
+    const std::string json =
+        R"({"name" : "A name that does not fit in one block, with \"escapes\" and \u00e6", )"
+        R"("gid" : 1234567, "leader" : { "id" : 100, "name" : "ends with a backslash\\", "balance" : 123.45 },)"
+        R"("members" : [{ "id" : 101, "name" : "", "balance" : -1e3},   {"id":102,"name":"\\\"","balance":0.5}])"
+        "\r\n\t }  ";
+
+    for(const size_t chunkSize : {1, 3, 7, 4096}) {
+        for(const size_t blockSize : {1, 4, 16, 4096}) {
+            ChunkedReply reply(json, chunkSize);
+            RapidJsonReader stream(reply, blockSize);
+            Group group;
+            RapidJsonDeserializer<Group> handler(group);
+            Reader reader;
+            reader.Parse<kParseInsituFlag>(stream, handler);
+
+            CHECK_EQUAL("A name that does not fit in one block, with \"escapes\" and \xc3\xa6"s, group.name);
+            CHECK_EQUAL(1234567, group.gid);
+            CHECK_EQUAL(100, group.leader.id);
+            CHECK_EQUAL("ends with a backslash\\"s, group.leader.name);
+            CHECK_EQUAL(123.45, group.leader.balance);
+            CHECK_EQUAL(2, static_cast<int>(group.members.size()));
+            CHECK_EQUAL(""s, group.members[0].name);
+            CHECK_EQUAL(-1000.0, group.members[0].balance);
+            CHECK_EQUAL("\\\""s, group.members[1].name);
+            CHECK_EQUAL(0.5, group.members[1].balance);
+            CHECK_EQUAL(json.size(), stream.Tell());
+            CHECK_EQUAL(true, stream.IsEof());
+        }
+    }
+
+    Group group;
+    ChunkedReply reply(json, 5);
+    SerializeFromJson(group, reply);
+    CHECK_EQUAL(102, group.members[1].id);
+} ENDCASE
+
+STARTCASE(SplitJsonArrayFindsElements) {
+    const std::string json = R"( [ {"a" : [1, "]", {"b" : "}"}]} ,2,"th\"r,e[e"  , [] , {}, null
+] )";
+    const auto elements = detail::SplitJsonArray(json.data(), json.size());
+    CHECK_EQUAL(6, static_cast<int>(elements.size()));
+    CHECK_EQUAL(R"({"a" : [1, "]", {"b" : "}"}]})"s,
+                json.substr(elements[0].begin, elements[0].end - elements[0].begin));
+    CHECK_EQUAL("2"s, json.substr(elements[1].begin, elements[1].end - elements[1].begin));
+    CHECK_EQUAL(R"("th\"r,e[e")"s, json.substr(elements[2].begin, elements[2].end - elements[2].begin));
+    CHECK_EQUAL("[]"s, json.substr(elements[3].begin, elements[3].end - elements[3].begin));
+    CHECK_EQUAL("null"s, json.substr(elements[5].begin, elements[5].end - elements[5].begin));
+
+    CHECK_EQUAL(0, static_cast<int>(detail::SplitJsonArray("[ ]", 3).size()));
+
+    for(const std::string bad : {"", "{}", "[1,]", "[,1]", "[1", "[\"]", "[1]]", "[{]", "[1] x"}) {
+        EXPECT_THROWS_AS(detail::SplitJsonArray(bad.data(), bad.size()), ParseException);
+    }
+} ENDCASE
+
+STARTCASE(DeserializeArrayInParallel) {
+    std::string json = "[";
+    for(int i = 0; i < 1000; ++i) {
+        if (i) {
+            json += ",\n";
+        }
+        json += R"({"id" : )" + std::to_string(i)
+            + R"(, "name" : "name, [\"quoted\"] {)" + std::to_string(i)
+            + R"(}", "balance" : )" + std::to_string(i) + ".5}";
+    }
+    json += "]";
+
+    std::vector<Person> expected;
+    ChunkedReply serial_reply(json, 4096);
+    SerializeFromJson(expected, serial_reply);
+
+    serialize_properties_t properties;
+    properties.parallel_threads = 4;
+    std::deque<Person> existing{{-1, "existing", 0}};
+    auto buffer = json;
+    SerializeFromJsonInParallel(existing, buffer, properties);
+    CHECK_EQUAL(1001, static_cast<int>(existing.size()));
+    CHECK_EQUAL(-1, existing.front().id);
+
+    std::vector<Person> persons;
+    ChunkedReply reply(json, 4096);
+    reply.SetHeader("Content-Length", std::to_string(json.size()));
+    SerializeFromJson(persons, reply, properties);
+    CHECK_EQUAL(expected.size(), persons.size());
+    for(size_t i = 0; i < expected.size(); ++i) {
+        CHECK_EQUAL(expected[i].id, persons[i].id);
+        CHECK_EQUAL(expected[i].name, persons[i].name);
+        CHECK_EQUAL(expected[i].balance, persons[i].balance);
+        CHECK_EQUAL(expected[i].name, existing[i + 1].name);
+    }
+    CHECK_EQUAL("name, [\"quoted\"] {999}"s, persons.back().name);
+
+    // Too large, or of unknown size. Deserialized while it is read.
+    properties.parallel_max_body_size = json.size() / 2;
+    for(const bool knownSize : {true, false}) {
+        std::vector<Person> streamed;
+        ChunkedReply large_reply(json, 4096);
+        if (knownSize) {
+            large_reply.SetHeader("Content-Length", std::to_string(json.size()));
+        }
+        SerializeFromJson(streamed, large_reply, properties);
+        CHECK_EQUAL(expected.size(), streamed.size());
+        CHECK_EQUAL("name, [\"quoted\"] {999}"s, streamed.back().name);
+    }
+
+    std::vector<int> numbers;
+    std::string numbers_json = "[1, 2, 3,4,5 ]";
+    SerializeFromJsonInParallel(numbers, numbers_json, properties);
+    CHECK_EQUAL(5, static_cast<int>(numbers.size()));
+    CHECK_EQUAL(5, numbers.back());
+
+    std::vector<Person> ignore;
+    std::string bad_json = R"([{"id" : 1}, {"id" : }])";
+    EXPECT_THROWS_AS(SerializeFromJsonInParallel(ignore, bad_json, properties), ParseException);
+
+    // The memory constraint is for all the threads together
+    properties.SetMaxMemoryConsumption(20000);
+    buffer = json;
+    EXPECT_THROWS_AS(SerializeFromJsonInParallel(ignore, buffer, properties), ConstraintException);
+} ENDCASE
+
+STARTCASE(DeserializePipelined) {
+    std::string json = "[";
+    for(int i = 0; i < 1000; ++i) {
+        if (i) {
+            json += ", ";
+        }
+        json += R"({"id" : )" + std::to_string(i)
+            + R"(, "name" : "A name with \"escapes\" )" + std::to_string(i)
+            + R"(", "balance" : )" + std::to_string(i) + ".25}";
+    }
+    json += "]";
+
+    ThreadContext ctx;
+    serialize_properties_t properties;
+    for(const unsigned buffers : {1, 2, 3}) {
+        for(const size_t bufferSize : {7, 4096}) {
+            properties.pipeline_buffers = buffers;
+            properties.pipeline_buffer_size = bufferSize;
+
+            std::vector<Person> persons;
+            ChunkedReply reply(json, 1000);
+            SerializeFromJsonPipelined(persons, reply, ctx, properties);
+            CHECK_EQUAL(1000, static_cast<int>(persons.size()));
+            CHECK_EQUAL(999, persons.back().id);
+            CHECK_EQUAL("A name with \"escapes\" 999"s, persons.back().name);
+            CHECK_EQUAL(999.25, persons.back().balance);
+        }
+    }
+
+    // Errors in the parser are re-thrown in the caller
+    properties.SetMaxMemoryConsumption(1000);
+    std::vector<Person> ignore;
+    ChunkedReply reply(json, 1000);
+    EXPECT_THROWS_AS(SerializeFromJsonPipelined(ignore, reply, ctx, properties), ConstraintException);
+
+    // So are errors when reading
+    class FailingReply : public ChunkedReply {
+    public:
+        using ChunkedReply::ChunkedReply;
+
+        std::size_t ReadInto(boost::asio::mutable_buffers_1 buffer) override {
+            if (++reads_ > 3) {
+                throw IoException("Connection lost");
+            }
+            return ChunkedReply::ReadInto(buffer);
+        }
+
+    private:
+        int reads_ = 0;
+    };
+
+    properties.SetMaxMemoryConsumption(serialize_properties_t::GetDefaultMaxMemoryConsumption());
+    FailingReply failing_reply(json, 100);
+    EXPECT_THROWS_AS(SerializeFromJsonPipelined(ignore, failing_reply, ctx, properties), IoException);
+} ENDCASE
+
+STARTCASE(DeserializeInBatches) {
+    std::string json = "[";
+    for(int i = 0; i < 1000; ++i) {
+        if (i) {
+            json += ", ";
+        }
+        json += R"({"id" : )" + std::to_string(i)
+            + R"(, "name" : "A name with \"escapes\" )" + std::to_string(i)
+            + R"(", "balance" : )" + std::to_string(i) + ".25}";
+    }
+    json += "]";
+
+    ThreadContext ctx;
+    serialize_properties_t properties;
+    properties.pipeline_buffer_size = 100;
+
+    for(const bool worker : {false, true}) {
+        for(const size_t batchSize : {1, 7, 1000, 2000}) {
+            ChunkedReply reply(json, 33);
+            std::unique_ptr<BatchedIteratorFromJsonSerializer<Person>> batches;
+            if (worker) {
+                batches = std::make_unique<BatchedIteratorFromJsonSerializer<Person>>(
+                    reply, ctx, batchSize, &properties);
+            } else {
+                batches = std::make_unique<BatchedIteratorFromJsonSerializer<Person>>(
+                    reply, batchSize, &properties);
+            }
+
+            int id = 0;
+            for(auto batch = batches->NextBatch(); !batch.empty(); batch = batches->NextBatch()) {
+                CHECK_EQUAL(std::min<size_t>(batchSize, 1000 - id), batch.size());
+                for(const auto& person : batch) {
+                    CHECK_EQUAL(id, person.id);
+                    CHECK_EQUAL("A name with \"escapes\" "s + std::to_string(id), person.name);
+                    ++id;
+                }
+            }
+            CHECK_EQUAL(1000, id);
+            EXPECT(batches->NextBatch().empty());
+        }
+    }
+
+    // The objects are re-used between batches
+    {
+        ChunkedReply reply(json, 33);
+        BatchedIteratorFromJsonSerializer<Person> batches(reply, 10);
+        const auto first = batches.NextBatch();
+        const auto *data = first.data();
+        const auto *name = first[0].name.data();
+        const auto second = batches.NextBatch();
+        CHECK_EQUAL(data, second.data());
+        CHECK_EQUAL(name, second[0].name.data());
+        CHECK_EQUAL(10, second[0].id);
+    }
+
+    // An empty array
+    {
+        ChunkedReply reply(" [ ] ", 33);
+        BatchedIteratorFromJsonSerializer<Person> batches(reply, ctx);
+        EXPECT(batches.NextBatch().empty());
+    }
+
+    // Errors are thrown from NextBatch()
+    for(const bool worker : {false, true}) {
+        ChunkedReply reply(R"([{"id" : 1}, {"id" : 2} {"id" : 3}])", 33);
+        std::unique_ptr<BatchedIteratorFromJsonSerializer<Person>> batches;
+        if (worker) {
+            batches = std::make_unique<BatchedIteratorFromJsonSerializer<Person>>(reply, ctx, 1);
+        } else {
+            batches = std::make_unique<BatchedIteratorFromJsonSerializer<Person>>(reply, 1);
+        }
+        CHECK_EQUAL(1, batches->NextBatch()[0].id);
+        EXPECT_THROWS_AS(batches->NextBatch(), ParseException);
+        EXPECT(batches->NextBatch().empty());
+    }
+
+    // The worker is stopped if we give up before the end
+    {
+        ChunkedReply reply(json, 33);
+        BatchedIteratorFromJsonSerializer<Person> batches(reply, ctx, 10, &properties);
+        CHECK_EQUAL(0, batches.NextBatch()[0].id);
+    }
+} ENDCASE
+
+STARTCASE(DeserializeNdjson) {
+    std::string ndjson;
+    for(int i = 0; i < 1000; ++i) {
+        ndjson += R"({"id" : )" + std::to_string(i)
+            + R"(, "name" : "A name with \"escapes\" )" + std::to_string(i)
+            + R"(", "balance" : )" + std::to_string(i) + ".25}";
+        // Windows line endings and empty lines are allowed
+        ndjson += (i % 10) ? "\n" : "\r\n\n";
+    }
+
+    for(const size_t chunkSize : {1, 33, 100000}) {
+        ChunkedReply reply(ndjson, chunkSize);
+        int id = 0;
+        for(const auto& person : IteratorFromNdjsonSerializer<Person>(reply)) {
+            CHECK_EQUAL(id, person.id);
+            CHECK_EQUAL("A name with \"escapes\" "s + std::to_string(id), person.name);
+            CHECK_EQUAL(id + 0.25, person.balance);
+            ++id;
+        }
+        CHECK_EQUAL(1000, id);
+    }
+
+    // The last line does not need a newline, and members not on a line are reset
+    {
+        ChunkedReply reply(R"({"id" : 1, "name" : "one"})" "\n" R"({"id" : 2})", 5);
+        IteratorFromNdjsonSerializer<Person> persons(reply);
+        auto it = persons.begin();
+        CHECK_EQUAL("one"s, it->name);
+        ++it;
+        CHECK_EQUAL(2, it->id);
+        CHECK_EQUAL(""s, it->name);
+        ++it;
+        EXPECT(it == persons.end());
+        EXPECT_THROWS_AS(++it, CannotIncrementEndException);
+    }
+
+    // Errors
+    {
+        ChunkedReply reply("{\"id\" : 1}\n{\"id\" : 2} {\"id\" : 3}\n", 33);
+        IteratorFromNdjsonSerializer<Person> persons(reply);
+        auto it = persons.begin();
+        CHECK_EQUAL(1, it->id);
+        EXPECT_THROWS_AS(++it, ParseException);
+    }
+    {
+        serialize_properties_t properties;
+        properties.SetMaxMemoryConsumption(100);
+        ChunkedReply reply(R"({"id" : 1, "name" : ")" + std::string(200, 'x') + "\"}\n", 33);
+        IteratorFromNdjsonSerializer<Person> persons(reply, &properties);
+        EXPECT_THROWS_AS(persons.begin(), ConstraintException);
+    }
+
+    // 0 means no limit
+    {
+        serialize_properties_t properties;
+        properties.SetMaxMemoryConsumption(0);
+        ChunkedReply reply(R"({"id" : 1, "name" : "one"})" "\n" R"({"id" : 2})" "\n", 3);
+        IteratorFromNdjsonSerializer<Person> persons(reply, &properties);
+        auto it = persons.begin();
+        CHECK_EQUAL("one"s, it->name);
+        ++it;
+        CHECK_EQUAL(2, it->id);
+        ++it;
+        EXPECT(it == persons.end());
+    }
+} ENDCASE
+
+STARTCASE(SerializeNdjson) {
+    StringDataWriter writer;
+    {
+        RapidJsonInserter<Person> inserter(writer, RapidJsonInserter<Person>::Format::NDJSON);
+        for(int i = 1; i <= 3; ++i) {
+            inserter.Add(Person{i, "Person " + std::to_string(i), i + 0.5});
+        }
+    }
+    CHECK_EQUAL(R"({"id":1,"name":"Person 1","balance":1.5})" "\n"
+                R"({"id":2,"name":"Person 2","balance":2.5})" "\n"
+                R"({"id":3,"name":"Person 3","balance":3.5})" "\n"s, writer.GetData());
+
+    // The lines are written together
+    CHECK_EQUAL(1, writer.GetWrites());
+
+    // and read back
+    ChunkedReply reply(writer.GetData(), 7);
+    int id = 0;
+    for(const auto& person : IteratorFromNdjsonSerializer<Person>(reply)) {
+        CHECK_EQUAL(++id, person.id);
+    }
+    CHECK_EQUAL(3, id);
+} ENDCASE
+
+#ifdef RESTC_CPP_WITH_SIMDJSON
+STARTCASE(DeserializeWithSimdJson) {
+    std::string json =
+        R"({"name" : "q\"zar\u00e6", "gid" : -2147483649, "leader" : { "id" : 100, "name" : "Dolly Doe", "balance" : 123.45 },)"
+        R"("members" : [{ "id" : 101, "name" : "m1", "balance" : -1e3}, { "id" : 4294967295, "name" : "m2", "balance" : 1}],)"
+        R"("unknown" : {"a" : [1, null, true, {"b" : "c"}]},)"
+        R"("even_more_members" : [{ "id" : -1, "name" : "m10", "balance" : 0.1}])"
+        R"(})";
+
+    Group expected;
+    {
+        RapidJsonDeserializer<Group> handler(expected);
+        Reader reader;
+        StringStream ss(json.c_str());
+        reader.Parse(ss, handler);
+    }
+
+    Group group;
+    RapidJsonDeserializer<Group> handler(group);
+    SimdJsonParser::Get().Parse(json, handler);
+
+    CHECK_EQUAL(expected.name, group.name);
+    CHECK_EQUAL("q\"zar\xc3\xa6"s, group.name);
+    CHECK_EQUAL(expected.gid, group.gid);
+    CHECK_EQUAL(100, group.leader.id);
+    CHECK_EQUAL(123.45, group.leader.balance);
+    CHECK_EQUAL(2, static_cast<int>(group.members.size()));
+    CHECK_EQUAL(-1000.0, group.members[0].balance);
+    CHECK_EQUAL(expected.members[1].id, group.members[1].id);
+    CHECK_EQUAL(1.0, group.members[1].balance);
+    CHECK_EQUAL(-1, group.even_more_members.front().id);
+
+    std::string bad = R"({"name" : "x", "gid" : })";
+    Group ignore;
+    RapidJsonDeserializer<Group> bad_handler(ignore);
+    EXPECT_THROWS_AS(SimdJsonParser::Get().Parse(bad, bad_handler), ParseException);
+} ENDCASE
+
+STARTCASE(DeserializeScalarWithSimdJson) {
+    // Writes the events it gets from the parser
+    struct Recorder {
+        void Null() { events += "null "; }
+        void Bool(bool v) { events += v ? "true " : "false "; }
+        void Int(int v) { events += "int:" + std::to_string(v) + " "; }
+        void Uint(unsigned v) { events += "uint:" + std::to_string(v) + " "; }
+        void Int64(std::int64_t v) { events += "int64:" + std::to_string(v) + " "; }
+        void Uint64(std::uint64_t v) { events += "uint64:" + std::to_string(v) + " "; }
+        void Double(double v) { events += "double:" + std::to_string(v) + " "; }
+        void String(const char *v, std::size_t len, bool) {
+            events += "string:" + std::string(v, len) + " ";
+        }
+        void Key(const char *v, std::size_t len, bool) {
+            events += "key:" + std::string(v, len) + " ";
+        }
+        void StartObject() { events += "{ "; }
+        void EndObject(std::size_t) { events += "} "; }
+        void StartArray() { events += "[ "; }
+        void EndArray(std::size_t) { events += "] "; }
+
+        std::string events;
+    };
+
+    for(const auto& c : std::vector<std::pair<std::string, std::string>>{
+        {"42", "uint:42 "},
+        {" -42 ", "int:-42 "},
+        {"-1.5", "double:-1.500000 "},
+        {"18446744073709551615", "uint64:18446744073709551615 "},
+        {R"("a \"string\"")", R"(string:a "string" )"},
+        {"true", "true "},
+        {"null", "null "},
+        {R"([1, "a"])", "[ uint:1 string:a ] "}}) {
+
+        std::string json = c.first;
+        Recorder recorder;
+        SimdJsonParser::Get().Parse(json, recorder);
+        CHECK_EQUAL(c.second, recorder.events);
+    }
+
+    for(const std::string& bad : {"42 43", "nul", R"("a)"}) {
+        std::string json = bad;
+        Recorder recorder;
+        EXPECT_THROWS_AS(SimdJsonParser::Get().Parse(json, recorder), ParseException);
+    }
+} ENDCASE
+
+STARTCASE(DeserializeReplyWithSimdJson) {
+    const std::string json = R"({"id" : 7, "name" : "Dolly Doe", "balance" : 1.5})";
+    const auto length = std::to_string(json.size());
+
+    serialize_properties_t properties;
+    properties.simdjson_max_body_size = json.size();
+
+    struct Case {
+        std::map<std::string, std::string> headers;
+        bool simdjson;
+    };
+
+    for(const auto& c : std::vector<Case>{
+        // The whole body fits, even when it is exactly the limit
+        {{{"Content-Length", length}}, true},
+        {{{"Content-Length", length}, {"Content-Encoding", "identity"}}, true},
+        // Unknown size
+        {{}, false},
+        {{{"Content-Length", "a lot"}}, false},
+        // Too large
+        {{{"Content-Length", std::to_string(json.size() + 1)}}, false},
+        // The size is not the size of the json
+        {{{"Content-Length", length}, {"Content-Encoding", "gzip"}}, false}}) {
+
+        ChunkedReply reply(json, 5);
+        for(const auto& header : c.headers) {
+            reply.SetHeader(header.first, header.second);
+        }
+        Person person;
+        SerializeFromJson(person, reply, properties);
+        CHECK_EQUAL(c.simdjson, reply.WasReadWhole());
+        CHECK_EQUAL(7, person.id);
+        CHECK_EQUAL("Dolly Doe"s, person.name);
+        CHECK_EQUAL(1.5, person.balance);
+    }
+
+    // A body that is larger than its Content-Length said
+    ChunkedReply reply(json + "   ", 5);
+    reply.SetHeader("Content-Length", length);
+    Person ignore;
+    EXPECT_THROWS_AS(SerializeFromJson(ignore, reply, properties), ConstraintException);
+} ENDCASE
+#endif
+
+#ifdef RESTC_CPP_HAVE_PMR
+STARTCASE(DeserializeToMemoryResource) {
+    std::string json =
+        R"({"name":"A group name that is too long for small strings",)"
+        R"("members":[{"id":1,"name":"m1","balance":1.5},{"id":2,"name":"m2","balance":2.5}],)"
+        R"("tags":["first tag that is too long for small strings","second"],)"
+        R"("attributes":{"a key that is too long for small strings":"value"}})";
+
+    std::pmr::monotonic_buffer_resource resource;
+    PmrGroup group;
+
+    {
+        // Fail if anything is allocated from the default resource
+        DefaultResourceGuard guard{std::pmr::null_memory_resource()};
+
+        serialize_properties_t sprop;
+        sprop.memory_resource = &resource;
+        RapidJsonDeserializer<PmrGroup> handler(group, sprop);
+        Reader reader;
+        StringStream ss(json.c_str());
+        reader.Parse(ss, handler);
+    }
+
+    CHECK_EQUAL("A group name that is too long for small strings"s,
+                std::string{group.name});
+    CHECK_EQUAL(2, static_cast<int>(group.members.size()));
+    CHECK_EQUAL("m2"s, group.members[1].name);
+    CHECK_EQUAL(2, static_cast<int>(group.tags.size()));
+    CHECK_EQUAL("second"s, std::string{group.tags[1]});
+    CHECK_EQUAL("value"s, std::string{group.attributes.begin()->second});
+
+    CHECK_EQUAL(true, group.name.get_allocator().resource() == &resource);
+    CHECK_EQUAL(true, group.members.get_allocator().resource() == &resource);
+    CHECK_EQUAL(true, group.tags[0].get_allocator().resource() == &resource);
+    CHECK_EQUAL(true, group.attributes.begin()->first.get_allocator().resource() == &resource);
+
+    // And back to json
+    std::ostringstream out;
+    SerializeToJson(group, out);
+    CHECK_EQUAL(json, out.str());
+} ENDCASE
+#endif
+
 }; // lest
 
 
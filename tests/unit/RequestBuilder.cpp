@@ -9,6 +9,9 @@
 
 #include "restc-cpp/restc-cpp.h"
 #include "restc-cpp/RequestBuilder.h"
+#include "restc-cpp/RequestBody.h"
+
+#include <fstream>
 
 #include "restc-cpp/test_helper.h"
 #include "lest/lest.hpp"
@@ -16,6 +19,48 @@
 using namespace std;
 using namespace restc_cpp;
 
+namespace {
+
+// Collects what the body pushes to it
+class StringDataWriter : public DataWriter {
+public:
+    void Write(boost::asio::const_buffers_1 buffers) override {
+        data_.append(boost::asio::buffer_cast<const char *>(buffers),
+                     boost::asio::buffer_size(buffers));
+    }
+
+    void WriteDirect(boost::asio::const_buffers_1 buffers) override {
+        Write(buffers);
+    }
+
+    void Write(const write_buffers_t& buffers) override {
+        for(const auto& buffer : buffers) {
+            Write(boost::asio::const_buffers_1{buffer});
+        }
+    }
+
+    void Finish() override {}
+    void SetHeaders(Request::headers_t&) override {}
+
+    string data_;
+};
+
+// Get the body the way the request does, a few buffers at the time
+string GetBody(RequestBody& body) {
+    string data;
+    write_buffers_t buffers;
+    while(body.GetData(buffers)) {
+        for(const auto& buffer : buffers) {
+            data.append(boost::asio::buffer_cast<const char *>(buffer),
+                        boost::asio::buffer_size(buffer));
+        }
+        buffers.clear();
+    }
+    return data;
+}
+
+} // anonymous namespace
+
 const lest::test specification[] = {
 
 STARTCASE(TestDataWithCString)
@@ -45,6 +90,117 @@ STARTCASE(TestDataWithString)
 
 } ENDCASE
 
+STARTCASE(TestMultipartWithStrings)
+{
+    MultipartFormData form;
+    form.SetBoundary("xyz")
+        .AddString("name", "Jolly")
+        .AddString("data", "{}", "application/json");
+
+    RequestBuilder rb;
+    rb.Multipart(form);
+    CHECK_EQUAL("--xyz\r\n"
+        "Content-Disposition: form-data; name=\"name\"\r\n"
+        "\r\n"
+        "Jolly\r\n"
+        "--xyz\r\n"
+        "Content-Disposition: form-data; name=\"data\"\r\n"
+        "Content-Type: application/json\r\n"
+        "\r\n"
+        "{}\r\n"
+        "--xyz--\r\n", rb.GetData());
+
+} ENDCASE
+
+
+STARTCASE(TestMultipartWithFile)
+{
+    const auto path = boost::filesystem::temp_directory_path()
+        / boost::filesystem::unique_path();
+    {
+        // Larger than the buffer the file is read with
+        ofstream file(path.string(), ios::binary);
+        file << string(10000, 'a') << "end";
+    }
+
+    MultipartFormData form;
+    form.SetBoundary("xyz")
+        .AddString("name", "Jolly")
+        .AddFile("upload", path, "text/plain", "my \"file\".txt");
+
+    const string expected = "--xyz\r\n"
+        "Content-Disposition: form-data; name=\"name\"\r\n"
+        "\r\n"
+        "Jolly\r\n"
+        "--xyz\r\n"
+        "Content-Disposition: form-data; name=\"upload\"; filename=\"my %22file%22.txt\"\r\n"
+        "Content-Type: text/plain\r\n"
+        "\r\n"
+        + string(10000, 'a') + "end\r\n"
+        "--xyz--\r\n";
+
+    auto body = RequestBody::CreateMultipartBody(form);
+    CHECK_EQUAL_ENUM(RequestBody::Type::FIXED_SIZE, body->GetType());
+    CHECK_EQUAL(expected.size(), body->GetFixedSize());
+    CHECK_EQUAL(expected, GetBody(*body));
+
+    // Again, after a reset (when a request is redirected)
+    body->Reset();
+    CHECK_EQUAL(expected, GetBody(*body));
+
+    boost::filesystem::remove(path);
+
+} ENDCASE
+
+STARTCASE(TestMultipartWithProvider)
+{
+    MultipartFormData form;
+    form.SetBoundary("xyz")
+        .AddString("name", "Jolly")
+        .AddProvider("stream", [](DataWriter& writer) {
+            writer.Write({"abc", 3});
+            writer.Write({"def", 3});
+        }, "application/x-stream", "stream.bin");
+
+    auto body = RequestBody::CreateMultipartBody(form);
+    CHECK_EQUAL_ENUM(RequestBody::Type::CHUNKED_LAZY_PUSH, body->GetType());
+
+    StringDataWriter writer;
+    body->PushData(writer);
+    CHECK_EQUAL("--xyz\r\n"
+        "Content-Disposition: form-data; name=\"name\"\r\n"
+        "\r\n"
+        "Jolly\r\n"
+        "--xyz\r\n"
+        "Content-Disposition: form-data; name=\"stream\"; filename=\"stream.bin\"\r\n"
+        "Content-Type: application/x-stream\r\n"
+        "\r\n"
+        "abcdef\r\n"
+        "--xyz--\r\n", writer.data_);
+
+} ENDCASE
+
+STARTCASE(TestMultipartBoundaryInData)
+{
+    // A boundary we set must not be in the data
+    MultipartFormData form;
+    form.SetBoundary("xyz")
+        .AddString("data", "abc\r\n--xyz\r\ndef");
+    EXPECT_THROWS_AS(RequestBody::CreateMultipartBody(form), ConstraintException);
+
+    // A generated one is never in the data
+    MultipartFormData generated;
+    generated.AddString("data", "--restc-cpp-");
+    auto body = RequestBody::CreateMultipartBody(generated);
+    const auto data = GetBody(*body);
+    const auto boundary = data.substr(2, data.find("\r\n") - 2);
+    EXPECT(boundary.size() > "restc-cpp-"s.size());
+    CHECK_EQUAL("--"s + boundary + "--\r\n",
+                data.substr(data.size() - boundary.size() - 6));
+    CHECK_EQUAL(string::npos, "--restc-cpp-"s.find(boundary));
+
+} ENDCASE
+
 
 }; // lest
 
@@ -0,0 +1,326 @@
+
+// Include before boost::log headers
+#include "restc-cpp/logging.h"
+
+#include <boost/filesystem.hpp>
+
+#include "restc-cpp/restc-cpp.h"
+#include "restc-cpp/ResponseCache.h"
+
+#include "restc-cpp/test_helper.h"
+#include "lest/lest.hpp"
+
+using namespace std;
+using namespace restc_cpp;
+
+namespace {
+
+using clock = std::chrono::system_clock;
+
+Reply::HttpResponse Ok() {
+    Reply::HttpResponse response;
+    response.status_code = 200;
+    response.reason_phrase = "OK";
+    return response;
+}
+
+ResponseCache::entry_t MakeEntry(const string& body,
+                                 const string& cacheControl = "max-age=60") {
+    headers_t headers;
+    headers["Cache-Control"] = cacheControl;
+    headers["ETag"] = "\"1\"";
+    auto entry = ResponseCache::CreateEntry(Ok(), headers);
+    auto storage = make_shared<string>(body);
+    entry->body = *storage;
+    entry->storage = storage;
+    return entry;
+}
+
+string ToString(boost::asio::const_buffers_1 buffer) {
+    return {boost::asio::buffer_cast<const char *>(buffer),
+            boost::asio::buffer_size(buffer)};
+}
+
+class MockReader : public DataReader {
+public:
+    MockReader(std::vector<std::string> buffers)
+    : buffers_{move(buffers)} {}
+
+    bool IsEof() const override {
+        return next_ == buffers_.size();
+    }
+
+    boost::asio::const_buffers_1 ReadSome() override {
+        if (IsEof()) {
+            return {nullptr, 0};
+        }
+        const auto& b = buffers_[next_++];
+        return {b.data(), b.size()};
+    }
+
+    std::vector<std::string> buffers_;
+    size_t next_ = 0;
+};
+
+} // anonymous namespace
+
+const lest::test specification[] = {
+
+STARTCASE(TestParseHttpDate)
+{
+    const auto expected = ResponseCache::time_point_t{} + chrono::seconds(784111777);
+
+    CHECK_EQUAL(true, expected == *ResponseCache::ParseHttpDate(
+        "Sun, 06 Nov 1994 08:49:37 GMT"));
+    CHECK_EQUAL(true, expected == *ResponseCache::ParseHttpDate(
+        "Sunday, 06-Nov-94 08:49:37 GMT"));
+    CHECK_EQUAL(true, expected == *ResponseCache::ParseHttpDate(
+        "Sun Nov  6 08:49:37 1994"));
+    CHECK_EQUAL(false, ResponseCache::ParseHttpDate("0").is_initialized());
+} ENDCASE
+
+STARTCASE(TestFreshness)
+{
+    const auto now = clock::now();
+    headers_t headers;
+    headers["Cache-Control"] = "public, max-age=100";
+    headers["Age"] = "40";
+
+    auto entry = ResponseCache::CreateEntry(Ok(), headers, now);
+    CHECK_EQUAL(true, entry != nullptr);
+    CHECK_EQUAL(true, entry->IsFresh(now + chrono::seconds(59)));
+    CHECK_EQUAL(false, entry->IsFresh(now + chrono::seconds(60)));
+} ENDCASE
+
+STARTCASE(TestExpiresIsRelativeToDate)
+{
+    const auto now = clock::now();
+    headers_t headers;
+    // The servers clock is behind ours. Only the difference matters.
+    headers["Date"] = "Sun, 06 Nov 1994 08:49:37 GMT";
+    headers["Expires"] = "Sun, 06 Nov 1994 08:50:37 GMT";
+
+    auto entry = ResponseCache::CreateEntry(Ok(), headers, now);
+    CHECK_EQUAL(true, entry == nullptr); // Stale and no validator
+
+    headers["ETag"] = "\"abc\"";
+    entry = ResponseCache::CreateEntry(Ok(), headers, now);
+    CHECK_EQUAL(true, entry != nullptr);
+    CHECK_EQUAL(false, entry->IsFresh(now));
+} ENDCASE
+
+STARTCASE(TestNotCacheable)
+{
+    headers_t headers;
+    headers["Cache-Control"] = "no-store";
+    CHECK_EQUAL(true, ResponseCache::CreateEntry(Ok(), headers) == nullptr);
+
+    headers["Cache-Control"] = "max-age=60";
+    headers["Vary"] = "Accept-Language";
+    CHECK_EQUAL(true, ResponseCache::CreateEntry(Ok(), headers) == nullptr);
+
+    headers["Vary"] = "accept-encoding";
+    CHECK_EQUAL(true, ResponseCache::CreateEntry(Ok(), headers) != nullptr);
+
+    auto response = Ok();
+    response.status_code = 206;
+    CHECK_EQUAL(true, ResponseCache::CreateEntry(response, headers) == nullptr);
+
+    headers_t request;
+    request["Authorization"] = "Basic Zm9vOmJhcg==";
+    CHECK_EQUAL(false, ResponseCache::IsRequestCacheable(request));
+} ENDCASE
+
+STARTCASE(TestRevalidate)
+{
+    auto entry = MakeEntry("data", "no-cache");
+    const auto now = clock::now();
+    CHECK_EQUAL(false, entry->IsFresh(now));
+
+    headers_t headers;
+    headers["Cache-Control"] = "max-age=60";
+    headers["ETag"] = "\"2\"";
+    auto updated = ResponseCache::Revalidate(*entry, headers, now);
+    CHECK_EQUAL(true, updated->IsFresh(now));
+    CHECK_EQUAL("\"2\"", updated->headers.find("ETag")->second);
+    CHECK_EQUAL("data", updated->body.to_string());
+} ENDCASE
+
+STARTCASE(TestLruEviction)
+{
+    Request::Properties properties;
+    properties.responseCacheMaxBytes = 1024;
+    auto cache = ResponseCache::Create(properties);
+
+    const string body(400, 'x');
+    cache->Put("a", MakeEntry(body));
+    cache->Put("b", MakeEntry(body));
+    CHECK_EQUAL(true, cache->Get("a") != nullptr); // a is now most recent
+    cache->Put("c", MakeEntry(body));
+
+    CHECK_EQUAL(true, cache->Get("a") != nullptr);
+    CHECK_EQUAL(true, cache->Get("b") == nullptr);
+    CHECK_EQUAL(true, cache->Get("c") != nullptr);
+    CHECK_EQUAL(true, cache->GetBytesInMemory() <= properties.responseCacheMaxBytes);
+
+    cache->Remove("a");
+    CHECK_EQUAL(true, cache->Get("a") == nullptr);
+} ENDCASE
+
+STARTCASE(TestDiskStore)
+{
+    const auto dir = boost::filesystem::temp_directory_path()
+        / boost::filesystem::unique_path();
+
+    Request::Properties properties;
+    properties.responseCacheDirectory = dir.string();
+
+    {
+        auto cache = ResponseCache::Create(properties);
+        cache->Put("http://localhost/a", MakeEntry("Hello disk"));
+    }
+
+    // A new cache finds the entry in the directory
+    auto cache = ResponseCache::Create(properties);
+    auto entry = cache->Get("http://localhost/a");
+    CHECK_EQUAL(true, entry != nullptr);
+    CHECK_EQUAL("Hello disk", entry->body.to_string());
+    CHECK_EQUAL(200, entry->response.status_code);
+    CHECK_EQUAL("\"1\"", entry->headers.find("ETag")->second);
+    CHECK_EQUAL(true, entry->IsFresh());
+
+    CHECK_EQUAL(true, cache->Get("http://localhost/b") == nullptr);
+
+    entry.reset();
+    boost::filesystem::remove_all(dir);
+} ENDCASE
+
+STARTCASE(TestDiskBudget)
+{
+    const auto dir = boost::filesystem::temp_directory_path()
+        / boost::filesystem::unique_path();
+
+    Request::Properties properties;
+    properties.responseCacheDirectory = dir.string();
+    properties.responseCacheMaxBytes = 0; // Only use the files
+    const std::string body(1000, 'x');
+
+    auto count_files = [&dir] {
+        return std::distance(boost::filesystem::directory_iterator{dir},
+                             boost::filesystem::directory_iterator{});
+    };
+
+    // Room for two files
+    properties.responseCacheMaxDiskBytes = 2500;
+
+    {
+        auto cache = ResponseCache::Create(properties);
+        cache->Put("http://localhost/a", MakeEntry(body));
+        cache->Put("http://localhost/b", MakeEntry(body));
+        CHECK_EQUAL(2, static_cast<int>(count_files()));
+
+        // The least recently used file is deleted
+        CHECK_EQUAL(true, cache->Get("http://localhost/a") != nullptr);
+        cache->Put("http://localhost/c", MakeEntry(body));
+        CHECK_EQUAL(2, static_cast<int>(count_files()));
+        CHECK_EQUAL(true, cache->Get("http://localhost/b") == nullptr);
+        CHECK_EQUAL(true, cache->Get("http://localhost/a") != nullptr);
+        CHECK_EQUAL(true, cache->Get("http://localhost/c") != nullptr);
+    }
+
+    // A new cache counts the files that are already there
+    properties.responseCacheMaxDiskBytes = 1500;
+    auto cache = ResponseCache::Create(properties);
+    CHECK_EQUAL(1, static_cast<int>(count_files()));
+
+    cache.reset();
+    boost::filesystem::remove_all(dir);
+} ENDCASE
+
+STARTCASE(TestStoringReader)
+{
+    Request::Properties properties;
+    properties.responseCacheMaxEntrySize = 16;
+    auto cache = ResponseCache::Create(properties);
+    CHECK_EQUAL(16, static_cast<int>(cache->GetMaxEntrySize()));
+
+    headers_t headers;
+    headers["Cache-Control"] = "max-age=60";
+    headers["Transfer-Encoding"] = "chunked";
+
+    auto reader = cache->CreateStoringReader(
+        make_unique<MockReader>(std::vector<std::string>{"Hello ", "cache"}),
+        "small", ResponseCache::CreateEntry(Ok(), headers));
+    CHECK_EQUAL("Hello ", ToString(reader->ReadSome()));
+    CHECK_EQUAL(true, cache->Get("small") == nullptr);
+    CHECK_EQUAL("cache", ToString(reader->ReadSome()));
+
+    auto entry = cache->Get("small");
+    CHECK_EQUAL(true, entry != nullptr);
+    CHECK_EQUAL("Hello cache", entry->body.to_string());
+    CHECK_EQUAL("11", entry->headers.find("Content-Length")->second);
+    CHECK_EQUAL(true, entry->headers.find("Transfer-Encoding") == entry->headers.end());
+
+    // Read the cached body back
+    auto cached = ResponseCache::CreateReader(entry);
+    CHECK_EQUAL("Hello cache", ToString(cached->ReadSome()));
+    CHECK_EQUAL(true, cached->IsEof());
+
+    // Too large
+    reader = cache->CreateStoringReader(
+        make_unique<MockReader>(std::vector<std::string>{"0123456789abcdef", "x"}),
+        "large", ResponseCache::CreateEntry(Ok(), headers));
+    while(!reader->IsEof()) {
+        reader->ReadSome();
+    }
+    CHECK_EQUAL(true, cache->Get("large") == nullptr);
+} ENDCASE
+
+STARTCASE(TestPermanentRedirects)
+{
+    Request::Properties properties;
+    properties.maxCachedRedirects = 2;
+    auto cache = ResponseCache::Create(properties);
+
+    headers_t headers;
+    cache->AddPermanentRedirect("http://a", "http://b", headers);
+    CHECK_EQUAL("http://b", cache->GetPermanentRedirect("http://a")->location);
+    CHECK_EQUAL(301, cache->GetPermanentRedirect("http://a")->status_code);
+    CHECK_EQUAL(false, cache->GetPermanentRedirect("http://b").is_initialized());
+
+    headers["Cache-Control"] = "no-store";
+    cache->AddPermanentRedirect("http://c", "http://d", headers);
+    CHECK_EQUAL(false, cache->GetPermanentRedirect("http://c").is_initialized());
+
+    headers["Cache-Control"] = "max-age=0";
+    cache->AddPermanentRedirect("http://c", "http://d", headers);
+    CHECK_EQUAL(false, cache->GetPermanentRedirect("http://c").is_initialized());
+
+    headers["Cache-Control"] = "max-age=60";
+    cache->AddPermanentRedirect("http://c", "http://d", headers);
+    CHECK_EQUAL("http://d", cache->GetPermanentRedirect("http://c")->location);
+
+    // The number of redirects is capped
+    cache->AddPermanentRedirect("http://e", "http://f", headers);
+    CHECK_EQUAL("http://f", cache->GetPermanentRedirect("http://e")->location);
+    const auto remaining = cache->GetPermanentRedirect("http://a").is_initialized()
+        + cache->GetPermanentRedirect("http://c").is_initialized();
+    CHECK_EQUAL(1, remaining);
+
+    // The status code is kept, so that a cached 308 keeps the method and body
+    auto other = ResponseCache::Create(properties);
+    other->AddPermanentRedirect("http://g", "http://h", headers, 308);
+    CHECK_EQUAL("http://h", other->GetPermanentRedirect("http://g")->location);
+    CHECK_EQUAL(308, other->GetPermanentRedirect("http://g")->status_code);
+
+    other->RemovePermanentRedirect("http://g");
+    CHECK_EQUAL(false, other->GetPermanentRedirect("http://g").is_initialized());
+} ENDCASE
+
+}; // lest
+
+
+int main( int argc, char * argv[] )
+{
+    return lest::run( specification, argc, argv );
+}